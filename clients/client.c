@@ -18,6 +18,13 @@
 #define DEFAULT_SERVER_PORT 5683
 #define MAX_BUF 2048         // Max CoAP message size
 #define RECV_TIMEOUT_MS 2000 // 2 seconds
+#define SEPARATE_TIMEOUT_MS 60000 // wait for a separate response after an empty ACK
+#define TOKEN_LEN 4
+#define OBSERVE_OPTION 6          // RFC 7641 Observe
+#define DEFAULT_OBSERVE_SECONDS 60
+#define ETAG_OPTION 4             // RFC 7252 ETag
+#define ETAG_MAX_LEN 8
+#define ETAG_CACHE_SLOTS 16       // GET targets whose last body is remembered
 
 /* Generate a random CoAP message ID (MID) */
 static uint16_t random_mid(void)
@@ -25,6 +32,14 @@ static uint16_t random_mid(void)
     return (uint16_t)(rand() & 0xFFFF);
 }
 
+/* Give a request a random token so separate responses can be matched */
+static void set_random_token(coap_message_t *msg)
+{
+    msg->tkl = TOKEN_LEN;
+    for (int i = 0; i < TOKEN_LEN; i++)
+        msg->token[i] = (uint8_t)(rand() & 0xFF);
+}
+
 /* Check if a string is purely numeric (for sensor IDs, etc.) */
 static int is_numeric(const char *s)
 {
@@ -41,9 +56,49 @@ static int is_numeric(const char *s)
     return 1;
 }
 
+/* Wait up to timeout_ms for one datagram. Returns its length, 0 on timeout, -1 on error. */
+static ssize_t wait_datagram(int sock, uint8_t *buf, size_t cap, int timeout_ms)
+{
+    fd_set rfds;
+    struct timeval tv;
+    FD_ZERO(&rfds);
+    FD_SET(sock, &rfds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int rv = select(sock + 1, &rfds, NULL, NULL, &tv);
+    if (rv == 0)
+        return 0;
+    if (rv < 0 || !FD_ISSET(sock, &rfds))
+        return -1;
+    struct sockaddr_in from;
+    socklen_t flen = sizeof(from);
+    ssize_t r = recvfrom(sock, buf, cap, 0, (struct sockaddr *)&from, &flen);
+    return r > 0 ? r : -1;
+}
+
+/* Acknowledge a CON message received from the server (separate response) */
+static void send_empty_ack(int sock, struct sockaddr_in *srv, uint16_t mid)
+{
+    coap_message_t ack;
+    coap_init_message(&ack);
+    ack.version = COAP_VERSION;
+    ack.type = COAP_TYPE_ACK;
+    ack.code = COAP_CODE_EMPTY;
+    ack.message_id = mid;
+    uint8_t out[8];
+    int n = coap_serialize(&ack, out, sizeof(out));
+    if (n > 0)
+        sendto(sock, out, (size_t)n, 0, (struct sockaddr *)srv, sizeof(*srv));
+}
+
 /* 
    Send a CoAP message to the server and wait for a reply. 
-   Uses select() to wait with a timeout. 
+   Uses select() to wait with a timeout. An empty ACK means the server
+   will answer later with a separate CON response carrying our token;
+   that response is acknowledged and printed. If reply is not NULL the
+   response is handed over to it (caller frees it with coap_free_message)
+   and the caller prints the payload itself.
    Returns:
      0 -> success
      1 -> timeout
@@ -52,7 +107,7 @@ static int is_numeric(const char *s)
     -4 -> receive error
 */
 static int send_coap_and_wait(int sock, struct sockaddr_in *srv,
-                              coap_message_t *msg, int timeout_ms)
+                              coap_message_t *msg, int timeout_ms, coap_message_t *reply)
 {
     uint8_t out[MAX_BUF];
     int outlen = coap_serialize(msg, out, sizeof(out));
@@ -62,41 +117,307 @@ static int send_coap_and_wait(int sock, struct sockaddr_in *srv,
     if (sendto(sock, out, outlen, 0, (struct sockaddr *)srv, sizeof(*srv)) < 0)
         return -1;
 
-    // Prepare select() for timeout
-    fd_set rfds;
-    struct timeval tv;
-    FD_ZERO(&rfds);
-    FD_SET(sock, &rfds);
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-    int rv = select(sock + 1, &rfds, NULL, NULL, &tv);
-    if (rv > 0 && FD_ISSET(sock, &rfds))
+    int separate = 0;
+    while (1)
     {
-        // Got response -> read it
         uint8_t in[MAX_BUF];
-        struct sockaddr_in from;
-        socklen_t flen = sizeof(from);
-        ssize_t r = recvfrom(sock, in, sizeof(in), 0, (struct sockaddr *)&from, &flen);
-        if (r > 0)
+        ssize_t r = wait_datagram(sock, in, sizeof(in), separate ? SEPARATE_TIMEOUT_MS : timeout_ms);
+        if (r == 0)
+            return 1; // timeout
+        if (r < 0)
+            return -4; // recv error
+
+        coap_message_t resp;
+        if (coap_parse(in, r, &resp) != COAP_OK)
+            return -3; // parse error
+
+        if (resp.type == COAP_TYPE_ACK && resp.code == COAP_CODE_EMPTY &&
+            resp.message_id == msg->message_id)
         {
-            coap_message_t resp;
-            if (coap_parse(in, r, &resp) == COAP_OK)
+            printf("<< Empty ACK MID=%u, waiting for separate response\n", resp.message_id);
+            coap_free_message(&resp);
+            separate = 1;
+            continue;
+        }
+        if (resp.type == COAP_TYPE_CON)
+        {
+            send_empty_ack(sock, srv, resp.message_id);
+            if (resp.tkl != msg->tkl || memcmp(resp.token, msg->token, msg->tkl) != 0)
+            {
+                coap_free_message(&resp); // separate response of an earlier request
+                continue;
+            }
+        }
+
+        printf("<< Received: Type=%u MID=%u Code=0x%02X\n",
+               (unsigned)resp.type, resp.message_id, resp.code);
+        if (resp.payload_len > 0 && !reply)
+        {
+            printf("<< Payload: %.*s\n", (int)resp.payload_len, (char *)resp.payload);
+        }
+        if (reply)
+            *reply = resp;
+        else
+            coap_free_message(&resp);
+        return 0;
+    }
+}
+
+/* Block2 option of a response: 1 with *b filled, 0 when absent or malformed */
+static int response_block2(const coap_message_t *resp, coap_block_t *b)
+{
+    for (size_t i = 0; i < resp->options_count; i++)
+    {
+        if (resp->options[i].number == COAP_OPTION_BLOCK2)
+            return coap_block_decode(resp->options[i].value, resp->options[i].length, b) == COAP_OK;
+    }
+    return 0;
+}
+
+/* Replace (or add) the Block2 option of a request */
+static int set_block2(coap_message_t *msg, const coap_block_t *b)
+{
+    uint8_t v[3];
+    int n = coap_block_encode(b, v);
+    if (n < 0)
+        return n;
+    for (size_t i = 0; i < msg->options_count; i++)
+    {
+        if (msg->options[i].number == COAP_OPTION_BLOCK2)
+        {
+            free(msg->options[i].value);
+            msg->options[i].value = NULL;
+            msg->options[i].length = (uint16_t)n;
+            if (n > 0 && !(msg->options[i].value = malloc((size_t)n)))
+                return COAP_ERR_INVALID;
+            memcpy(msg->options[i].value, v, (size_t)n);
+            return COAP_OK;
+        }
+    }
+    return coap_add_option(msg, COAP_OPTION_BLOCK2, v, (size_t)n);
+}
+
+/* ------------------------
+   ETag cache: last body and ETag of recent GET targets ("3", "all?after=10", ...)
+   ------------------------ */
+typedef struct
+{
+    char key[512];
+    uint8_t etag[ETAG_MAX_LEN];
+    size_t etag_len;
+    char *body;
+    size_t body_len;
+} etag_entry_t;
+
+static etag_entry_t etag_cache[ETAG_CACHE_SLOTS];
+static size_t etag_cache_next = 0; // round-robin replacement
+
+static etag_entry_t *etag_lookup(const char *key)
+{
+    for (size_t i = 0; i < ETAG_CACHE_SLOTS; i++)
+    {
+        if (etag_cache[i].etag_len > 0 && strcmp(etag_cache[i].key, key) == 0)
+            return &etag_cache[i];
+    }
+    return NULL;
+}
+
+static void etag_store(const char *key, const coap_message_t *resp, const char *body, size_t body_len)
+{
+    const coap_option_t *opt = NULL;
+    for (size_t i = 0; i < resp->options_count; i++)
+    {
+        if (resp->options[i].number == ETAG_OPTION)
+            opt = &resp->options[i];
+    }
+    if (!opt || opt->length == 0 || opt->length > ETAG_MAX_LEN)
+        return;
+
+    etag_entry_t *e = etag_lookup(key);
+    if (!e)
+    {
+        e = &etag_cache[etag_cache_next];
+        etag_cache_next = (etag_cache_next + 1) % ETAG_CACHE_SLOTS;
+    }
+    char *copy = malloc(body_len + 1);
+    if (!copy)
+        return;
+    memcpy(copy, body, body_len);
+    copy[body_len] = '\0';
+    free(e->body);
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    memcpy(e->etag, opt->value, opt->length);
+    e->etag_len = opt->length;
+    e->body = copy;
+    e->body_len = body_len;
+}
+
+/*
+   GET that follows Block2: while the server answers with the M bit set, ask
+   for the next block (same token and options, new Message ID) and append it.
+   The whole body is printed once the last block arrived.
+   When `key` has a cached ETag it is sent along, and a 2.03 Valid answer
+   reuses the cached body; fresh 2.05 bodies carrying an ETag are cached.
+   Returns like send_coap_and_wait.
+*/
+static int get_blockwise(int sock, struct sockaddr_in *srv, coap_message_t *msg, const char *key)
+{
+    char *body = NULL;
+    size_t body_len = 0;
+    coap_block_t block = {0, 0, COAP_BLOCK_MAX_SZX};
+    etag_entry_t *cached = etag_lookup(key);
+    if (cached)
+        coap_add_option(msg, ETAG_OPTION, cached->etag, cached->etag_len);
+    coap_message_t first; // block 0, kept for its ETag
+    coap_init_message(&first);
+    int complete = 0;
+    while (1)
+    {
+        coap_message_t resp;
+        int rc = send_coap_and_wait(sock, srv, msg, RECV_TIMEOUT_MS, &resp);
+        if (rc != 0)
+        {
+            coap_free_message(&first);
+            free(body);
+            return rc;
+        }
+        if (block.num == 0 && resp.code == COAP_CODE_VALID && cached)
+        {
+            printf("<< Valid (ETag matched), cached body: %s\n", cached->body);
+            coap_free_message(&resp);
+            return 0;
+        }
+        coap_block_t got;
+        int blockwise = response_block2(&resp, &got);
+        if (blockwise && (got.num != block.num || resp.code != COAP_CODE_CONTENT))
+        {
+            printf("!! unexpected block %u\n", (unsigned)got.num);
+            blockwise = 0;
+            got.more = 0;
+        }
+        // Blocks are printed once, as the whole body at the end
+        if (!blockwise && resp.payload_len > 0)
+            printf("<< Payload: %.*s\n", (int)resp.payload_len, (char *)resp.payload);
+        if (blockwise && resp.payload_len > 0)
+        {
+            char *grown = realloc(body, body_len + resp.payload_len + 1);
+            if (!grown)
             {
-                printf("<< Received: Type=%u MID=%u Code=0x%02X\n",
-                       (unsigned)resp.type, resp.message_id, resp.code);
-                if (resp.payload_len > 0)
-                {
-                    printf("<< Payload: %.*s\n", (int)resp.payload_len, (char *)resp.payload);
-                }
                 coap_free_message(&resp);
-                return 0;
+                coap_free_message(&first);
+                free(body);
+                return -4;
             }
-            return -3; // parse error
+            body = grown;
+            memcpy(body + body_len, resp.payload, resp.payload_len);
+            body_len += resp.payload_len;
+        }
+        if (block.num > 0)
+            coap_free_message(&resp);
+        else if (!blockwise && resp.code == COAP_CODE_CONTENT)
+        {
+            etag_store(key, &resp, (const char *)resp.payload, resp.payload_len);
+            coap_free_message(&resp);
+        }
+        else
+            first = resp;
+        if (!blockwise || !got.more)
+        {
+            complete = 1;
+            break;
+        }
+
+        // Next block: keep the size the server picked
+        block.num = got.num + 1;
+        block.szx = got.szx;
+        msg->message_id = random_mid();
+        if (set_block2(msg, &block) != COAP_OK)
+            break;
+        printf(">> Sending GET MID=%u Block2=%u/%u\n", msg->message_id, (unsigned)block.num,
+               COAP_BLOCK_SIZE(block.szx));
+    }
+    if (body)
+    {
+        body[body_len] = '\0';
+        printf("<< Body (%zu bytes, block-wise): %s\n", body_len, body);
+        if (complete && first.code == COAP_CODE_CONTENT)
+            etag_store(key, &first, body, body_len);
+        free(body);
+    }
+    coap_free_message(&first);
+    return 0;
+}
+
+/*
+   Observe sensor/<sensor>: register with a GET carrying Observe 0, print the
+   notifications pushed by the server for `seconds`, then deregister with
+   Observe 1 on the same token.
+*/
+static void observe_sensor(int sock, struct sockaddr_in *srv, const char *sensor, int seconds)
+{
+    coap_message_t msg;
+    coap_init_message(&msg);
+    msg.version = COAP_VERSION;
+    msg.type = COAP_TYPE_CON;
+    msg.code = COAP_CODE_GET;
+    msg.message_id = random_mid();
+    set_random_token(&msg);
+    uint8_t reg = 0;
+    coap_add_option(&msg, OBSERVE_OPTION, &reg, 0); // Observe 0 = register (empty value)
+    coap_add_option(&msg, 11, (uint8_t *)"sensor", strlen("sensor"));
+    coap_add_option(&msg, 11, (uint8_t *)sensor, strlen(sensor));
+    printf(">> Sending GET MID=%u Uri=sensor/%s Observe=0\n", msg.message_id, sensor);
+    int rc = send_coap_and_wait(sock, srv, &msg, RECV_TIMEOUT_MS, NULL);
+    if (rc != 0)
+    {
+        printf(rc == 1 ? "!! timeout (no ACK)\n" : "!! send error rc=%d\n", rc);
+        coap_free_message(&msg);
+        return;
+    }
+
+    time_t end = time(NULL) + seconds;
+    int notifications = 0;
+    while (time(NULL) < end)
+    {
+        uint8_t in[MAX_BUF];
+        ssize_t r = wait_datagram(sock, in, sizeof(in), (int)(end - time(NULL)) * 1000);
+        if (r <= 0)
+            continue;
+        coap_message_t note;
+        if (coap_parse(in, (size_t)r, &note) != COAP_OK)
+            continue;
+        if (note.type == COAP_TYPE_CON)
+            send_empty_ack(sock, srv, note.message_id);
+        if (note.tkl == msg.tkl && memcmp(note.token, msg.token, msg.tkl) == 0)
+        {
+            uint32_t seq = 0;
+            for (size_t i = 0; i < note.options_count; i++)
+                if (note.options[i].number == OBSERVE_OPTION)
+                    for (size_t j = 0; j < note.options[i].length; j++)
+                        seq = (seq << 8) | note.options[i].value[j];
+            printf("<< Notification seq=%u: %.*s\n", (unsigned)seq, (int)note.payload_len, (char *)note.payload);
+            notifications++;
+        }
+        coap_free_message(&note);
+    }
+
+    // Deregister: same token, Observe 1
+    reg = 1;
+    for (size_t i = 0; i < msg.options_count; i++)
+    {
+        if (msg.options[i].number == OBSERVE_OPTION)
+        {
+            free(msg.options[i].value);
+            msg.options[i].value = malloc(1);
+            msg.options[i].length = msg.options[i].value ? 1 : 0;
+            if (msg.options[i].value)
+                msg.options[i].value[0] = reg;
         }
-        return -4; // recv error
     }
-    return 1; // timeout
+    msg.message_id = random_mid();
+    printf("-- %d notification(s); deregistering\n", notifications);
+    send_coap_and_wait(sock, srv, &msg, RECV_TIMEOUT_MS, NULL);
+    coap_free_message(&msg);
 }
 
 /* Print usage instructions */
@@ -106,11 +427,18 @@ static void usage(const char *me)
     printf("  If omitted, defaults: %s %d <no-sensor> <random-mid>\n", DEFAULT_SERVER_IP, DEFAULT_SERVER_PORT);
     printf("\nCommands (interactive):\n");
     printf("  GET [id|all]        -> GET specific id (number) or all (no arg or 'all')\n");
+    printf("  LATEST n            -> newest reading of sensor n (GET sensor/<n>)\n");
+    printf("  GET n?from=..&to=..&limit=..  -> readings of sensor n in a time range (Uri-Query)\n");
+    printf("  GET all?after=id    -> one page of rows after id, with the cursor of the next page\n");
+    printf("  DUMP                -> page through every row (GET ?after=<cursor> until next=0)\n");
+    printf("  OBSERVE n [secs]    -> watch sensor n: print readings as they are posted (default %d s)\n",
+           DEFAULT_OBSERVE_SECONDS);
+    printf("  METRICS [json]      -> request counts and latency percentiles (GET .well-known/metrics)\n");
     printf("  PUT id=value        -> Update record with id to value (payload 'id=value')\n");
     printf("  DELETE id           -> Delete record with id (payload 'id')\n");
     printf("  POST value          -> Insert new record (sends POST payload=value). If sensor_number was given it will add Uri-Path 'sensor/<n>'\n");
     printf("  exit                -> quit\n");
-    printf("\nExamples:\n  GET 3\n  PUT 3=temperature:22.5\n  DELETE 3\n  POST {\"temp\":22}\n");
+    printf("\nExamples:\n  GET 3\n  LATEST 42\n  GET 42?from=2025-01-01T08:00&to=2025-01-01T09:00\n  PUT 3=temperature:22.5\n  DELETE 3\n  POST {\"temp\":22}\n");
 }
 
 /* -------------------
@@ -182,8 +510,14 @@ int main(int argc, char **argv)
         if (n < 1)
             continue;
 
-        /* --------- GET --------- */
-        if (strcasecmp(cmd, "GET") == 0)
+        /* --------- GET / LATEST --------- */
+        int latest = strcasecmp(cmd, "LATEST") == 0;
+        if (latest && (n < 2 || !is_numeric(arg1)))
+        {
+            printf("LATEST requires a sensor number\n");
+            continue;
+        }
+        if (strcasecmp(cmd, "GET") == 0 || latest)
         {
             coap_message_t msg;
             coap_init_message(&msg);
@@ -191,13 +525,36 @@ int main(int argc, char **argv)
             msg.type = COAP_TYPE_CON;
             msg.code = COAP_CODE_GET;
             msg.message_id = fixed_mid ? fixed_mid : random_mid();
+            set_random_token(&msg);
+
+            // ETag cache key: the target as typed ("3", "all?after=10", ...)
+            char key[sizeof(arg1)];
+            snprintf(key, sizeof(key), "%s%s", latest ? "sensor/" : "", n == 2 ? arg1 : "all");
+
+            // "GET 42?from=...&to=...": everything after '?' goes out as Uri-Query
+            // options (one per '&'-separated filter). Options are kept sorted by
+            // number, so adding them before the Uri-Path is fine.
+            char *query = n == 2 ? strchr(arg1, '?') : NULL;
+            if (query)
+            {
+                *query++ = '\0';
+                for (char *save = NULL, *q = strtok_r(query, "&", &save); q; q = strtok_r(NULL, "&", &save))
+                    coap_add_option(&msg, 15, (uint8_t *)q, strlen(q));
+                if (arg1[0] == '\0')
+                    n = 1;
+            }
 
             // If arg1 provided and not "all" -> add uri-path
             if (n == 2 && strcmp(arg1, "all") != 0)
             {
                 char pathbuf[64];
-                // If arg1 is numeric, send as sensor/<arg1> to be consistent with simulators
-                if (is_numeric(arg1))
+                // "GET 3" is record 3; LATEST and time-range filters address sensor/<n>
+                if (is_numeric(arg1) && !latest && !query)
+                {
+                    coap_add_option(&msg, 11, (uint8_t *)arg1, strlen(arg1));
+                    printf(">> Sending GET MID=%u Uri=%s\n", msg.message_id, arg1);
+                }
+                else if (is_numeric(arg1))
                 {
                     snprintf(pathbuf, sizeof(pathbuf), "sensor/%s", arg1);
                     coap_add_option(&msg, 11, (uint8_t *)"sensor", strlen("sensor"));
@@ -216,11 +573,39 @@ int main(int argc, char **argv)
                 printf(">> Sending GET MID=%u Uri=(all)\n", msg.message_id);
             }
 
-            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS);
+            int rc = get_blockwise(sock, &srv, &msg, key);
             if (rc == 1)
                 printf("!! timeout (no ACK)\n");
             else if (rc < 0)
                 printf("!! send error rc=%d\n", rc);
+            coap_free_message(&msg);
+        }
+
+        /* --------- METRICS --------- */
+        else if (strcasecmp(cmd, "METRICS") == 0)
+        {
+            coap_message_t msg;
+            coap_init_message(&msg);
+            msg.version = COAP_VERSION;
+            msg.type = COAP_TYPE_CON;
+            msg.code = COAP_CODE_GET;
+            msg.message_id = fixed_mid ? fixed_mid : random_mid();
+            set_random_token(&msg);
+            coap_add_option(&msg, 11, (uint8_t *)".well-known", strlen(".well-known"));
+            coap_add_option(&msg, 11, (uint8_t *)"metrics", strlen("metrics"));
+            if (n == 2 && strcasecmp(arg1, "json") == 0)
+            {
+                uint8_t accept = 50; // application/json
+                coap_add_option(&msg, 17, &accept, 1);
+            }
+            printf(">> Sending GET MID=%u Uri=.well-known/metrics\n", msg.message_id);
+
+            int rc = get_blockwise(sock, &srv, &msg, ".well-known/metrics");
+            if (rc == 1)
+                printf("!! timeout (no ACK)\n");
+            else if (rc < 0)
+                printf("!! send error rc=%d\n", rc);
+            coap_free_message(&msg);
         }
 
         /* --------- POST --------- */
@@ -237,6 +622,7 @@ int main(int argc, char **argv)
             msg.type = COAP_TYPE_CON;
             msg.code = COAP_CODE_POST;
             msg.message_id = fixed_mid ? fixed_mid : random_mid();
+            set_random_token(&msg);
 
             // If sensor_number exists, create Uri-Path "sensor" and "<sensor_number>" so path = sensor/<n>
             if (sensor_number)
@@ -249,7 +635,7 @@ int main(int argc, char **argv)
 
             printf(">> Sending POST MID=%u Uri=%s Payload=%s\n", msg.message_id,
                    sensor_number ? "sensor/<id>" : "(none)", arg1);
-            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS);
+            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS, NULL);
             if (rc == 1)
                 printf("!! timeout (no ACK)\n");
             else if (rc < 0)
@@ -277,6 +663,7 @@ int main(int argc, char **argv)
             msg.type = COAP_TYPE_CON;
             msg.code = COAP_CODE_PUT;
             msg.message_id = fixed_mid ? fixed_mid : random_mid();
+            set_random_token(&msg);
 
             // If id=value and id is numeric, put as sensor/<id> Uri-Path for consistency
             char idbuf[64];
@@ -302,7 +689,7 @@ int main(int argc, char **argv)
             msg.payload_len = strlen(arg1);
 
             printf(">> Sending PUT MID=%u payload=%s\n", msg.message_id, arg1);
-            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS);
+            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS, NULL);
             if (rc == 1)
                 printf("!! timeout (no ACK)\n");
             else if (rc < 0)
@@ -324,6 +711,7 @@ int main(int argc, char **argv)
             msg.type = COAP_TYPE_CON;
             msg.code = COAP_CODE_DELETE;
             msg.message_id = fixed_mid ? fixed_mid : random_mid();
+            set_random_token(&msg);
 
             // If id numeric, use sensor/<id> path
             if (is_numeric(arg1))
@@ -336,12 +724,63 @@ int main(int argc, char **argv)
             msg.payload_len = strlen(arg1);
 
             printf(">> Sending DELETE MID=%u id=%s\n", msg.message_id, arg1);
-            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS);
+            int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS, NULL);
             if (rc == 1)
                 printf("!! timeout (no ACK)\n");
             else if (rc < 0)
                 printf("!! send error rc=%d\n", rc);
         }
+
+        /* --------- DUMP: page through every row --------- */
+        else if (strcasecmp(cmd, "DUMP") == 0)
+        {
+            // Each page is GET ?after=<cursor>; the server answers
+            // {"rows":[...],"next":<cursor>} and next=0 ends the walk
+            int after = 0, pages = 0;
+            do
+            {
+                coap_message_t msg, resp;
+                coap_init_message(&msg);
+                msg.version = COAP_VERSION;
+                msg.type = COAP_TYPE_CON;
+                msg.code = COAP_CODE_GET;
+                msg.message_id = random_mid();
+                set_random_token(&msg);
+                char query[32];
+                snprintf(query, sizeof(query), "after=%d", after);
+                coap_add_option(&msg, 15, (uint8_t *)query, strlen(query));
+                printf(">> Sending GET MID=%u ?%s\n", msg.message_id, query);
+
+                int rc = send_coap_and_wait(sock, &srv, &msg, RECV_TIMEOUT_MS, &resp);
+                coap_free_message(&msg);
+                if (rc != 0)
+                {
+                    printf(rc == 1 ? "!! timeout (no ACK)\n" : "!! send error rc=%d\n", rc);
+                    break;
+                }
+                char body[MAX_BUF];
+                snprintf(body, sizeof(body), "%.*s", (int)resp.payload_len, (char *)resp.payload);
+                coap_free_message(&resp);
+                printf("<< Payload: %s\n", body);
+                const char *next = strstr(body, "\"next\":");
+                after = next ? atoi(next + 7) : 0;
+                pages++;
+            } while (after > 0);
+            printf("-- %d page(s)\n", pages);
+        }
+
+        /* --------- OBSERVE --------- */
+        else if (strcasecmp(cmd, "OBSERVE") == 0)
+        {
+            char sensor[32];
+            int secs = DEFAULT_OBSERVE_SECONDS;
+            if (n < 2 || sscanf(arg1, "%31s %d", sensor, &secs) < 1 || !is_numeric(sensor) || secs <= 0)
+            {
+                printf("OBSERVE requires a sensor number\n");
+                continue;
+            }
+            observe_sensor(sock, &srv, sensor, secs);
+        }
         else
         {
             printf("Unknown command: %s\n", cmd);
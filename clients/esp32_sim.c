@@ -20,6 +20,8 @@
 // Retransmission policy (max 4 tries, exponential backoff)
 #define MAX_RETRIES 4
 #define INITIAL_WAIT_MS 2000
+#define SEPARATE_WAIT_MS 60000 // separate response after an empty ACK
+#define TOKEN_LEN 4
 
 /* -------------------------------
    Utility: generate random MID
@@ -29,19 +31,92 @@ static uint16_t random_mid(void)
     return (uint16_t)(rand() & 0xFFFF);
 }
 
+/* -------------------------------
+   Utility: monotonic clock in ms
+   ------------------------------- */
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Print p50/p99/max of the request latencies (first send -> ACK) */
+static void print_latency_summary(double *lat, int n, int sent)
+{
+    if (n == 0)
+    {
+        printf("[esp32_sim] latency: no successful requests (%d sent)\n", sent);
+        return;
+    }
+    qsort(lat, (size_t)n, sizeof(double), cmp_double);
+    int i50 = (n * 50) / 100;
+    int i99 = (n * 99) / 100;
+    if (i99 >= n)
+        i99 = n - 1;
+    printf("[esp32_sim] latency: ok=%d/%d p50=%.3f ms p99=%.3f ms max=%.3f ms\n",
+           n, sent, lat[i50], lat[i99], lat[n - 1]);
+}
+
+/* Wait up to timeout_ms for one datagram: length, 0 on timeout, -1 on error */
+static ssize_t wait_datagram(int sock, uint8_t *buf, size_t cap, int timeout_ms)
+{
+    fd_set rfds;
+    struct timeval tv;
+    FD_ZERO(&rfds);
+    FD_SET(sock, &rfds);
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int rv = select(sock + 1, &rfds, NULL, NULL, &tv);
+    if (rv == 0)
+        return 0;
+    if (rv < 0 || !FD_ISSET(sock, &rfds))
+        return -1;
+    struct sockaddr_in from;
+    socklen_t flen = sizeof(from);
+    ssize_t r = recvfrom(sock, buf, cap, 0, (struct sockaddr*)&from, &flen);
+    return r > 0 ? r : -1;
+}
+
+/* Acknowledge a separate CON response */
+static void send_empty_ack(int sock, struct sockaddr_in *srv, uint16_t mid)
+{
+    coap_message_t ack;
+    coap_init_message(&ack);
+    ack.version = COAP_VERSION;
+    ack.type = COAP_TYPE_ACK;
+    ack.code = COAP_CODE_EMPTY;
+    ack.message_id = mid;
+    uint8_t out[8];
+    int n = coap_serialize(&ack, out, sizeof(out));
+    if (n > 0)
+        sendto(sock, out, n, 0, (struct sockaddr*)srv, sizeof(*srv));
+}
+
 /* ----------------------------------------------------------
    Send a CoAP message and wait for an ACK from the server.
    - sock: UDP socket
    - srv: server address
    - msg: prepared CoAP message
    - timeout_ms: how long to wait
+   A piggybacked response arrives in the ACK. An empty ACK means
+   the server answers later with a separate CON carrying our token:
+   stop retransmitting, wait for it and acknowledge it.
    Returns:
-      0 -> ACK received and valid
+      0 -> ACK (or separate response) received and valid
       1 -> timeout (no response in time)
      -1 -> send error
      -2 -> received Reset (RST) message
      -3 -> parse/unexpected response
      -4 -> receive error
+     -5 -> separate response never arrived
    ---------------------------------------------------------- */
 static int send_coap_and_wait_ack(int sock, struct sockaddr_in *srv,
                                   coap_message_t *msg, int timeout_ms) 
@@ -54,52 +129,63 @@ static int send_coap_and_wait_ack(int sock, struct sockaddr_in *srv,
     if (sendto(sock, out, outlen, 0, (struct sockaddr*)srv, sizeof(*srv)) < 0)
         return -1;
 
-    // wait for reply with timeout
-    fd_set rfds;
-    struct timeval tv;
-    FD_ZERO(&rfds);
-    FD_SET(sock, &rfds);
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-    int rv = select(sock + 1, &rfds, NULL, NULL, &tv);
-    
-    if (rv > 0 && FD_ISSET(sock, &rfds)) 
+    int separate = 0;
+    while (1)
     {
-        // Response available
+        // wait for reply with timeout
         uint8_t in[MAX_BUF];
-        struct sockaddr_in from;
-        socklen_t flen = sizeof(from);
-        ssize_t r = recvfrom(sock, in, sizeof(in), 0, (struct sockaddr*)&from, &flen);
-        if (r > 0) 
+        ssize_t r = wait_datagram(sock, in, sizeof(in), separate ? SEPARATE_WAIT_MS : timeout_ms);
+        if (r == 0)
+            return separate ? -5 : 1; // timeout
+        if (r < 0)
+            return -4; // recv error
+
+        coap_message_t resp;
+        if (coap_parse(in, r, &resp) != COAP_OK)
+            return -3; // parse error
+
+        if (resp.type == COAP_TYPE_ACK && resp.message_id == msg->message_id)
+        {
+            if (resp.code == COAP_CODE_EMPTY)
+            {
+                // Request accepted, result follows as a separate response
+                separate = 1;
+                coap_free_message(&resp);
+                continue;
+            }
+            // Piggybacked response
+            printf("[esp32_sim] ACK MID=%u, Code=%u\n", resp.message_id, resp.code);
+            if (resp.payload_len > 0)
+                printf("[esp32_sim] Payload: %.*s\n",
+                       (int)resp.payload_len, resp.payload);
+            coap_free_message(&resp);
+            return 0;
+        }
+        if (resp.type == COAP_TYPE_CON)
         {
-            coap_message_t resp;
-            if (coap_parse(in, r, &resp) == COAP_OK) 
+            send_empty_ack(sock, srv, resp.message_id);
+            if (resp.tkl == msg->tkl && memcmp(resp.token, msg->token, msg->tkl) == 0)
             {
-                // Check if ACK matches our message
-                if (resp.type == COAP_TYPE_ACK && resp.message_id == msg->message_id) 
-                {
-                    printf("[esp32_sim] ACK MID=%u, Code=%u\n", resp.message_id, resp.code);
-                    if (resp.payload_len > 0)
-                        printf("[esp32_sim] Payload: %.*s\n",
-                               (int)resp.payload_len, resp.payload);
-                    coap_free_message(&resp);
-                    return 0;
-                } 
-                else if (resp.type == COAP_TYPE_RST) 
-                {
-                    // Server rejected/reset the message
-                    printf("[esp32_sim] Received RST (reset) MID=%u\n", resp.message_id);
-                    coap_free_message(&resp);
-                    return -2;
-                }
+                printf("[esp32_sim] Separate response MID=%u, Code=%u\n", resp.message_id, resp.code);
+                if (resp.payload_len > 0)
+                    printf("[esp32_sim] Payload: %.*s\n",
+                           (int)resp.payload_len, resp.payload);
                 coap_free_message(&resp);
+                return 0;
             }
-            return -3; // parse or unexpected
+            coap_free_message(&resp); // late response of an earlier request
+            continue;
+        }
+        if (resp.type == COAP_TYPE_RST)
+        {
+            // Server rejected/reset the message
+            printf("[esp32_sim] Received RST (reset) MID=%u\n", resp.message_id);
+            coap_free_message(&resp);
+            return -2;
         }
-        return -4; // recv error
+        coap_free_message(&resp);
+        return -3; // unexpected
     }
-    return 1; // timeout
 }
 
 /* -------------------------------
@@ -131,6 +217,10 @@ int main(int argc, char **argv)
         close(sock); return 1;
     }
 
+    // Per-request latency samples for the p50/p99 summary
+    double *latencies = calloc(runs > 0 ? (size_t)runs : 1, sizeof(double));
+    int ok = 0;
+
     // Main loop: send N messages
     for (int i=0;i<runs;i++) 
     {
@@ -140,6 +230,9 @@ int main(int argc, char **argv)
         msg.type = COAP_TYPE_CON;
         msg.code = COAP_CODE_POST;
         msg.message_id = random_mid();
+        msg.tkl = TOKEN_LEN;
+        for (int t = 0; t < TOKEN_LEN; t++)
+            msg.token[t] = (uint8_t)(rand() & 0xFF);
 
         // Add Uri-Path option
         coap_add_option(&msg, 11, (uint8_t*)uri_path, strlen(uri_path));
@@ -156,10 +249,16 @@ int main(int argc, char **argv)
 
         // Retransmission with exponential backoff
         int attempt = 0, wait_ms = INITIAL_WAIT_MS, rc = 1;
+        double t0 = now_ms();
         while (attempt < MAX_RETRIES) 
         {
             rc = send_coap_and_wait_ack(sock, &srv, &msg, wait_ms);
-            if (rc == 0) break; // success
+            if (rc == 0)
+            {
+                if (latencies)
+                    latencies[ok++] = now_ms() - t0;
+                break; // success
+            }
             if (rc == 1) 
             {
                 // Timeout -> retransmit
@@ -177,6 +276,9 @@ int main(int argc, char **argv)
         sleep(period_sec);
     }
 
+    if (latencies)
+        print_latency_summary(latencies, ok, runs);
+    free(latencies);
     close(sock);
     return 0;
 }
\ No newline at end of file
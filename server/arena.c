@@ -0,0 +1,103 @@
+#include "arena.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct arena_block
+{
+    arena_block_t *next;
+    _Alignas(8) uint8_t data[];
+};
+
+static _Thread_local arena_t *tls_arena = NULL;
+
+static _Atomic uint64_t total_requests = 0;
+static _Atomic uint64_t total_allocs = 0;
+static _Atomic uint64_t total_fallbacks = 0;
+
+arena_t *arena_thread(void)
+{
+    if (tls_arena)
+        return tls_arena;
+
+    arena_t *a = calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+    a->base = malloc(REQUEST_ARENA_SIZE);
+    if (!a->base)
+    {
+        free(a);
+        return NULL;
+    }
+    a->cap = REQUEST_ARENA_SIZE;
+    tls_arena = a;
+    return a;
+}
+
+void *arena_alloc(arena_t *a, size_t n)
+{
+    if (!a)
+        return NULL;
+    size_t aligned = (a->used + 7) & ~(size_t)7;
+    a->allocs++;
+    if (aligned + n <= a->cap)
+    {
+        a->used = aligned + n;
+        return a->base + aligned;
+    }
+
+    // Does not fit: heap block released by the next reset
+    arena_block_t *blk = malloc(sizeof(*blk) + n);
+    if (!blk)
+        return NULL;
+    blk->next = a->overflow;
+    a->overflow = blk;
+    a->fallbacks++;
+    return blk->data;
+}
+
+void *arena_alloc_fn(void *ctx, size_t n)
+{
+    return arena_alloc((arena_t *)ctx, n);
+}
+
+char *arena_strndup(arena_t *a, const char *s, size_t n)
+{
+    if (!s)
+        return NULL;
+    size_t len = strnlen(s, n);
+    char *out = arena_alloc(a, len + 1);
+    if (!out)
+        return NULL;
+    memcpy(out, s, len);
+    out[len] = '\0';
+    return out;
+}
+
+void arena_reset(arena_t *a)
+{
+    if (!a)
+        return;
+    while (a->overflow)
+    {
+        arena_block_t *next = a->overflow->next;
+        free(a->overflow);
+        a->overflow = next;
+    }
+    atomic_fetch_add_explicit(&total_requests, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&total_allocs, a->allocs, memory_order_relaxed);
+    atomic_fetch_add_explicit(&total_fallbacks, a->fallbacks, memory_order_relaxed);
+    a->used = 0;
+    a->allocs = 0;
+    a->fallbacks = 0;
+}
+
+void arena_get_stats(arena_stats_t *out)
+{
+    if (!out)
+        return;
+    out->requests = atomic_load_explicit(&total_requests, memory_order_relaxed);
+    out->allocs = atomic_load_explicit(&total_allocs, memory_order_relaxed);
+    out->fallbacks = atomic_load_explicit(&total_fallbacks, memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------
+   Request-scoped bump arena
+   -------------------------
+   Every worker thread owns one arena. handle_client allocates its scratch
+   strings, response payload, response options (through the codec allocator
+   hook, arena_alloc_fn) and oversized output buffer from it and resets it
+   once the response is sent, so a request costs no malloc/free pairs. Allocations that do not fit fall back to the heap and are released
+   by the next reset; they are counted so the arena can be sized.
+*/
+#define REQUEST_ARENA_SIZE (16 * 1024)
+
+typedef struct arena_block arena_block_t; // heap fallback, freed on reset
+
+typedef struct
+{
+    uint8_t *base;
+    size_t cap;
+    size_t used;
+    arena_block_t *overflow;
+    size_t allocs;      // allocations served since the last reset
+    size_t fallbacks;   // of which went to the heap
+} arena_t;
+
+typedef struct
+{
+    uint64_t requests;  // arena resets (one per request)
+    uint64_t allocs;    // total allocations
+    uint64_t fallbacks; // total heap fallbacks
+} arena_stats_t;
+
+/* Calling thread's arena (created on first use), or NULL if out of memory. */
+arena_t *arena_thread(void);
+
+/* 8-byte aligned allocation; never returns memory that outlives arena_reset. */
+void *arena_alloc(arena_t *a, size_t n);
+
+/* arena_alloc as a coap_alloc_fn (ctx is the arena_t). */
+void *arena_alloc_fn(void *ctx, size_t n);
+
+/* Copy n bytes of s into the arena and NUL-terminate. */
+char *arena_strndup(arena_t *a, const char *s, size_t n);
+
+/* Release everything allocated since the last reset and record the counts. */
+void arena_reset(arena_t *a);
+
+/* Process-wide counters accumulated by arena_reset. */
+void arena_get_stats(arena_stats_t *out);
+
+#endif // ARENA_H
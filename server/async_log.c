@@ -0,0 +1,256 @@
+#include "async_log.h"
+#include "mpmc_ring.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ASYNC_LOG_IDLE_MS 100 // writer sleep when nothing is queued (producers wake it earlier)
+
+typedef struct
+{
+    time_t sec;
+    const char *level; // string literal of the caller, NULL for a binary record
+    uint16_t len;
+    union
+    {
+        char text[ASYNC_LOG_LINE_MAX];
+        log_bin_record_t bin; // written as is
+    } u;
+} log_record_t;
+
+static struct
+{
+    FILE *out;
+    log_record_t *records;
+    mpmc_ring_t free_ring; // records a producer may fill
+    mpmc_ring_t full_ring; // records waiting for the writer
+    pthread_t thread;
+    pthread_mutex_t lock; // only for sleeping/waking the writer
+    pthread_cond_t wake;
+    _Atomic int sleeping;
+    _Atomic int running;
+    _Atomic uint64_t lines;
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t batches;
+} logger = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER};
+
+// "YYYY-MM-DD HH:MM:SS" of `sec`, reformatted only when the second changes
+static const char *cached_timestamp(time_t sec)
+{
+    static time_t cached_sec = (time_t)-1;
+    static char cached[32];
+    if (sec != cached_sec)
+    {
+        struct tm tmv;
+        localtime_r(&sec, &tmv);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &tmv);
+        cached_sec = sec;
+    }
+    return cached;
+}
+
+// Append one formatted line to the batch buffer; returns the new length
+static size_t append_line(char *buf, size_t len, size_t cap, time_t sec, const char *level, const char *text,
+                          size_t text_len)
+{
+    int n = snprintf(buf + len, cap - len, "[%s] %s: %.*s\n", cached_timestamp(sec), level, (int)text_len, text);
+    if (n < 0)
+        return len;
+    return (size_t)n < cap - len ? len + (size_t)n : cap - 1;
+}
+
+// Drain the queued records in batches. Returns the number of records written.
+static size_t drain(char *buf, size_t cap)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        size_t len = 0, count = 0;
+        log_record_t *rec;
+        while (count < ASYNC_LOG_BATCH && (rec = mpmc_ring_pop(&logger.full_ring)) != NULL)
+        {
+            if (rec->level)
+                len = append_line(buf, len, cap, rec->sec, rec->level, rec->u.text, rec->len);
+            else
+            {
+                memcpy(buf + len, &rec->u.bin, sizeof(rec->u.bin));
+                len += sizeof(rec->u.bin);
+            }
+            mpmc_ring_push(&logger.free_ring, rec);
+            count++;
+        }
+        if (count == 0)
+            return total;
+        fwrite(buf, 1, len, logger.out);
+        fflush(logger.out);
+        atomic_fetch_add_explicit(&logger.lines, count, memory_order_relaxed);
+        atomic_fetch_add_explicit(&logger.batches, 1, memory_order_relaxed);
+        total += count;
+    }
+}
+
+// Log how many lines were dropped since the last report
+static void report_drops(char *buf, size_t cap, uint64_t *reported)
+{
+    uint64_t drops = atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+    if (drops == *reported)
+        return;
+    char note[96];
+    int n = snprintf(note, sizeof(note), "log ring full, %llu lines dropped", (unsigned long long)(drops - *reported));
+    size_t len = append_line(buf, 0, cap, time(NULL), "ERROR", note, (size_t)n);
+    fwrite(buf, 1, len, logger.out);
+    fflush(logger.out);
+    *reported = drops;
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    size_t cap = ASYNC_LOG_BATCH * (ASYNC_LOG_LINE_MAX + 64);
+    char *buf = malloc(cap);
+    uint64_t reported_drops = 0;
+    if (!buf)
+        return NULL;
+    while (atomic_load_explicit(&logger.running, memory_order_acquire))
+    {
+        size_t written = drain(buf, cap);
+        report_drops(buf, cap, &reported_drops);
+        if (written > 0)
+            continue;
+
+        // Nothing queued: sleep until a producer wakes us (or the idle timeout)
+        pthread_mutex_lock(&logger.lock);
+        atomic_store_explicit(&logger.sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst); // pairs with the fence in async_log_vprintf
+        if (mpmc_ring_size(&logger.full_ring) == 0 && atomic_load_explicit(&logger.running, memory_order_acquire))
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += ASYNC_LOG_IDLE_MS * 1000000L;
+            if (until.tv_nsec >= 1000000000L)
+            {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&logger.wake, &logger.lock, &until);
+        }
+        atomic_store_explicit(&logger.sleeping, 0, memory_order_relaxed);
+        pthread_mutex_unlock(&logger.lock);
+    }
+    drain(buf, cap);
+    report_drops(buf, cap, &reported_drops);
+    free(buf);
+    return NULL;
+}
+
+int async_log_start(FILE *out, size_t capacity)
+{
+    if (!out || capacity == 0 || atomic_load(&logger.running))
+        return -1;
+    if (mpmc_ring_init(&logger.free_ring, capacity) != 0)
+        return -1;
+    capacity = mpmc_ring_capacity(&logger.free_ring);
+    logger.records = malloc(capacity * sizeof(*logger.records));
+    if (!logger.records || mpmc_ring_init(&logger.full_ring, capacity) != 0)
+    {
+        free(logger.records);
+        mpmc_ring_destroy(&logger.free_ring);
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++)
+        mpmc_ring_push(&logger.free_ring, &logger.records[i]);
+    logger.out = out;
+    atomic_store(&logger.sleeping, 0);
+    atomic_store(&logger.lines, 0);
+    atomic_store(&logger.dropped, 0);
+    atomic_store(&logger.batches, 0);
+    atomic_store(&logger.running, 1);
+    if (pthread_create(&logger.thread, NULL, writer_main, NULL) != 0)
+    {
+        atomic_store(&logger.running, 0);
+        mpmc_ring_destroy(&logger.full_ring);
+        mpmc_ring_destroy(&logger.free_ring);
+        free(logger.records);
+        return -1;
+    }
+    return 0;
+}
+
+void async_log_stop(void)
+{
+    if (!atomic_load(&logger.running))
+        return;
+    pthread_mutex_lock(&logger.lock);
+    atomic_store(&logger.running, 0);
+    pthread_cond_signal(&logger.wake);
+    pthread_mutex_unlock(&logger.lock);
+    pthread_join(logger.thread, NULL);
+    mpmc_ring_destroy(&logger.full_ring);
+    mpmc_ring_destroy(&logger.free_ring);
+    free(logger.records);
+    logger.records = NULL;
+    logger.out = NULL;
+}
+
+int async_log_active(const FILE *out)
+{
+    return out && out == logger.out && atomic_load_explicit(&logger.running, memory_order_acquire);
+}
+
+// Take a free record, or count the line as dropped
+static log_record_t *claim_record(void)
+{
+    log_record_t *rec = mpmc_ring_pop(&logger.free_ring);
+    if (!rec)
+        atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+    return rec;
+}
+
+// Hand a filled record to the writer
+static void queue_record(log_record_t *rec)
+{
+    mpmc_ring_push(&logger.full_ring, rec); // cannot fail: both rings hold every record
+
+    // The writer only needs a wake-up when it went to sleep on an empty ring
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&logger.sleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&logger.lock);
+        pthread_cond_signal(&logger.wake);
+        pthread_mutex_unlock(&logger.lock);
+    }
+}
+
+int async_log_vprintf(const char *level, const char *fmt, va_list ap)
+{
+    log_record_t *rec = claim_record();
+    if (!rec)
+        return -1;
+    rec->sec = time(NULL);
+    rec->level = level;
+    int n = vsnprintf(rec->u.text, sizeof(rec->u.text), fmt, ap);
+    rec->len = (uint16_t)(n < 0 ? 0 : (size_t)n < sizeof(rec->u.text) ? (size_t)n : sizeof(rec->u.text) - 1);
+    queue_record(rec);
+    return 0;
+}
+
+int async_log_write_binary(const log_bin_record_t *bin)
+{
+    log_record_t *rec = claim_record();
+    if (!rec)
+        return -1;
+    rec->level = NULL;
+    rec->u.bin = *bin;
+    queue_record(rec);
+    return 0;
+}
+
+void async_log_get_stats(async_log_stats_t *out)
+{
+    out->lines = atomic_load_explicit(&logger.lines, memory_order_relaxed);
+    out->dropped = atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+    out->batches = atomic_load_explicit(&logger.batches, memory_order_relaxed);
+}
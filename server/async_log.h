@@ -0,0 +1,51 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "log_format.h"
+
+/* -------------------------
+   Asynchronous logger
+   -------------------------
+   Workers format their line into a preallocated record and queue it; one
+   writer thread turns queued records into "[time] LEVEL: text" lines and
+   writes them to the log in batches, with one fflush per batch. Records move
+   between two lock-free rings (free records and queued ones), so a worker
+   never takes a lock or touches stdio. The writer formats the timestamp once
+   per second. When every record is queued the line is dropped and counted,
+   and the writer reports the drops in the log (as a text line, also when
+   the log holds binary records; the decoder passes it through).
+*/
+#define ASYNC_LOG_DEFAULT_CAPACITY 8192 // records in flight
+#define ASYNC_LOG_MAX_CAPACITY (1 << 20)
+#define ASYNC_LOG_LINE_MAX 256          // text per line (longer lines are cut)
+#define ASYNC_LOG_BATCH 64              // records per write
+
+typedef struct
+{
+    uint64_t lines;   // lines written
+    uint64_t dropped; // lines lost because the ring was full
+    uint64_t batches; // writes (each followed by one fflush)
+} async_log_stats_t;
+
+/* Start the writer thread for `out`. Returns 0 on success. */
+int async_log_start(FILE *out, size_t capacity);
+
+/* Write what is queued and stop the writer (log lines go straight to the file again). */
+void async_log_stop(void);
+
+/* 1 if lines for `out` go through the writer thread. */
+int async_log_active(const FILE *out);
+
+/* Queue one line. Returns 0, or -1 when it was dropped (ring full). */
+int async_log_vprintf(const char *level, const char *fmt, va_list ap);
+
+/* Queue one binary record, written to the log unchanged. Returns like async_log_vprintf. */
+int async_log_write_binary(const log_bin_record_t *rec);
+
+void async_log_get_stats(async_log_stats_t *out);
+
+#endif // ASYNC_LOG_H
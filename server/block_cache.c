@@ -0,0 +1,217 @@
+#include "block_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct block_snapshot
+{
+    block_snapshot_t *next;
+    uint32_t ip;
+    uint16_t port;
+    uint8_t tkl;
+    uint8_t token[8];
+    time_t expires;
+    uint8_t *body;
+    size_t len;
+    uint8_t etag_len;
+    uint8_t etag[BLOCK_ETAG_MAX];
+};
+
+static uint32_t block_hash(uint32_t ip, uint16_t port, const uint8_t *token, uint8_t tkl)
+{
+    uint32_t h = ip ^ ((uint32_t)port << 16) ^ tkl;
+    for (uint8_t i = 0; i < tkl; i++)
+        h = (h ^ token[i]) * 0x01000193U;
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    return h;
+}
+
+static block_stripe_t *block_slot(block_cache_t *cache, uint32_t ip, uint16_t port, const uint8_t *token,
+                                  uint8_t tkl, block_snapshot_t ***bucket)
+{
+    uint32_t h = block_hash(ip, port, token, tkl);
+    block_stripe_t *st = &cache->stripes[h % BLOCK_STRIPES];
+    *bucket = &st->buckets[(h / BLOCK_STRIPES) % BLOCK_BUCKETS_PER_STRIPE];
+    return st;
+}
+
+// Find a key in a bucket; returns the link pointing at it so it can be unlinked
+static block_snapshot_t **block_find(block_snapshot_t **pp, uint32_t ip, uint16_t port, const uint8_t *token,
+                                     uint8_t tkl)
+{
+    for (; *pp; pp = &(*pp)->next)
+    {
+        block_snapshot_t *s = *pp;
+        if (s->ip == ip && s->port == port && s->tkl == tkl && memcmp(s->token, token, tkl) == 0)
+            return pp;
+    }
+    return NULL;
+}
+
+// Unlink and free one snapshot (stripe lock held)
+static void block_unlink(block_cache_t *cache, block_snapshot_t **pp)
+{
+    block_snapshot_t *s = *pp;
+    *pp = s->next;
+    atomic_fetch_sub_explicit(&cache->snapshots, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&cache->bytes, s->len, memory_order_relaxed);
+    free(s->body);
+    free(s);
+}
+
+int block_cache_init(block_cache_t *cache)
+{
+    if (!cache)
+        return -1;
+    memset(cache, 0, sizeof(*cache));
+    for (size_t i = 0; i < BLOCK_STRIPES; i++)
+    {
+        if (pthread_mutex_init(&cache->stripes[i].lock, NULL) != 0)
+            return -1;
+    }
+    atomic_init(&cache->snapshots, 0);
+    atomic_init(&cache->bytes, 0);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->expired, 0);
+    return 0;
+}
+
+void block_cache_destroy(block_cache_t *cache)
+{
+    if (!cache)
+        return;
+    for (size_t i = 0; i < BLOCK_STRIPES; i++)
+    {
+        block_stripe_t *st = &cache->stripes[i];
+        for (size_t b = 0; b < BLOCK_BUCKETS_PER_STRIPE; b++)
+        {
+            while (st->buckets[b])
+                block_unlink(cache, &st->buckets[b]);
+        }
+        pthread_mutex_destroy(&st->lock);
+    }
+}
+
+int block_cache_put(block_cache_t *cache, const struct sockaddr_in *addr, const uint8_t *token, uint8_t tkl,
+                    const uint8_t *body, size_t len, const uint8_t *etag, size_t etag_len)
+{
+    if (tkl > sizeof(((block_snapshot_t *)0)->token) || len == 0 || etag_len > BLOCK_ETAG_MAX)
+        return -1;
+    uint32_t ip = addr->sin_addr.s_addr;
+    uint16_t port = addr->sin_port;
+    block_snapshot_t **bucket;
+    block_stripe_t *st = block_slot(cache, ip, port, token, tkl, &bucket);
+
+    // Copy outside the lock
+    block_snapshot_t *s = calloc(1, sizeof(*s));
+    uint8_t *copy = malloc(len);
+    if (!s || !copy)
+    {
+        free(s);
+        free(copy);
+        return -1;
+    }
+    memcpy(copy, body, len);
+    s->ip = ip;
+    s->port = port;
+    s->tkl = tkl;
+    memcpy(s->token, token, tkl);
+    s->expires = time(NULL) + BLOCK_SNAPSHOT_LIFETIME;
+    s->body = copy;
+    s->len = len;
+    s->etag_len = (uint8_t)etag_len;
+    if (etag_len)
+        memcpy(s->etag, etag, etag_len);
+
+    pthread_mutex_lock(&st->lock);
+    block_snapshot_t **old = block_find(bucket, ip, port, token, tkl);
+    if (old)
+        block_unlink(cache, old);
+    else if (atomic_load_explicit(&cache->snapshots, memory_order_relaxed) >= BLOCK_MAX_SNAPSHOTS)
+    {
+        pthread_mutex_unlock(&st->lock);
+        free(copy);
+        free(s);
+        return -1;
+    }
+    s->next = *bucket;
+    *bucket = s;
+    atomic_fetch_add_explicit(&cache->snapshots, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cache->bytes, len, memory_order_relaxed);
+    pthread_mutex_unlock(&st->lock);
+    return 0;
+}
+
+long block_cache_read(block_cache_t *cache, const struct sockaddr_in *addr, const uint8_t *token, uint8_t tkl,
+                      size_t offset, uint8_t *out, size_t cap, size_t *total, uint8_t etag[BLOCK_ETAG_MAX],
+                      size_t *etag_len)
+{
+    uint32_t ip = addr->sin_addr.s_addr;
+    uint16_t port = addr->sin_port;
+    block_snapshot_t **bucket;
+    block_stripe_t *st = block_slot(cache, ip, port, token, tkl, &bucket);
+    long n = -1;
+
+    pthread_mutex_lock(&st->lock);
+    block_snapshot_t **pp = block_find(bucket, ip, port, token, tkl);
+    if (pp && (*pp)->expires > time(NULL))
+    {
+        block_snapshot_t *s = *pp;
+        *total = s->len;
+        *etag_len = s->etag_len;
+        memcpy(etag, s->etag, s->etag_len);
+        n = 0;
+        if (offset < s->len)
+        {
+            size_t take = s->len - offset < cap ? s->len - offset : cap;
+            memcpy(out, s->body + offset, take);
+            n = (long)take;
+            if (offset + take == s->len)
+                block_unlink(cache, pp);
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+    atomic_fetch_add_explicit(n >= 0 ? &cache->hits : &cache->misses, 1, memory_order_relaxed);
+    return n;
+}
+
+void block_cache_sweep(block_cache_t *cache, time_t now)
+{
+    for (size_t i = 0; i < BLOCK_STRIPES; i++)
+    {
+        block_stripe_t *st = &cache->stripes[i];
+        uint64_t removed = 0;
+        pthread_mutex_lock(&st->lock);
+        for (size_t b = 0; b < BLOCK_BUCKETS_PER_STRIPE; b++)
+        {
+            block_snapshot_t **pp = &st->buckets[b];
+            while (*pp)
+            {
+                if ((*pp)->expires <= now)
+                {
+                    block_unlink(cache, pp);
+                    removed++;
+                }
+                else
+                {
+                    pp = &(*pp)->next;
+                }
+            }
+        }
+        pthread_mutex_unlock(&st->lock);
+        if (removed)
+            atomic_fetch_add_explicit(&cache->expired, removed, memory_order_relaxed);
+    }
+}
+
+void block_cache_get_stats(block_cache_t *cache, block_cache_stats_t *out)
+{
+    out->snapshots = atomic_load_explicit(&cache->snapshots, memory_order_relaxed);
+    out->bytes = atomic_load_explicit(&cache->bytes, memory_order_relaxed);
+    out->hits = atomic_load_explicit(&cache->hits, memory_order_relaxed);
+    out->misses = atomic_load_explicit(&cache->misses, memory_order_relaxed);
+    out->expired = atomic_load_explicit(&cache->expired, memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/* -------------------------
+   Block2 response snapshots
+   -------------------------
+   RFC 7959: a GET body larger than one block is sent block by block, each
+   block answering its own request. The full body produced for block 0 is
+   kept here, keyed by (client IPv4 address, port, token), so the following
+   blocks are sliced from the same bytes instead of querying SQLite again
+   (and cannot tear if rows change in between). The snapshot keeps the
+   ETag of block 0 so every later block carries it too. A snapshot is
+   dropped when its last block is read or after BLOCK_SNAPSHOT_LIFETIME.
+*/
+#define BLOCK_SNAPSHOT_LIFETIME 30 // seconds a transfer may take
+#define BLOCK_STRIPES 16
+#define BLOCK_BUCKETS_PER_STRIPE 64
+#define BLOCK_MAX_SNAPSHOTS 4096   // transfers tracked at most (later ones re-run their GET per block)
+#define BLOCK_ETAG_MAX 8           // longest ETag kept with a snapshot (RFC 7252 5.10.6)
+
+typedef struct block_snapshot block_snapshot_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    block_snapshot_t *buckets[BLOCK_BUCKETS_PER_STRIPE];
+} block_stripe_t;
+
+typedef struct
+{
+    block_stripe_t stripes[BLOCK_STRIPES];
+    _Atomic size_t snapshots;
+    _Atomic size_t bytes;
+    _Atomic uint64_t hits;    // blocks served from a snapshot
+    _Atomic uint64_t misses;  // later blocks without a snapshot
+    _Atomic uint64_t expired;
+} block_cache_t;
+
+typedef struct
+{
+    size_t snapshots;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expired;
+} block_cache_stats_t;
+
+int block_cache_init(block_cache_t *cache);
+
+void block_cache_destroy(block_cache_t *cache);
+
+/* Keep a copy of body and its ETag (etag_len 0 = none) for (addr, token),
+   replacing an older snapshot. Returns 0 on success. */
+int block_cache_put(block_cache_t *cache, const struct sockaddr_in *addr, const uint8_t *token, uint8_t tkl,
+                    const uint8_t *body, size_t len, const uint8_t *etag, size_t etag_len);
+
+/* Copy up to cap bytes of the snapshot starting at offset into out; *total is the
+   body size and etag, etag_len the ETag it was stored with. The snapshot is dropped
+   once its end was read. Returns the number of bytes copied (0 if offset is past
+   the end), or -1 when there is no snapshot. */
+long block_cache_read(block_cache_t *cache, const struct sockaddr_in *addr, const uint8_t *token, uint8_t tkl,
+                      size_t offset, uint8_t *out, size_t cap, size_t *total, uint8_t etag[BLOCK_ETAG_MAX],
+                      size_t *etag_len);
+
+/* Drop snapshots older than BLOCK_SNAPSHOT_LIFETIME. Called periodically. */
+void block_cache_sweep(block_cache_t *cache, time_t now);
+
+void block_cache_get_stats(block_cache_t *cache, block_cache_stats_t *out);
+
+#endif // BLOCK_CACHE_H
@@ -0,0 +1,213 @@
+#include "dedup.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct dedup_entry
+{
+    dedup_entry_t *next;
+    uint32_t ip;
+    uint16_t port;
+    uint16_t mid;
+    time_t expires;
+    int done;          // response stored (or none will come)
+    uint8_t *resp;
+    size_t resp_len;
+};
+
+static uint32_t dedup_hash(uint32_t ip, uint16_t port, uint16_t mid)
+{
+    uint32_t h = ip ^ ((uint32_t)port << 16) ^ mid;
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    h *= 0x846ca68bU;
+    h ^= h >> 16;
+    return h;
+}
+
+// Locate the stripe and bucket of a key; the stripe comes from the low bits,
+// the bucket from the next ones.
+static dedup_stripe_t *dedup_slot(dedup_cache_t *cache, uint32_t ip, uint16_t port, uint16_t mid,
+                                  dedup_entry_t ***bucket)
+{
+    uint32_t h = dedup_hash(ip, port, mid);
+    dedup_stripe_t *st = &cache->stripes[h % DEDUP_STRIPES];
+    *bucket = &st->buckets[(h / DEDUP_STRIPES) % DEDUP_BUCKETS_PER_STRIPE];
+    return st;
+}
+
+static dedup_entry_t *dedup_find(dedup_entry_t *e, uint32_t ip, uint16_t port, uint16_t mid)
+{
+    for (; e; e = e->next)
+        if (e->ip == ip && e->port == port && e->mid == mid)
+            return e;
+    return NULL;
+}
+
+int dedup_init(dedup_cache_t *cache, int lifetime)
+{
+    if (!cache || lifetime <= 0)
+        return -1;
+    memset(cache, 0, sizeof(*cache));
+    cache->lifetime = lifetime;
+    for (size_t i = 0; i < DEDUP_STRIPES; i++)
+    {
+        if (pthread_mutex_init(&cache->stripes[i].lock, NULL) != 0)
+            return -1;
+    }
+    atomic_init(&cache->entries, 0);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->inflight, 0);
+    atomic_init(&cache->expired, 0);
+    return 0;
+}
+
+void dedup_destroy(dedup_cache_t *cache)
+{
+    if (!cache)
+        return;
+    for (size_t i = 0; i < DEDUP_STRIPES; i++)
+    {
+        dedup_stripe_t *st = &cache->stripes[i];
+        for (size_t b = 0; b < DEDUP_BUCKETS_PER_STRIPE; b++)
+        {
+            dedup_entry_t *e = st->buckets[b];
+            while (e)
+            {
+                dedup_entry_t *next = e->next;
+                free(e->resp);
+                free(e);
+                e = next;
+            }
+            st->buckets[b] = NULL;
+        }
+        pthread_mutex_destroy(&st->lock);
+    }
+}
+
+dedup_result_t dedup_begin(dedup_cache_t *cache, const struct sockaddr_in *addr, uint16_t mid,
+                           dedup_send_fn send, void *ctx)
+{
+    uint32_t ip = addr->sin_addr.s_addr;
+    uint16_t port = addr->sin_port;
+    dedup_entry_t **bucket;
+    dedup_stripe_t *st = dedup_slot(cache, ip, port, mid, &bucket);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&st->lock);
+    dedup_entry_t *e = dedup_find(*bucket, ip, port, mid);
+    if (e && e->expires > now)
+    {
+        dedup_result_t r = DEDUP_IN_PROGRESS;
+        if (e->done)
+        {
+            if (e->resp_len > 0 && send)
+                send(ctx, e->resp, e->resp_len);
+            r = DEDUP_REPLAYED;
+            atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+        }
+        else
+        {
+            atomic_fetch_add_explicit(&cache->inflight, 1, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&st->lock);
+        return r;
+    }
+
+    atomic_fetch_add_explicit(&cache->misses, 1, memory_order_relaxed);
+    if (e)
+    {
+        // Stale entry for a reused Message ID: start the exchange over
+        free(e->resp);
+        e->resp = NULL;
+        e->resp_len = 0;
+        e->done = 0;
+        e->expires = now + cache->lifetime;
+    }
+    else if (atomic_load_explicit(&cache->entries, memory_order_relaxed) < DEDUP_MAX_ENTRIES &&
+             (e = calloc(1, sizeof(*e))) != NULL)
+    {
+        e->ip = ip;
+        e->port = port;
+        e->mid = mid;
+        e->expires = now + cache->lifetime;
+        e->next = *bucket;
+        *bucket = e;
+        atomic_fetch_add_explicit(&cache->entries, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&st->lock);
+    return DEDUP_NEW;
+}
+
+void dedup_complete(dedup_cache_t *cache, const struct sockaddr_in *addr, uint16_t mid,
+                    const uint8_t *resp, size_t len)
+{
+    uint32_t ip = addr->sin_addr.s_addr;
+    uint16_t port = addr->sin_port;
+    dedup_entry_t **bucket;
+    dedup_stripe_t *st = dedup_slot(cache, ip, port, mid, &bucket);
+
+    // Copy outside the lock; the entry may be gone (table full or swept)
+    uint8_t *copy = NULL;
+    if (resp && len > 0 && (copy = malloc(len)) != NULL)
+        memcpy(copy, resp, len);
+
+    pthread_mutex_lock(&st->lock);
+    dedup_entry_t *e = dedup_find(*bucket, ip, port, mid);
+    if (e && !e->done)
+    {
+        e->resp = copy;
+        e->resp_len = copy ? len : 0;
+        e->done = 1;
+        copy = NULL;
+    }
+    pthread_mutex_unlock(&st->lock);
+    free(copy);
+}
+
+void dedup_sweep(dedup_cache_t *cache, time_t now)
+{
+    for (size_t i = 0; i < DEDUP_STRIPES; i++)
+    {
+        dedup_stripe_t *st = &cache->stripes[i];
+        size_t removed = 0;
+        pthread_mutex_lock(&st->lock);
+        for (size_t b = 0; b < DEDUP_BUCKETS_PER_STRIPE; b++)
+        {
+            dedup_entry_t **pp = &st->buckets[b];
+            while (*pp)
+            {
+                dedup_entry_t *e = *pp;
+                // In-progress entries stay until their worker completes them
+                if (e->done && e->expires <= now)
+                {
+                    *pp = e->next;
+                    free(e->resp);
+                    free(e);
+                    removed++;
+                }
+                else
+                {
+                    pp = &e->next;
+                }
+            }
+        }
+        pthread_mutex_unlock(&st->lock);
+        if (removed)
+        {
+            atomic_fetch_sub_explicit(&cache->entries, removed, memory_order_relaxed);
+            atomic_fetch_add_explicit(&cache->expired, removed, memory_order_relaxed);
+        }
+    }
+}
+
+void dedup_get_stats(dedup_cache_t *cache, dedup_stats_t *out)
+{
+    out->entries = atomic_load_explicit(&cache->entries, memory_order_relaxed);
+    out->hits = atomic_load_explicit(&cache->hits, memory_order_relaxed);
+    out->misses = atomic_load_explicit(&cache->misses, memory_order_relaxed);
+    out->inflight = atomic_load_explicit(&cache->inflight, memory_order_relaxed);
+    out->expired = atomic_load_explicit(&cache->expired, memory_order_relaxed);
+}
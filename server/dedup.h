@@ -0,0 +1,84 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/* -------------------------
+   Message deduplication
+   -------------------------
+   RFC 7252 section 4.5: a retransmitted CON (or repeated NON) carries the
+   same Message ID from the same endpoint and must not be processed twice.
+   Exchanges are keyed by (client IPv4 address, port, Message ID) and kept
+   for EXCHANGE_LIFETIME. The first copy is processed and its serialized
+   response cached; later copies get the cached bytes resent (or are dropped
+   while the first one is still being processed). The table is split in
+   lock stripes so workers rarely contend.
+*/
+#define EXCHANGE_LIFETIME 247      // seconds, RFC 7252 section 4.8.2
+#define DEDUP_STRIPES 64
+#define DEDUP_BUCKETS_PER_STRIPE 256
+#define DEDUP_MAX_ENTRIES 65536    // exchanges remembered at most (new ones are not tracked past this)
+
+typedef struct dedup_entry dedup_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    dedup_entry_t *buckets[DEDUP_BUCKETS_PER_STRIPE];
+} dedup_stripe_t;
+
+typedef struct
+{
+    int lifetime;
+    dedup_stripe_t stripes[DEDUP_STRIPES];
+    _Atomic size_t entries;
+    _Atomic uint64_t hits;     // duplicates answered from the cache
+    _Atomic uint64_t misses;   // new exchanges
+    _Atomic uint64_t inflight; // duplicates dropped while the original was processed
+    _Atomic uint64_t expired;
+} dedup_cache_t;
+
+typedef struct
+{
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inflight;
+    uint64_t expired;
+} dedup_stats_t;
+
+typedef enum
+{
+    DEDUP_NEW = 0,     // first copy: process it, then call dedup_complete
+    DEDUP_REPLAYED,    // duplicate: the cached response was passed to the send callback
+    DEDUP_IN_PROGRESS  // duplicate of an exchange that has no response yet: drop it
+} dedup_result_t;
+
+/* Called with the cached response of a duplicate (under the stripe lock). */
+typedef void (*dedup_send_fn)(void *ctx, const uint8_t *data, size_t len);
+
+/* lifetime: seconds an exchange is remembered. Returns 0 on success. */
+int dedup_init(dedup_cache_t *cache, int lifetime);
+
+void dedup_destroy(dedup_cache_t *cache);
+
+/* Look up (addr, mid). A new exchange is recorded as in progress. */
+dedup_result_t dedup_begin(dedup_cache_t *cache, const struct sockaddr_in *addr, uint16_t mid,
+                           dedup_send_fn send, void *ctx);
+
+/* Store the serialized response of an exchange started by dedup_begin
+   (len 0 = no response was sent; duplicates are then dropped). */
+void dedup_complete(dedup_cache_t *cache, const struct sockaddr_in *addr, uint16_t mid,
+                    const uint8_t *resp, size_t len);
+
+/* Drop exchanges older than the lifetime. Called periodically. */
+void dedup_sweep(dedup_cache_t *cache, time_t now);
+
+void dedup_get_stats(dedup_cache_t *cache, dedup_stats_t *out);
+
+#endif // DEDUP_H
@@ -0,0 +1,77 @@
+#include "etag.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+static uint32_t boot_nonce;
+static _Atomic uint32_t record_gen[ETAG_SLOTS];
+static _Atomic uint32_t sensor_gen[ETAG_SLOTS];
+static _Atomic uint32_t table_gen;
+
+static _Atomic uint32_t *gen_slot(_Atomic uint32_t *gens, int key)
+{
+    uint32_t h = (uint32_t)key * 0x9e3779b1U;
+    return &gens[(h ^ (h >> 16)) % ETAG_SLOTS];
+}
+
+static void etag_pack(uint32_t gen, uint8_t out[ETAG_LEN])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (uint8_t)(boot_nonce >> (24 - 8 * i));
+        out[4 + i] = (uint8_t)(gen >> (24 - 8 * i));
+    }
+}
+
+void etag_init(uint32_t nonce)
+{
+    boot_nonce = nonce;
+}
+
+void etag_bump(int id)
+{
+    atomic_fetch_add_explicit(gen_slot(record_gen, id), 1, memory_order_release);
+    atomic_fetch_add_explicit(&table_gen, 1, memory_order_release);
+}
+
+void etag_bump_sensor(int sensor)
+{
+    atomic_fetch_add_explicit(gen_slot(sensor_gen, sensor), 1, memory_order_release);
+}
+
+void etag_for_record(int id, uint8_t out[ETAG_LEN])
+{
+    etag_pack(atomic_load_explicit(gen_slot(record_gen, id), memory_order_acquire), out);
+}
+
+void etag_for_sensor(int sensor, uint8_t out[ETAG_LEN])
+{
+    etag_pack(atomic_load_explicit(gen_slot(sensor_gen, sensor), memory_order_acquire), out);
+}
+
+void etag_for_table(uint8_t out[ETAG_LEN])
+{
+    etag_pack(atomic_load_explicit(&table_gen, memory_order_acquire), out);
+}
+
+int etag_request_matches(const coap_message_view_t *req, const uint8_t etag[ETAG_LEN])
+{
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        if (req->options[i].number == COAP_OPTION_ETAG && req->options[i].length == ETAG_LEN &&
+            memcmp(req->options[i].value, etag, ETAG_LEN) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+void etag_tag_response(coap_message_t *resp, const uint8_t etag[ETAG_LEN], uint32_t max_age)
+{
+    // Max-Age is a uint option: big-endian without leading zero bytes
+    uint8_t age[4] = {(uint8_t)(max_age >> 24), (uint8_t)(max_age >> 16), (uint8_t)(max_age >> 8), (uint8_t)max_age};
+    size_t skip = 0;
+    while (skip < sizeof(age) && age[skip] == 0)
+        skip++;
+    coap_add_option(resp, COAP_OPTION_ETAG, etag, ETAG_LEN);
+    coap_add_option(resp, COAP_OPTION_MAX_AGE, age + skip, sizeof(age) - skip);
+}
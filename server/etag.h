@@ -0,0 +1,47 @@
+#ifndef ETAG_H
+#define ETAG_H
+
+#include <stdint.h>
+#include "coap.h"
+
+/* -------------------------
+   Entity tags
+   -------------------------
+   An ETag names one version of a GET representation without reading it:
+   4 bytes of boot nonce (so tags from an earlier run never match) followed
+   by a 32-bit write generation. Records hash onto ETAG_SLOTS generation
+   counters; every write bumps its record's slot and the table generation,
+   which versions the list views (GET all, pages, time ranges). The latest
+   reading of a sensor has its own generation, bumped when it changes.
+   Records sharing a slot only cost each other an extra full response.
+   Writers bump after the row is committed and readers take the tag before
+   querying, so a tag may be older than the data it was sent with but never
+   newer.
+*/
+#define COAP_OPTION_ETAG 4
+#define COAP_OPTION_MAX_AGE 14
+#define ETAG_LEN 8
+#define ETAG_SLOTS 4096
+
+void etag_init(uint32_t nonce);
+
+/* A record was inserted, updated or deleted. */
+void etag_bump(int id);
+
+/* The latest reading of a sensor changed. */
+void etag_bump_sensor(int sensor);
+
+void etag_for_record(int id, uint8_t out[ETAG_LEN]);
+
+void etag_for_sensor(int sensor, uint8_t out[ETAG_LEN]);
+
+void etag_for_table(uint8_t out[ETAG_LEN]);
+
+/* 1 if one of the request's ETag options names `etag`: the client's copy is
+   current and the answer is 2.03 Valid without a payload. */
+int etag_request_matches(const coap_message_view_t *req, const uint8_t etag[ETAG_LEN]);
+
+/* Add the ETag and Max-Age (seconds) options to a 2.05 or 2.03 response. */
+void etag_tag_response(coap_message_t *resp, const uint8_t etag[ETAG_LEN], uint32_t max_age);
+
+#endif // ETAG_H
@@ -0,0 +1,285 @@
+#include "latest_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATEST_TS_LEN 20 // "YYYY-MM-DD HH:MM:SS"
+
+struct latest_entry
+{
+    latest_entry_t *next;    // sensor stripe chain
+    latest_entry_t *id_next; // row id stripe chain
+    int sensor;
+    int id;
+    char ts[LATEST_TS_LEN + 1];
+    size_t value_cap;
+    char *value;
+};
+
+static latest_stripe_t *latest_hash(latest_stripe_t *stripes, int key, latest_entry_t ***bucket)
+{
+    uint32_t h = (uint32_t)key * 0x9e3779b1U;
+    h ^= h >> 16;
+    latest_stripe_t *st = &stripes[h % LATEST_STRIPES];
+    *bucket = &st->buckets[(h / LATEST_STRIPES) % LATEST_BUCKETS_PER_STRIPE];
+    return st;
+}
+
+static latest_stripe_t *latest_slot(latest_cache_t *cache, int sensor, latest_entry_t ***bucket)
+{
+    return latest_hash(cache->stripes, sensor, bucket);
+}
+
+// Link an entry into the row id index under its current id (sensor stripe lock
+// held; the id stripe lock nests inside it). e->id only changes while unlinked.
+static void latest_index(latest_cache_t *cache, latest_entry_t *e)
+{
+    latest_entry_t **bucket;
+    latest_stripe_t *st = latest_hash(cache->ids, e->id, &bucket);
+    pthread_mutex_lock(&st->lock);
+    e->id_next = *bucket;
+    *bucket = e;
+    pthread_mutex_unlock(&st->lock);
+}
+
+static void latest_unindex(latest_cache_t *cache, latest_entry_t *e)
+{
+    latest_entry_t **pp;
+    latest_stripe_t *st = latest_hash(cache->ids, e->id, &pp);
+    pthread_mutex_lock(&st->lock);
+    for (; *pp; pp = &(*pp)->id_next)
+    {
+        if (*pp == e)
+        {
+            *pp = e->id_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+}
+
+// Newest first by timestamp, then by id, like the database's latest-row queries
+static int latest_is_newer(const latest_entry_t *e, int id, const char *ts)
+{
+    int c = strncmp(ts, e->ts, LATEST_TS_LEN);
+    return c > 0 || (c == 0 && id > e->id);
+}
+
+static latest_entry_t **latest_find(latest_entry_t **pp, int sensor)
+{
+    for (; *pp; pp = &(*pp)->next)
+    {
+        if ((*pp)->sensor == sensor)
+            return pp;
+    }
+    return NULL;
+}
+
+// Copy a reading into an entry, growing its value buffer when needed (stripe lock held)
+static int latest_fill(latest_entry_t *e, int id, const char *value, const char *ts)
+{
+    size_t len = strlen(value);
+    if (len + 1 > e->value_cap)
+    {
+        char *grown = realloc(e->value, len + 1);
+        if (!grown)
+            return -1;
+        e->value = grown;
+        e->value_cap = len + 1;
+    }
+    memcpy(e->value, value, len + 1);
+    snprintf(e->ts, sizeof(e->ts), "%s", ts);
+    e->id = id;
+    return 0;
+}
+
+int latest_cache_init(latest_cache_t *cache)
+{
+    if (!cache)
+        return -1;
+    memset(cache, 0, sizeof(*cache));
+    for (size_t i = 0; i < LATEST_STRIPES; i++)
+    {
+        if (pthread_mutex_init(&cache->stripes[i].lock, NULL) != 0 ||
+            pthread_mutex_init(&cache->ids[i].lock, NULL) != 0)
+            return -1;
+    }
+    atomic_init(&cache->sensors, 0);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->updates, 0);
+    return 0;
+}
+
+void latest_cache_destroy(latest_cache_t *cache)
+{
+    if (!cache)
+        return;
+    for (size_t i = 0; i < LATEST_STRIPES; i++)
+    {
+        latest_stripe_t *st = &cache->stripes[i];
+        for (size_t b = 0; b < LATEST_BUCKETS_PER_STRIPE; b++)
+        {
+            while (st->buckets[b])
+            {
+                latest_entry_t *e = st->buckets[b];
+                st->buckets[b] = e->next;
+                free(e->value);
+                free(e);
+            }
+        }
+        pthread_mutex_destroy(&st->lock);
+        memset(cache->ids[i].buckets, 0, sizeof(cache->ids[i].buckets));
+        pthread_mutex_destroy(&cache->ids[i].lock);
+    }
+    atomic_store(&cache->sensors, 0);
+}
+
+void latest_cache_set_loader(latest_cache_t *cache, latest_load_fn load)
+{
+    cache->load = load;
+}
+
+int latest_cache_put(latest_cache_t *cache, int sensor, int id, const char *value, const char *ts, int stale)
+{
+    latest_entry_t **bucket;
+    latest_stripe_t *st = latest_slot(cache, sensor, &bucket);
+    int rc = 0;
+
+    pthread_mutex_lock(&st->lock);
+    latest_entry_t **pp = latest_find(bucket, sensor);
+    if (pp)
+    {
+        latest_entry_t *e = *pp;
+        if (latest_is_newer(e, id, ts) || (stale > 0 && e->id == stale))
+        {
+            latest_unindex(cache, e);
+            rc = latest_fill(e, id, value, ts) == 0 ? 1 : -1;
+            latest_index(cache, e);
+        }
+    }
+    else if (atomic_load_explicit(&cache->sensors, memory_order_relaxed) >= LATEST_MAX_SENSORS)
+    {
+        rc = -1;
+    }
+    else
+    {
+        latest_entry_t *e = calloc(1, sizeof(*e));
+        if (e && latest_fill(e, id, value, ts) == 0)
+        {
+            e->sensor = sensor;
+            e->next = *bucket;
+            *bucket = e;
+            latest_index(cache, e);
+            atomic_fetch_add_explicit(&cache->sensors, 1, memory_order_relaxed);
+            rc = 1;
+        }
+        else
+        {
+            free(e);
+            rc = -1;
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+    if (rc == 1)
+        atomic_fetch_add_explicit(&cache->updates, 1, memory_order_relaxed);
+    return rc;
+}
+
+int latest_cache_remove(latest_cache_t *cache, int sensor, int id)
+{
+    latest_entry_t **bucket;
+    latest_stripe_t *st = latest_slot(cache, sensor, &bucket);
+    int removed = 0;
+
+    pthread_mutex_lock(&st->lock);
+    latest_entry_t **pp = latest_find(bucket, sensor);
+    if (pp && (*pp)->id == id)
+    {
+        latest_entry_t *e = *pp;
+        *pp = e->next;
+        latest_unindex(cache, e);
+        free(e->value);
+        free(e);
+        atomic_fetch_sub_explicit(&cache->sensors, 1, memory_order_relaxed);
+        removed = 1;
+    }
+    pthread_mutex_unlock(&st->lock);
+    return removed;
+}
+
+int latest_cache_sensor_of(latest_cache_t *cache, int id)
+{
+    latest_entry_t **bucket;
+    latest_stripe_t *st = latest_hash(cache->ids, id, &bucket);
+    int sensor = 0;
+
+    pthread_mutex_lock(&st->lock);
+    for (latest_entry_t *e = *bucket; e; e = e->id_next)
+    {
+        if (e->id == id)
+        {
+            sensor = e->sensor;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+    return sensor;
+}
+
+static int latest_print(char *out, size_t cap, int sensor, int id, const char *value, const char *ts)
+{
+    int n = snprintf(out, cap, "{\"sensor\":%d, \"id\":%d, \"value\":\"%s\", \"ts\":\"%s\"}", sensor, id, value, ts);
+    return n < 0 || (size_t)n >= cap ? -1 : n;
+}
+
+typedef struct
+{
+    latest_cache_t *cache;
+    char *out;
+    size_t cap;
+    int n;
+} latest_load_t;
+
+// Loader callback: format the reading for the caller and keep it if there is room
+static void latest_loaded(void *ctx, int sensor, int id, const char *value, const char *ts)
+{
+    latest_load_t *l = ctx;
+    l->n = latest_print(l->out, l->cap, sensor, id, value, ts);
+    latest_cache_put(l->cache, sensor, id, value, ts, 0);
+}
+
+int latest_cache_format(latest_cache_t *cache, int sensor, char *out, size_t cap)
+{
+    latest_entry_t **bucket;
+    latest_stripe_t *st = latest_slot(cache, sensor, &bucket);
+    int found = 0, n = 0;
+
+    pthread_mutex_lock(&st->lock);
+    latest_entry_t **pp = latest_find(bucket, sensor);
+    if (pp)
+    {
+        const latest_entry_t *e = *pp;
+        found = 1;
+        n = latest_print(out, cap, sensor, e->id, e->value, e->ts);
+    }
+    pthread_mutex_unlock(&st->lock);
+    atomic_fetch_add_explicit(found ? &cache->hits : &cache->misses, 1, memory_order_relaxed);
+    if (!found && cache->load)
+    {
+        latest_load_t l = {cache, out, cap, 0};
+        if (cache->load(sensor, latest_loaded, &l) < 0)
+            return -1;
+        n = l.n;
+    }
+    return n;
+}
+
+void latest_cache_get_stats(latest_cache_t *cache, latest_stats_t *out)
+{
+    out->sensors = atomic_load_explicit(&cache->sensors, memory_order_relaxed);
+    out->hits = atomic_load_explicit(&cache->hits, memory_order_relaxed);
+    out->misses = atomic_load_explicit(&cache->misses, memory_order_relaxed);
+    out->updates = atomic_load_explicit(&cache->updates, memory_order_relaxed);
+}
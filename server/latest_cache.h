@@ -0,0 +1,88 @@
+#ifndef LATEST_CACHE_H
+#define LATEST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* -------------------------
+   Latest reading per sensor
+   -------------------------
+   GET sensor/<n> answers with the newest reading of sensor n. Those readings
+   are kept in memory, hashed by sensor id into lock stripes: warmed from the
+   database at startup, replaced by every POST to sensor/<n> and reloaded when
+   a PUT or DELETE touches the row that is currently the newest. A lookup
+   copies the JSON out under one stripe lock and never reaches SQLite.
+   A sensor without an entry is asked of the loader (the database's
+   latest-reading query), which also serves the sensors that no longer fit.
+   Entries are indexed a second time by row id, in stripes of their own.
+*/
+#define LATEST_STRIPES 16
+#define LATEST_BUCKETS_PER_STRIPE 256
+#define LATEST_MAX_SENSORS 65536 // readings of further sensors are read from the loader on every GET
+
+typedef struct latest_entry latest_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    latest_entry_t *buckets[LATEST_BUCKETS_PER_STRIPE];
+} latest_stripe_t;
+
+/* Reports a sensor's newest reading, see db_latest_fn */
+typedef void (*latest_put_fn)(void *ctx, int sensor, int id, const char *value, const char *ts);
+
+/* Fallback for a sensor without an entry, with db_get_latest's contract: calls
+   put for the sensor's newest reading and returns how many it reported
+   (0 = the sensor has no readings), -1 on error */
+typedef int (*latest_load_fn)(int sensor, latest_put_fn put, void *ctx);
+
+typedef struct
+{
+    latest_stripe_t stripes[LATEST_STRIPES];
+    latest_stripe_t ids[LATEST_STRIPES]; // the same entries, hashed by row id
+    latest_load_fn load;
+    _Atomic size_t sensors;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t updates;
+} latest_cache_t;
+
+typedef struct
+{
+    size_t sensors;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t updates;
+} latest_stats_t;
+
+int latest_cache_init(latest_cache_t *cache);
+
+void latest_cache_destroy(latest_cache_t *cache);
+
+/* Ask load for sensors without an entry (NULL = they have no readings) */
+void latest_cache_set_loader(latest_cache_t *cache, latest_load_fn load);
+
+/* Store a reading of a sensor. It replaces the current one if that is older
+   (earlier timestamp, then lower id: the database's order) or if its id is
+   `stale` (a row that was just rewritten or deleted; 0 = none). ts is the
+   stored "YYYY-MM-DD HH:MM:SS" timestamp of the row.
+   Returns 1 if stored, 0 if a newer reading is kept, -1 on error. */
+int latest_cache_put(latest_cache_t *cache, int sensor, int id, const char *value, const char *ts, int stale);
+
+/* Drop the sensor's reading if it is still row `id`. Returns 1 if dropped. */
+int latest_cache_remove(latest_cache_t *cache, int sensor, int id);
+
+/* Sensor whose current reading is row `id`, 0 if none */
+int latest_cache_sensor_of(latest_cache_t *cache, int id);
+
+/* Write {"sensor":n, "id":x, "value":"...", "ts":"..."} into out (NUL-terminated),
+   from the loader when the sensor has no entry (storing what it returns if
+   there is room). Returns the length, 0 when the sensor has no reading, -1 if
+   cap is too small or the loader failed. */
+int latest_cache_format(latest_cache_t *cache, int sensor, char *out, size_t cap);
+
+void latest_cache_get_stats(latest_cache_t *cache, latest_stats_t *out);
+
+#endif // LATEST_CACHE_H
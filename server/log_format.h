@@ -0,0 +1,68 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+
+/* -------------------------
+   Log levels
+   -------------------------
+   A line is written when its level is at or below the current level, so
+   LOG_LEVEL_ERROR keeps only errors. Errors are never sampled out.
+*/
+typedef enum
+{
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_INFO = 1
+} log_level_t;
+
+#define LOG_LEVEL_MAX LOG_LEVEL_INFO
+
+static inline const char *log_level_name(int level)
+{
+    return level == LOG_LEVEL_ERROR ? "ERROR" : "INFO";
+}
+
+/* -------------------------
+   Binary log records
+   -------------------------
+   With --log-format binary every line is one fixed-size record instead of
+   text: the request summary keeps its fields as integers (no formatting at
+   all on the request path), any other line keeps its text, cut to fit.
+   Records are written in host byte order; tools/log_decode turns them back
+   into text lines. The magic lets the decoder skip anything else that ended
+   up in the file (e.g. stderr output of the server).
+*/
+#define LOG_BIN_MAGIC 0xC0A7
+#define LOG_BIN_RECORD_SIZE 128
+#define LOG_BIN_TEXT_LEN 112
+#define LOG_BIN_URI_LEN 108
+
+typedef enum
+{
+    LOG_BIN_TEXT = 1,    // u.text: NUL-padded line
+    LOG_BIN_REQUEST = 2  // u.request: "Processed MID=.. Code=.. Uri=.. Response=.."
+} log_bin_type_t;
+
+typedef struct
+{
+    uint16_t magic; // LOG_BIN_MAGIC
+    uint8_t type;   // log_bin_type_t
+    uint8_t level;  // log_level_t
+    uint32_t usec;  // microseconds within sec
+    int64_t sec;    // Unix time
+    union
+    {
+        char text[LOG_BIN_TEXT_LEN];
+        struct
+        {
+            uint16_t mid;
+            uint8_t method;   // request code
+            uint8_t response; // response code
+            char uri[LOG_BIN_URI_LEN];
+        } request;
+    } u;
+} log_bin_record_t;
+
+_Static_assert(sizeof(log_bin_record_t) == LOG_BIN_RECORD_SIZE, "binary log record size");
+
+#endif // LOG_FORMAT_H
@@ -0,0 +1,267 @@
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One block per recording thread. Only the owner writes it (load + store, no
+// read-modify-write); the relaxed atomics just keep concurrent readers from
+// seeing torn values.
+typedef struct
+{
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[METRICS_HIST_BUCKETS];
+} thread_hist_t;
+
+typedef struct metrics_thread
+{
+    struct metrics_thread *next;
+    _Atomic uint64_t requests[METRICS_METHODS][METRICS_CODES];
+    thread_hist_t latency[METRICS_STAGES][METRICS_METHODS];
+} metrics_thread_t;
+
+static _Atomic int enabled = 1;
+static _Atomic(metrics_thread_t *) threads = NULL; // blocks are never freed: threads live as long as the server
+static _Thread_local metrics_thread_t *tls_block = NULL;
+
+static const char *const method_names[METRICS_METHODS] = {"GET", "POST", "PUT", "DELETE", "other"};
+static const char *const stage_names[METRICS_STAGES] = {"parse", "db", "send", "total"};
+
+void metrics_set_enabled(int on)
+{
+    atomic_store_explicit(&enabled, on != 0, memory_order_relaxed);
+}
+
+int metrics_enabled(void)
+{
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+// Calling thread's block, created and published on first use
+static metrics_thread_t *metrics_thread(void)
+{
+    if (tls_block)
+        return tls_block;
+    metrics_thread_t *b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+    metrics_thread_t *head = atomic_load_explicit(&threads, memory_order_relaxed);
+    do
+        b->next = head;
+    while (!atomic_compare_exchange_weak_explicit(&threads, &head, b, memory_order_release, memory_order_relaxed));
+    tls_block = b;
+    return b;
+}
+
+static inline void add(_Atomic uint64_t *c, uint64_t v)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+size_t metrics_bucket(uint64_t ns)
+{
+    if (ns < (1u << METRICS_SUB_BITS))
+        return (size_t)ns;
+    int e = 63 - __builtin_clzll(ns); // >= METRICS_SUB_BITS
+    if (e > METRICS_MAX_EXP)
+        return METRICS_HIST_BUCKETS - 1;
+    size_t sub = (size_t)(ns >> (e - METRICS_SUB_BITS)) & ((1u << METRICS_SUB_BITS) - 1);
+    return ((size_t)(e - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + sub;
+}
+
+uint64_t metrics_bucket_low(size_t bucket)
+{
+    if (bucket < (1u << METRICS_SUB_BITS))
+        return bucket;
+    int e = (int)(bucket >> METRICS_SUB_BITS) + METRICS_SUB_BITS - 1;
+    uint64_t sub = bucket & ((1u << METRICS_SUB_BITS) - 1);
+    return ((1ull << METRICS_SUB_BITS) + sub) << (e - METRICS_SUB_BITS);
+}
+
+static int method_index(int code)
+{
+    switch (code)
+    {
+    case 1:
+        return METRICS_METHOD_GET;
+    case 2:
+        return METRICS_METHOD_POST;
+    case 3:
+        return METRICS_METHOD_PUT;
+    case 4:
+        return METRICS_METHOD_DELETE;
+    default:
+        return METRICS_METHOD_OTHER;
+    }
+}
+
+void metrics_record(int method_code, int response_code, const uint64_t stage_ns[METRICS_STAGES])
+{
+    if (!metrics_enabled())
+        return;
+    metrics_thread_t *b = metrics_thread();
+    if (!b)
+        return;
+    int m = method_index(method_code);
+    add(&b->requests[m][(uint8_t)response_code], 1);
+    for (int s = 0; s < METRICS_STAGES; s++)
+    {
+        thread_hist_t *h = &b->latency[s][m];
+        uint64_t ns = stage_ns[s];
+        add(&h->count, 1);
+        add(&h->sum_ns, ns);
+        if (ns > atomic_load_explicit(&h->max_ns, memory_order_relaxed))
+            atomic_store_explicit(&h->max_ns, ns, memory_order_relaxed);
+        add(&h->buckets[metrics_bucket(ns)], 1);
+    }
+}
+
+void metrics_snapshot(metrics_snapshot_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    for (metrics_thread_t *b = atomic_load_explicit(&threads, memory_order_acquire); b; b = b->next)
+    {
+        out->threads++;
+        for (int m = 0; m < METRICS_METHODS; m++)
+        {
+            for (int c = 0; c < METRICS_CODES; c++)
+                out->requests[m][c] += atomic_load_explicit(&b->requests[m][c], memory_order_relaxed);
+        }
+        for (int s = 0; s < METRICS_STAGES; s++)
+        {
+            for (int m = 0; m < METRICS_METHODS; m++)
+            {
+                const thread_hist_t *h = &b->latency[s][m];
+                metrics_hist_t *o = &out->latency[s][m];
+                o->count += atomic_load_explicit(&h->count, memory_order_relaxed);
+                o->sum_ns += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+                uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+                if (max > o->max_ns)
+                    o->max_ns = max;
+                for (size_t k = 0; k < METRICS_HIST_BUCKETS; k++)
+                    o->buckets[k] += atomic_load_explicit(&h->buckets[k], memory_order_relaxed);
+            }
+        }
+    }
+}
+
+uint64_t metrics_percentile(const metrics_hist_t *h, double q)
+{
+    // Bucket counts are read one by one while threads keep recording, so sum
+    // them instead of trusting h->count
+    uint64_t total = 0;
+    for (size_t k = 0; k < METRICS_HIST_BUCKETS; k++)
+        total += h->buckets[k];
+    if (total == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (double)total);
+    if (rank >= total)
+        rank = total - 1;
+    uint64_t seen = 0;
+    for (size_t k = 0; k < METRICS_HIST_BUCKETS; k++)
+    {
+        seen += h->buckets[k];
+        if (seen > rank)
+        {
+            uint64_t high = k + 1 < METRICS_HIST_BUCKETS ? metrics_bucket_low(k + 1) - 1 : h->max_ns;
+            return high < h->max_ns ? high : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+/* -------------------------
+   Formatting
+   ------------------------- */
+
+typedef struct
+{
+    char *buf;
+    size_t cap;
+    size_t len;
+    int overflow;
+} outbuf_t;
+
+static void put(outbuf_t *o, const char *fmt, ...)
+{
+    if (o->overflow)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= o->cap - o->len)
+        o->overflow = 1;
+    else
+        o->len += (size_t)n;
+}
+
+static double us(uint64_t ns)
+{
+    return (double)ns / 1000.0;
+}
+
+int metrics_format(const metrics_snapshot_t *s, int json, char *out, size_t cap)
+{
+    outbuf_t o = {out, cap, 0, cap == 0};
+    int first = 1;
+
+    if (json)
+        put(&o, "{\"threads\":%llu,\"requests\":[", (unsigned long long)s->threads);
+    else
+        put(&o, "threads %llu\n", (unsigned long long)s->threads);
+    for (int m = 0; m < METRICS_METHODS; m++)
+    {
+        for (int c = 0; c < METRICS_CODES; c++)
+        {
+            uint64_t n = s->requests[m][c];
+            if (n == 0)
+                continue;
+            if (json)
+                put(&o, "%s{\"method\":\"%s\",\"code\":\"%d.%02d\",\"count\":%llu}", first ? "" : ",",
+                    method_names[m], c >> 5, c & 0x1F, (unsigned long long)n);
+            else
+                put(&o, "requests method=%s code=%d.%02d count=%llu\n", method_names[m], c >> 5, c & 0x1F,
+                    (unsigned long long)n);
+            first = 0;
+        }
+    }
+
+    if (json)
+        put(&o, "],\"latency_us\":[");
+    first = 1;
+    for (int st = 0; st < METRICS_STAGES; st++)
+    {
+        for (int m = 0; m < METRICS_METHODS; m++)
+        {
+            const metrics_hist_t *h = &s->latency[st][m];
+            if (h->count == 0)
+                continue;
+            double mean = us(h->sum_ns) / (double)h->count;
+            double p50 = us(metrics_percentile(h, 0.50));
+            double p90 = us(metrics_percentile(h, 0.90));
+            double p99 = us(metrics_percentile(h, 0.99));
+            if (json)
+                put(&o,
+                    "%s{\"stage\":\"%s\",\"method\":\"%s\",\"count\":%llu,\"mean\":%.2f,\"p50\":%.2f,\"p90\":%.2f,"
+                    "\"p99\":%.2f,\"max\":%.2f}",
+                    first ? "" : ",", stage_names[st], method_names[m], (unsigned long long)h->count, mean, p50, p90,
+                    p99, us(h->max_ns));
+            else
+                put(&o,
+                    "latency stage=%s method=%s count=%llu mean_us=%.2f p50_us=%.2f p90_us=%.2f p99_us=%.2f "
+                    "max_us=%.2f\n",
+                    stage_names[st], method_names[m], (unsigned long long)h->count, mean, p50, p90, p99,
+                    us(h->max_ns));
+            first = 0;
+        }
+    }
+    if (json)
+        put(&o, "]}");
+
+    return o.overflow ? -1 : (int)o.len;
+}
@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* -------------------------
+   Request metrics
+   -------------------------
+   Every worker thread counts its requests by method and response code and
+   records how long each stage took (parse, DB work, send, and the whole
+   request) in log-linear latency histograms. The counters live in a block
+   owned by the thread: recording is a few plain loads and stores, no lock
+   and no shared cache line. GET .well-known/metrics sums the blocks of all
+   threads on demand and answers with a compact text or JSON summary.
+
+   Histogram buckets are powers of two split into 2^METRICS_SUB_BITS linear
+   steps, so every bucket is at most 25% wide, from 1 ns up to ~18 minutes.
+*/
+#define METRICS_PATH ".well-known/metrics"
+#define METRICS_SUB_BITS 2
+#define METRICS_MAX_EXP 40 // 2^40 ns; slower samples land in the last bucket
+#define METRICS_HIST_BUCKETS ((METRICS_MAX_EXP - METRICS_SUB_BITS + 2) << METRICS_SUB_BITS)
+#define METRICS_CODES 256 // one counter per CoAP code byte
+#define METRICS_BODY_MAX 8192 // largest formatted summary (sent block-wise)
+
+typedef enum
+{
+    METRICS_STAGE_PARSE, // datagram -> parsed request
+    METRICS_STAGE_DB,    // method dispatch: database and in-memory caches
+    METRICS_STAGE_SEND,  // serialize and hand to the transmit batch
+    METRICS_STAGE_TOTAL, // whole request
+    METRICS_STAGES
+} metrics_stage_t;
+
+typedef enum
+{
+    METRICS_METHOD_GET,
+    METRICS_METHOD_POST,
+    METRICS_METHOD_PUT,
+    METRICS_METHOD_DELETE,
+    METRICS_METHOD_OTHER,
+    METRICS_METHODS
+} metrics_method_t;
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[METRICS_HIST_BUCKETS];
+} metrics_hist_t;
+
+typedef struct
+{
+    uint64_t threads; // threads that recorded at least one request
+    uint64_t requests[METRICS_METHODS][METRICS_CODES];
+    metrics_hist_t latency[METRICS_STAGES][METRICS_METHODS];
+} metrics_snapshot_t;
+
+/* Turn recording on or off (on by default). */
+void metrics_set_enabled(int enabled);
+int metrics_enabled(void);
+
+/* Monotonic nanoseconds, or 0 while recording is off. */
+static inline uint64_t metrics_now(void)
+{
+    if (!metrics_enabled())
+        return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Record one request on the calling thread's block. stage_ns holds the
+   duration of every stage; nothing is recorded while metrics are off. */
+void metrics_record(int method_code, int response_code, const uint64_t stage_ns[METRICS_STAGES]);
+
+/* Histogram bucket of a duration, and the smallest duration of a bucket. */
+size_t metrics_bucket(uint64_t ns);
+uint64_t metrics_bucket_low(size_t bucket);
+
+/* Sum the blocks of all threads into out. */
+void metrics_snapshot(metrics_snapshot_t *out);
+
+/* Upper bound of the bucket holding quantile q (0..1), capped at the maximum. */
+uint64_t metrics_percentile(const metrics_hist_t *h, double q);
+
+/* Non-empty counters and histograms as "key=value" text lines or JSON.
+   Returns the length, or -1 when out is too small. */
+int metrics_format(const metrics_snapshot_t *s, int json, char *out, size_t cap);
+
+#endif // METRICS_H
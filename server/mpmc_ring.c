@@ -0,0 +1,117 @@
+#include "mpmc_ring.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+int mpmc_ring_init(mpmc_ring_t *ring, size_t capacity)
+{
+    if (!ring || capacity == 0)
+        return -1;
+
+    size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+
+    ring->cells = malloc(cap * sizeof(*ring->cells));
+    if (!ring->cells)
+        return -1;
+    for (size_t i = 0; i < cap; i++)
+    {
+        atomic_init(&ring->cells[i].seq, i);
+        ring->cells[i].data = NULL;
+    }
+    ring->mask = cap - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+void mpmc_ring_destroy(mpmc_ring_t *ring)
+{
+    if (!ring)
+        return;
+    free(ring->cells);
+    ring->cells = NULL;
+    ring->mask = 0;
+}
+
+// A producer claims position `pos` by CAS on head, writes the item, then
+// publishes it by setting the cell sequence to pos + 1.
+int mpmc_ring_push(mpmc_ring_t *ring, void *item)
+{
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;)
+    {
+        mpmc_cell_t *cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                cell->data = item;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        }
+        else if (diff < 0)
+        {
+            return -1; // full
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+// A consumer claims position `pos` by CAS on tail, reads the item, then
+// frees the cell for the producer one lap ahead (seq = pos + capacity).
+void *mpmc_ring_pop(mpmc_ring_t *ring)
+{
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;)
+    {
+        mpmc_cell_t *cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                void *item = cell->data;
+                atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+                return item;
+            }
+        }
+        else if (diff < 0)
+        {
+            return NULL; // empty
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+int mpmc_ring_has_room(mpmc_ring_t *ring)
+{
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t seq = atomic_load_explicit(&ring->cells[pos & ring->mask].seq, memory_order_acquire);
+    return seq == pos;
+}
+
+size_t mpmc_ring_size(mpmc_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return head >= tail ? head - tail : 0;
+}
+
+size_t mpmc_ring_capacity(const mpmc_ring_t *ring)
+{
+    return ring->mask + 1;
+}
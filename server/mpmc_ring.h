@@ -0,0 +1,49 @@
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* -------------------------
+   Bounded MPMC ring buffer
+   -------------------------
+   Lock-free multi-producer / multi-consumer queue of pointers
+   (Vyukov's bounded queue). Each cell carries a sequence number that tells
+   producers and consumers whether the slot is free or published, so no
+   locks are taken on the push/pop path.
+*/
+typedef struct
+{
+    _Atomic size_t seq;
+    void *data;
+} mpmc_cell_t;
+
+typedef struct
+{
+    mpmc_cell_t *cells;
+    size_t mask;                   // capacity - 1 (capacity is a power of two)
+    _Alignas(64) _Atomic size_t head; // next enqueue position
+    _Alignas(64) _Atomic size_t tail; // next dequeue position
+} mpmc_ring_t;
+
+/* Allocate the ring. Capacity is rounded up to a power of two. Returns 0 on success. */
+int mpmc_ring_init(mpmc_ring_t *ring, size_t capacity);
+
+void mpmc_ring_destroy(mpmc_ring_t *ring);
+
+/* Push an item. Returns 0 on success, -1 if the ring is full. */
+int mpmc_ring_push(mpmc_ring_t *ring, void *item);
+
+/* Pop an item. Returns NULL if the ring is (momentarily) empty. */
+void *mpmc_ring_pop(mpmc_ring_t *ring);
+
+/* Nonzero when the next push finds a free cell. Exact for a single producer:
+   no other thread can fill that cell before the producer's own next push. */
+int mpmc_ring_has_room(mpmc_ring_t *ring);
+
+/* Approximate number of queued items (exact when no push/pop is in flight). */
+size_t mpmc_ring_size(mpmc_ring_t *ring);
+
+size_t mpmc_ring_capacity(const mpmc_ring_t *ring);
+
+#endif // MPMC_RING_H
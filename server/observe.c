@@ -0,0 +1,356 @@
+#include "observe.h"
+#include "coap.h"
+#include "etag.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OBSERVE_STACK_WIRE 1280 // notifications up to this size are built on the stack
+
+struct observer
+{
+    observer_t *next;
+    int sensor;
+    int sock;
+    struct sockaddr_in addr;
+    uint8_t tkl;
+    uint8_t token[COAP_MAX_TOKEN_LEN];
+    uint16_t last_mid; // Message ID of the latest notification
+    time_t confirmed;  // registration or latest ACKed CON notification
+    int con_pending;   // last_mid is a CON notification the tracker is retransmitting
+};
+
+static observe_stripe_t *observe_slot(observe_registry_t *reg, int sensor, observer_t ***bucket)
+{
+    uint32_t h = (uint32_t)sensor * 0x9e3779b1U;
+    h ^= h >> 16;
+    observe_stripe_t *st = &reg->stripes[h % OBSERVE_STRIPES];
+    *bucket = &st->buckets[(h / OBSERVE_STRIPES) % OBSERVE_BUCKETS_PER_STRIPE];
+    return st;
+}
+
+static observer_t **observe_find(observer_t **pp, int sensor, const struct sockaddr_in *addr, const uint8_t *token,
+                                 uint8_t tkl)
+{
+    for (; *pp; pp = &(*pp)->next)
+    {
+        observer_t *o = *pp;
+        if (o->sensor == sensor && o->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            o->addr.sin_port == addr->sin_port && o->tkl == tkl && memcmp(o->token, token, tkl) == 0)
+            return pp;
+    }
+    return NULL;
+}
+
+// Stop retransmitting the observer's outstanding CON notification (stripe lock held)
+static void observe_settle(observe_registry_t *reg, observer_t *o)
+{
+    if (o->con_pending && reg->retx)
+        retx_ack(reg->retx, &o->addr, o->last_mid);
+    o->con_pending = 0;
+}
+
+// Unlink and free one observer (stripe lock held)
+static void observe_unlink(observe_registry_t *reg, observer_t **pp)
+{
+    observer_t *o = *pp;
+    observe_settle(reg, o);
+    *pp = o->next;
+    free(o);
+    atomic_fetch_sub_explicit(&reg->observers, 1, memory_order_relaxed);
+}
+
+int observe_init(observe_registry_t *reg, observe_send_fn send, _Atomic unsigned int *next_mid)
+{
+    if (!reg || !send || !next_mid)
+        return -1;
+    memset(reg, 0, sizeof(*reg));
+    for (size_t i = 0; i < OBSERVE_STRIPES; i++)
+    {
+        if (pthread_mutex_init(&reg->stripes[i].lock, NULL) != 0)
+            return -1;
+    }
+    reg->send = send;
+    reg->next_mid = next_mid;
+    reg->con_interval = OBSERVE_CON_INTERVAL;
+    atomic_init(&reg->seq, 2); // registration responses carry the current value, notifications count up
+    atomic_init(&reg->observers, 0);
+    atomic_init(&reg->notifications, 0);
+    atomic_init(&reg->sent, 0);
+    atomic_init(&reg->cancelled, 0);
+    atomic_init(&reg->expired, 0);
+    return 0;
+}
+
+void observe_destroy(observe_registry_t *reg)
+{
+    if (!reg)
+        return;
+    for (size_t i = 0; i < OBSERVE_STRIPES; i++)
+    {
+        observe_stripe_t *st = &reg->stripes[i];
+        for (size_t b = 0; b < OBSERVE_BUCKETS_PER_STRIPE; b++)
+        {
+            while (st->buckets[b])
+                observe_unlink(reg, &st->buckets[b]);
+        }
+        pthread_mutex_destroy(&st->lock);
+    }
+}
+
+int observe_register(observe_registry_t *reg, int sensor, int sock, const struct sockaddr_in *addr,
+                     const uint8_t *token, uint8_t tkl)
+{
+    if (tkl > COAP_MAX_TOKEN_LEN)
+        return -1;
+    observer_t **bucket;
+    observe_stripe_t *st = observe_slot(reg, sensor, &bucket);
+    int rc = 0;
+
+    pthread_mutex_lock(&st->lock);
+    observer_t **pp = observe_find(bucket, sensor, addr, token, tkl);
+    if (pp)
+    {
+        (*pp)->sock = sock; // re-registration: keep the entry, the client is alive
+        (*pp)->confirmed = time(NULL);
+        observe_settle(reg, *pp);
+    }
+    else if (atomic_load_explicit(&reg->observers, memory_order_relaxed) >= OBSERVE_MAX_OBSERVERS)
+    {
+        rc = -1;
+    }
+    else
+    {
+        observer_t *o = calloc(1, sizeof(*o));
+        if (o)
+        {
+            o->sensor = sensor;
+            o->sock = sock;
+            o->addr = *addr;
+            o->tkl = tkl;
+            memcpy(o->token, token, tkl);
+            o->confirmed = time(NULL);
+            o->next = *bucket;
+            *bucket = o;
+            atomic_fetch_add_explicit(&reg->observers, 1, memory_order_relaxed);
+        }
+        else
+        {
+            rc = -1;
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+    return rc;
+}
+
+int observe_cancel(observe_registry_t *reg, int sensor, const struct sockaddr_in *addr, const uint8_t *token,
+                   uint8_t tkl)
+{
+    observer_t **bucket;
+    observe_stripe_t *st = observe_slot(reg, sensor, &bucket);
+    int found = 0;
+
+    pthread_mutex_lock(&st->lock);
+    observer_t **pp = observe_find(bucket, sensor, addr, token, tkl);
+    if (pp)
+    {
+        observe_unlink(reg, pp);
+        found = 1;
+    }
+    pthread_mutex_unlock(&st->lock);
+    if (found)
+        atomic_fetch_add_explicit(&reg->cancelled, 1, memory_order_relaxed);
+    return found;
+}
+
+int observe_cancel_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid)
+{
+    // RSTs are rare: walk every stripe rather than index by Message ID
+    for (size_t i = 0; i < OBSERVE_STRIPES; i++)
+    {
+        observe_stripe_t *st = &reg->stripes[i];
+        pthread_mutex_lock(&st->lock);
+        for (size_t b = 0; b < OBSERVE_BUCKETS_PER_STRIPE; b++)
+        {
+            for (observer_t **pp = &st->buckets[b]; *pp; pp = &(*pp)->next)
+            {
+                observer_t *o = *pp;
+                if (o->last_mid == mid && o->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+                    o->addr.sin_port == addr->sin_port)
+                {
+                    observe_unlink(reg, pp);
+                    pthread_mutex_unlock(&st->lock);
+                    atomic_fetch_add_explicit(&reg->cancelled, 1, memory_order_relaxed);
+                    return 1;
+                }
+            }
+        }
+        pthread_mutex_unlock(&st->lock);
+    }
+    return 0;
+}
+
+int observe_ack_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid)
+{
+    // Like RSTs, ACKs come at most once per con_interval per observer
+    for (size_t i = 0; i < OBSERVE_STRIPES; i++)
+    {
+        observe_stripe_t *st = &reg->stripes[i];
+        pthread_mutex_lock(&st->lock);
+        for (size_t b = 0; b < OBSERVE_BUCKETS_PER_STRIPE; b++)
+        {
+            for (observer_t *o = st->buckets[b]; o; o = o->next)
+            {
+                if (o->con_pending && o->last_mid == mid && o->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+                    o->addr.sin_port == addr->sin_port)
+                {
+                    o->confirmed = time(NULL);
+                    o->con_pending = 0;
+                    pthread_mutex_unlock(&st->lock);
+                    return 1;
+                }
+            }
+        }
+        pthread_mutex_unlock(&st->lock);
+    }
+    return 0;
+}
+
+int observe_expire_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid)
+{
+    for (size_t i = 0; i < OBSERVE_STRIPES; i++)
+    {
+        observe_stripe_t *st = &reg->stripes[i];
+        pthread_mutex_lock(&st->lock);
+        for (size_t b = 0; b < OBSERVE_BUCKETS_PER_STRIPE; b++)
+        {
+            for (observer_t **pp = &st->buckets[b]; *pp; pp = &(*pp)->next)
+            {
+                observer_t *o = *pp;
+                if (o->con_pending && o->last_mid == mid && o->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+                    o->addr.sin_port == addr->sin_port)
+                {
+                    observe_unlink(reg, pp);
+                    pthread_mutex_unlock(&st->lock);
+                    atomic_fetch_add_explicit(&reg->expired, 1, memory_order_relaxed);
+                    return 1;
+                }
+            }
+        }
+        pthread_mutex_unlock(&st->lock);
+    }
+    return 0;
+}
+
+uint32_t observe_seq(observe_registry_t *reg)
+{
+    return atomic_load_explicit(&reg->seq, memory_order_relaxed) & 0xFFFFFF;
+}
+
+// Big-endian value without leading zero bytes (uint options, RFC 7252 3.2)
+static size_t uint_option(uint32_t v, uint8_t out[4])
+{
+    uint8_t buf[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    size_t skip = 0;
+    while (skip < sizeof(buf) && buf[skip] == 0)
+        skip++;
+    memcpy(out, buf + skip, sizeof(buf) - skip);
+    return sizeof(buf) - skip;
+}
+
+size_t observe_notify(observe_registry_t *reg, int sensor, const uint8_t *etag, size_t etag_len, uint32_t max_age,
+                      const uint8_t *payload, size_t len)
+{
+    if (atomic_load_explicit(&reg->observers, memory_order_relaxed) == 0)
+        return 0;
+    observer_t **bucket;
+    observe_stripe_t *st = observe_slot(reg, sensor, &bucket);
+    size_t n = 0;
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&st->lock);
+    observer_t *o = *bucket;
+    while (o && o->sensor != sensor)
+        o = o->next;
+    if (!o)
+    {
+        pthread_mutex_unlock(&st->lock);
+        return 0;
+    }
+
+    // Serialize once without a token, COAP_MAX_TOKEN_LEN bytes into the buffer.
+    // Each observer's header and token are then written right in front of the
+    // shared options and payload.
+    uint32_t seq = (atomic_fetch_add_explicit(&reg->seq, 1, memory_order_relaxed) + 1) & 0xFFFFFF;
+    uint8_t seq_val[4], age_val[4];
+    coap_message_t m;
+    coap_init_message(&m);
+    m.version = COAP_VERSION;
+    m.type = COAP_TYPE_NON;
+    m.code = COAP_CODE_CONTENT;
+    if (etag_len > 0)
+        coap_add_option(&m, COAP_OPTION_ETAG, etag, etag_len);
+    coap_add_option(&m, COAP_OPTION_OBSERVE, seq_val, uint_option(seq, seq_val));
+    coap_add_option(&m, COAP_OPTION_MAX_AGE, age_val, uint_option(max_age, age_val));
+    m.payload = (uint8_t *)payload;
+    m.payload_len = len;
+
+    uint8_t stack_wire[OBSERVE_STACK_WIRE];
+    size_t size = coap_serialized_size(&m);
+    uint8_t *wire = size + COAP_MAX_TOKEN_LEN <= sizeof(stack_wire) ? stack_wire
+                                                                     : malloc(size + COAP_MAX_TOKEN_LEN);
+    int wlen = wire ? coap_serialize(&m, wire + COAP_MAX_TOKEN_LEN, size) : -1;
+    m.payload = NULL; // not owned
+    coap_free_message(&m);
+
+    if (wlen > 0)
+    {
+        for (o = *bucket; o; o = o->next)
+        {
+            if (o->sensor != sensor)
+                continue;
+            int con = o->con_pending || now - o->confirmed >= reg->con_interval;
+            uint8_t *p = wire + COAP_MAX_TOKEN_LEN - o->tkl;
+            // Same header layout as coap_serialize
+            uint16_t mid = (uint16_t)atomic_fetch_add_explicit(reg->next_mid, 1, memory_order_relaxed);
+            p[0] = (uint8_t)((COAP_VERSION << 6) | ((con ? COAP_TYPE_CON : COAP_TYPE_NON) << 4) | o->tkl);
+            p[1] = COAP_CODE_CONTENT;
+            p[2] = (uint8_t)(mid >> 8);
+            p[3] = (uint8_t)(mid & 0xFF);
+            memcpy(p + 4, o->token, o->tkl);
+            reg->send(o->sock, &o->addr, p, (size_t)wlen + o->tkl);
+            // The tracker lock nests inside the stripe lock; the tracker calls
+            // observe_expire_mid without its own
+            if (con && reg->retx)
+            {
+                if (o->con_pending)
+                    retx_replace(reg->retx, o->sock, &o->addr, o->last_mid, mid, p, (size_t)wlen + o->tkl);
+                else
+                    retx_add(reg->retx, o->sock, &o->addr, mid, p, (size_t)wlen + o->tkl);
+            }
+            o->con_pending = con;
+            o->last_mid = mid;
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&st->lock);
+    if (wire != stack_wire)
+        free(wire);
+
+    if (n)
+    {
+        atomic_fetch_add_explicit(&reg->notifications, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&reg->sent, n, memory_order_relaxed);
+    }
+    return n;
+}
+
+void observe_get_stats(observe_registry_t *reg, observe_stats_t *out)
+{
+    out->observers = atomic_load_explicit(&reg->observers, memory_order_relaxed);
+    out->notifications = atomic_load_explicit(&reg->notifications, memory_order_relaxed);
+    out->sent = atomic_load_explicit(&reg->sent, memory_order_relaxed);
+    out->cancelled = atomic_load_explicit(&reg->cancelled, memory_order_relaxed);
+    out->expired = atomic_load_explicit(&reg->expired, memory_order_relaxed);
+}
@@ -0,0 +1,109 @@
+#ifndef OBSERVE_H
+#define OBSERVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "retransmit.h"
+
+/* -------------------------
+   Observe (RFC 7641)
+   -------------------------
+   Clients register on sensor/<n> with a GET carrying Observe 0 and are then
+   sent a NON 2.05 notification every time a reading for that sensor is
+   ingested, instead of polling. A notification carries the same body, ETag
+   and Max-Age as a GET of the resource would. Observers are keyed by (client IPv4 address,
+   port, token) and stored per sensor in lock stripes. A notification is
+   serialized once without a token; each observer only gets its own header,
+   Message ID and token written in front of the shared bytes.
+   Notifications are NON, except that an observer gets a CON one when its
+   last acknowledged notification (or its registration) is con_interval
+   seconds old, so a client that went away is noticed (RFC 7641 4.5). The
+   CON is retransmitted by the retx tracker; until it is ACKed every
+   notification to the observer is CON and takes the place of the previous
+   one in the tracker (RFC 7641 4.5.2). When the tracker gives up on it the
+   observer is dropped (observe_expire_mid).
+   An observer is also removed by a GET with Observe 1, by a RST answering one
+   of its notifications, or by registering the same token again (replaced).
+*/
+#define COAP_OPTION_OBSERVE 6
+#define OBSERVE_REGISTER 0
+#define OBSERVE_DEREGISTER 1
+#define OBSERVE_STRIPES 16
+#define OBSERVE_BUCKETS_PER_STRIPE 64
+#define OBSERVE_MAX_OBSERVERS 4096 // registrations beyond this are answered without Observe
+#define OBSERVE_CON_INTERVAL 300   // seconds between confirmable notifications to an observer
+
+typedef struct observer observer_t;
+
+/* Send one datagram (the buffer may be reused once this returns). */
+typedef void (*observe_send_fn)(int sock, const struct sockaddr_in *addr, const uint8_t *data, size_t len);
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    observer_t *buckets[OBSERVE_BUCKETS_PER_STRIPE];
+} observe_stripe_t;
+
+typedef struct
+{
+    observe_stripe_t stripes[OBSERVE_STRIPES];
+    observe_send_fn send;
+    _Atomic unsigned int *next_mid;  // Message IDs shared with other server-initiated messages
+    _Atomic uint32_t seq;            // Observe sequence number, 24 bits on the wire
+    int con_interval;                // OBSERVE_CON_INTERVAL unless changed after observe_init
+    retx_tracker_t *retx;            // retransmits CON notifications; set after observe_init
+    _Atomic size_t observers;
+    _Atomic uint64_t notifications;  // readings that had at least one observer
+    _Atomic uint64_t sent;           // notification datagrams
+    _Atomic uint64_t cancelled;
+    _Atomic uint64_t expired;        // observers dropped for not acknowledging a CON
+} observe_registry_t;
+
+typedef struct
+{
+    size_t observers;
+    uint64_t notifications;
+    uint64_t sent;
+    uint64_t cancelled;
+    uint64_t expired;
+} observe_stats_t;
+
+int observe_init(observe_registry_t *reg, observe_send_fn send, _Atomic unsigned int *next_mid);
+
+void observe_destroy(observe_registry_t *reg);
+
+/* Add (or refresh) the observer (addr, token) of a sensor.
+   Returns 0 on success, -1 when the registry is full. */
+int observe_register(observe_registry_t *reg, int sensor, int sock, const struct sockaddr_in *addr,
+                     const uint8_t *token, uint8_t tkl);
+
+/* Remove the observer (addr, token) of a sensor. Returns 1 if it was registered. */
+int observe_cancel(observe_registry_t *reg, int sensor, const struct sockaddr_in *addr, const uint8_t *token,
+                   uint8_t tkl);
+
+/* Remove the observer whose latest notification had this Message ID (the client
+   answered it with RST). Returns 1 if one was found. */
+int observe_cancel_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid);
+
+/* The client ACKed a notification with this Message ID (a CON one). Returns 1
+   if it belonged to an observer. */
+int observe_ack_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid);
+
+/* The retx tracker gave up on the CON notification mid to addr: drop its
+   observer. Returns 1 if one was found. */
+int observe_expire_mid(observe_registry_t *reg, const struct sockaddr_in *addr, uint16_t mid);
+
+/* Current sequence number, sent as the Observe value of registration responses. */
+uint32_t observe_seq(observe_registry_t *reg);
+
+/* Notify every observer of a sensor with payload, tagged like a GET response:
+   ETag `etag` (etag_len 0 = none) and Max-Age max_age. Returns the number of observers. */
+size_t observe_notify(observe_registry_t *reg, int sensor, const uint8_t *etag, size_t etag_len, uint32_t max_age,
+                      const uint8_t *payload, size_t len);
+
+void observe_get_stats(observe_registry_t *reg, observe_stats_t *out);
+
+#endif // OBSERVE_H
@@ -0,0 +1,250 @@
+#include "retransmit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+struct retx_entry
+{
+    retx_entry_t *next;
+    int sock;
+    struct sockaddr_in addr;
+    uint16_t mid;
+    int attempts;      // retransmissions done so far
+    uint64_t timeout;  // current backoff (ms)
+    uint64_t due;      // next retransmission (monotonic ms)
+    size_t len;
+    uint8_t data[];
+};
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static size_t retx_bucket(const struct sockaddr_in *addr, uint16_t mid)
+{
+    uint32_t h = addr->sin_addr.s_addr ^ ((uint32_t)addr->sin_port << 16) ^ mid;
+    h *= 0x9E3779B1U;
+    return (h >> 16) % RETX_BUCKETS;
+}
+
+static int same_exchange(const retx_entry_t *e, const struct sockaddr_in *addr, uint16_t mid)
+{
+    return e->mid == mid && e->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+           e->addr.sin_port == addr->sin_port;
+}
+
+size_t retx_poll(retx_tracker_t *t, uint64_t now)
+{
+    size_t resent = 0;
+    retx_entry_t *dropped = NULL;
+    pthread_mutex_lock(&t->lock);
+    for (size_t b = 0; b < RETX_BUCKETS; b++)
+    {
+        retx_entry_t **pp = &t->buckets[b];
+        while (*pp)
+        {
+            retx_entry_t *e = *pp;
+            if (e->due > now)
+            {
+                pp = &e->next;
+                continue;
+            }
+            if (e->attempts >= MAX_RETRANSMIT)
+            {
+                *pp = e->next;
+                e->next = dropped;
+                dropped = e;
+                atomic_fetch_sub_explicit(&t->outstanding, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&t->gave_up, 1, memory_order_relaxed);
+                continue;
+            }
+            sendto(e->sock, e->data, e->len, 0, (struct sockaddr *)&e->addr, sizeof(e->addr));
+            e->attempts++;
+            e->timeout *= 2;
+            e->due = now + e->timeout;
+            atomic_fetch_add_explicit(&t->retransmits, 1, memory_order_relaxed);
+            resent++;
+            pp = &e->next;
+        }
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    // Outside the lock: the callback may take locks that are held around retx_add
+    while (dropped)
+    {
+        retx_entry_t *e = dropped;
+        dropped = e->next;
+        if (t->give_up)
+            t->give_up(t->give_up_ctx, &e->addr, e->mid);
+        free(e);
+    }
+    return resent;
+}
+
+// Timer thread: retx_poll every tick
+static void *retx_main(void *arg)
+{
+    retx_tracker_t *t = (retx_tracker_t *)arg;
+    struct timespec tick = {0, RETX_TICK_MS * 1000000L};
+
+    while (atomic_load_explicit(&t->running, memory_order_acquire))
+    {
+        nanosleep(&tick, NULL);
+        retx_poll(t, t->clock());
+    }
+    return NULL;
+}
+
+int retx_init_clock(retx_tracker_t *t, retx_clock_fn clock)
+{
+    memset(t, 0, sizeof(*t));
+    if (!clock || pthread_mutex_init(&t->lock, NULL) != 0)
+        return -1;
+    t->clock = clock;
+    atomic_init(&t->outstanding, 0);
+    atomic_init(&t->sent, 0);
+    atomic_init(&t->acked, 0);
+    atomic_init(&t->retransmits, 0);
+    atomic_init(&t->gave_up, 0);
+    atomic_init(&t->running, 0);
+    return 0;
+}
+
+int retx_init(retx_tracker_t *t)
+{
+    if (retx_init_clock(t, now_ms) != 0)
+        return -1;
+    atomic_store(&t->running, 1);
+    if (pthread_create(&t->thread, NULL, retx_main, t) != 0)
+    {
+        pthread_mutex_destroy(&t->lock);
+        return -1;
+    }
+    t->threaded = 1;
+    return 0;
+}
+
+void retx_destroy(retx_tracker_t *t)
+{
+    atomic_store_explicit(&t->running, 0, memory_order_release);
+    if (t->threaded)
+        pthread_join(t->thread, NULL);
+    for (size_t b = 0; b < RETX_BUCKETS; b++)
+    {
+        retx_entry_t *e = t->buckets[b];
+        while (e)
+        {
+            retx_entry_t *next = e->next;
+            free(e);
+            e = next;
+        }
+        t->buckets[b] = NULL;
+    }
+    pthread_mutex_destroy(&t->lock);
+}
+
+// Unlink the outstanding message (addr, mid), NULL if there is none (lock held)
+static retx_entry_t *retx_unlink(retx_tracker_t *t, const struct sockaddr_in *addr, uint16_t mid)
+{
+    for (retx_entry_t **pp = &t->buckets[retx_bucket(addr, mid)]; *pp; pp = &(*pp)->next)
+    {
+        if (same_exchange(*pp, addr, mid))
+        {
+            retx_entry_t *found = *pp;
+            *pp = found->next;
+            return found;
+        }
+    }
+    return NULL;
+}
+
+static retx_entry_t *retx_entry(int sock, const struct sockaddr_in *addr, uint16_t mid, const uint8_t *data,
+                                size_t len)
+{
+    retx_entry_t *e = malloc(sizeof(*e) + len);
+    if (!e)
+        return NULL;
+    e->sock = sock;
+    e->addr = *addr;
+    e->mid = mid;
+    e->attempts = 0;
+    // Initial timeout is random in [ACK_TIMEOUT, ACK_TIMEOUT * ACK_RANDOM_FACTOR]
+    e->timeout = ACK_TIMEOUT_MS + (uint64_t)(rand() % (int)(ACK_TIMEOUT_MS * (ACK_RANDOM_FACTOR - 1.0) + 1));
+    e->len = len;
+    memcpy(e->data, data, len);
+    return e;
+}
+
+int retx_add(retx_tracker_t *t, int sock, const struct sockaddr_in *addr, uint16_t mid,
+             const uint8_t *data, size_t len)
+{
+    retx_entry_t *e = retx_entry(sock, addr, mid, data, len);
+    if (!e)
+        return -1;
+    e->due = t->clock() + e->timeout;
+
+    size_t b = retx_bucket(addr, mid);
+    pthread_mutex_lock(&t->lock);
+    e->next = t->buckets[b];
+    t->buckets[b] = e;
+    pthread_mutex_unlock(&t->lock);
+    atomic_fetch_add_explicit(&t->outstanding, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&t->sent, 1, memory_order_relaxed);
+    return 0;
+}
+
+int retx_replace(retx_tracker_t *t, int sock, const struct sockaddr_in *addr, uint16_t old_mid, uint16_t mid,
+                 const uint8_t *data, size_t len)
+{
+    retx_entry_t *e = retx_entry(sock, addr, mid, data, len);
+    if (!e)
+        return -1;
+    e->due = t->clock() + e->timeout;
+
+    size_t b = retx_bucket(addr, mid);
+    pthread_mutex_lock(&t->lock);
+    retx_entry_t *old = retx_unlink(t, addr, old_mid);
+    if (old)
+    {
+        e->attempts = old->attempts;
+        e->timeout = old->timeout;
+        e->due = old->due;
+    }
+    e->next = t->buckets[b];
+    t->buckets[b] = e;
+    pthread_mutex_unlock(&t->lock);
+    if (old)
+        free(old);
+    else
+        atomic_fetch_add_explicit(&t->outstanding, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&t->sent, 1, memory_order_relaxed);
+    return 0;
+}
+
+int retx_ack(retx_tracker_t *t, const struct sockaddr_in *addr, uint16_t mid)
+{
+    pthread_mutex_lock(&t->lock);
+    retx_entry_t *found = retx_unlink(t, addr, mid);
+    pthread_mutex_unlock(&t->lock);
+
+    if (!found)
+        return 0;
+    free(found);
+    atomic_fetch_sub_explicit(&t->outstanding, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&t->acked, 1, memory_order_relaxed);
+    return 1;
+}
+
+void retx_get_stats(retx_tracker_t *t, retx_stats_t *out)
+{
+    out->outstanding = atomic_load_explicit(&t->outstanding, memory_order_relaxed);
+    out->sent = atomic_load_explicit(&t->sent, memory_order_relaxed);
+    out->acked = atomic_load_explicit(&t->acked, memory_order_relaxed);
+    out->retransmits = atomic_load_explicit(&t->retransmits, memory_order_relaxed);
+    out->gave_up = atomic_load_explicit(&t->gave_up, memory_order_relaxed);
+}
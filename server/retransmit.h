@@ -0,0 +1,91 @@
+#ifndef RETRANSMIT_H
+#define RETRANSMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+/* -------------------------
+   CON retransmission
+   -------------------------
+   Separate responses and confirmable Observe notifications are CON messages
+   and must be retransmitted until the client ACKs them (RFC 7252 section
+   4.2). The tracker keeps a
+   copy of every outstanding message keyed by (client endpoint, Message ID);
+   a background thread resends it with exponential backoff starting at
+   ACK_TIMEOUT * [1, ACK_RANDOM_FACTOR] and gives up after MAX_RETRANSMIT.
+   Tests drive the same timer through retx_poll with a clock of their own.
+*/
+#define ACK_TIMEOUT_MS 2000
+#define ACK_RANDOM_FACTOR 1.5
+#define MAX_RETRANSMIT 4
+#define RETX_BUCKETS 1024
+#define RETX_TICK_MS 50 // resolution of the retransmission timer
+
+typedef struct retx_entry retx_entry_t;
+
+/* Monotonic time in milliseconds */
+typedef uint64_t (*retx_clock_fn)(void);
+
+/* A message to addr was dropped unacknowledged after MAX_RETRANSMIT. Called
+   from the timer without the tracker lock held. */
+typedef void (*retx_give_up_fn)(void *ctx, const struct sockaddr_in *addr, uint16_t mid);
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    retx_entry_t *buckets[RETX_BUCKETS];
+    retx_clock_fn clock;
+    retx_give_up_fn give_up;      // NULL unless set after init
+    void *give_up_ctx;
+    pthread_t thread;
+    int threaded;
+    _Atomic int running;
+    _Atomic size_t outstanding;
+    _Atomic uint64_t sent;        // CON messages registered
+    _Atomic uint64_t acked;
+    _Atomic uint64_t retransmits;
+    _Atomic uint64_t gave_up;     // dropped after MAX_RETRANSMIT
+} retx_tracker_t;
+
+typedef struct
+{
+    size_t outstanding;
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t retransmits;
+    uint64_t gave_up;
+} retx_stats_t;
+
+/* Start the retransmission thread. Returns 0 on success. */
+int retx_init(retx_tracker_t *t);
+
+/* Set up a tracker without a thread that reads the time from clock; the
+   caller resends with retx_poll. Returns 0 on success. */
+int retx_init_clock(retx_tracker_t *t, retx_clock_fn clock);
+
+/* Resend every message due at `now` (ms, same clock), double its timeout, and
+   drop messages that used up MAX_RETRANSMIT. Returns the number resent. */
+size_t retx_poll(retx_tracker_t *t, uint64_t now);
+
+/* Stop the thread and drop outstanding messages. */
+void retx_destroy(retx_tracker_t *t);
+
+/* Track a CON message that was just sent on sock to addr (data is copied). Returns 0 on success. */
+int retx_add(retx_tracker_t *t, int sock, const struct sockaddr_in *addr, uint16_t mid,
+             const uint8_t *data, size_t len);
+
+/* A newer message to addr takes the place of old_mid (RFC 7641 4.5.2): it keeps
+   old_mid's retransmission counter and timeout and goes out when old_mid would
+   have. Same as retx_add when old_mid is not outstanding. Returns 0 on success. */
+int retx_replace(retx_tracker_t *t, int sock, const struct sockaddr_in *addr, uint16_t old_mid, uint16_t mid,
+                 const uint8_t *data, size_t len);
+
+/* ACK or RST from addr for mid: stop retransmitting. Returns 1 if it matched an outstanding message. */
+int retx_ack(retx_tracker_t *t, const struct sockaddr_in *addr, uint16_t mid);
+
+void retx_get_stats(retx_tracker_t *t, retx_stats_t *out);
+
+#endif // RETRANSMIT_H
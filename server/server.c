@@ -1,6 +1,22 @@
+#define _GNU_SOURCE // recvmmsg, CPU_SET, pthread_setaffinity_np
 #include "coap.h"
 
 #include "../src/db.h"              // SQLite database helper functions
+#include "probes.h"                 // USDT probe points (no-ops without <sys/sdt.h>)
+#include "worker_pool.h"            // Fixed worker pool over a bounded MPMC ring
+#include "udp_io.h"                 // Batched sendmmsg / io_uring transmit path
+#include "uring.h"                  // Minimal io_uring wrapper (optional backend)
+#include "arena.h"                  // Per-worker request arena
+#include "slab_pool.h"              // Recycled receive tasks
+#include "dedup.h"                  // Duplicate detection by (endpoint, Message ID)
+#include "retransmit.h"             // CON retransmission for separate responses
+#include "block_cache.h"            // Block2 snapshots of large GET responses
+#include "observe.h"                // Observers of sensor/<n> (RFC 7641)
+#include "etag.h"                   // ETags from write generations
+#include "latest_cache.h"           // Latest reading per sensor, for GET sensor/<n>
+#include "async_log.h"              // Log ring drained by a writer thread
+#include "metrics.h"                // Per-thread request counters and latency histograms
+#include "trace.h"                  // Per-stage request tracing, Chrome trace_event dumps
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -8,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -16,6 +33,7 @@
 #include <windows.h>
 #pragma comment(lib, "Ws2_32.lib")
 typedef HANDLE thread_t;
+#define close_socket closesocket
 // Define STDOUT_FILENO and STDERR_FILENO for Windows
 #ifndef STDOUT_FILENO
 #define STDOUT_FILENO 1
@@ -28,14 +46,64 @@ typedef HANDLE thread_t;
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <pthread.h>
+#include <sched.h>
 #include <ctype.h>
 #include <strings.h>
+#include <signal.h>
 
 typedef pthread_t thread_t;
+#define close_socket close
 #endif
 
 #define DEFAULT_PORT 5683
 #define BUF_SIZE 8192
+#define OUT_STACK_SIZE 1280       // responses up to this size are serialized on the stack
+#define DEFAULT_WORKERS 8
+#define DEFAULT_QUEUE_CAPACITY 1024
+#define DEFAULT_STATS_INTERVAL 30 // seconds between pool stats log lines (0 = off)
+#define DEFAULT_BATCH 16          // datagrams per recvmmsg/sendmmsg call
+#define DEFAULT_URING_DEPTH 64    // receives kept in flight by the io_uring backend
+#define URING_MAX_FAILURES 8      // failed io_uring_enter calls in a row before falling back to recvmmsg
+#define DEFAULT_TASK_BUF 1152     // pooled datagram buffer (RFC 7252 recommended max message size)
+#define MIN_TASK_BUF 64
+#define DEFAULT_GROUP_COMMIT_MS 5 // longest a POST waits for its batch to fill
+#define DEFAULT_BLOCK_SIZE 1024   // Block2 size for GET bodies that do not fit one datagram
+#define DEFAULT_MAX_AGE 5         // seconds a client may reuse a GET response without asking
+#define PAGE_MAX_PAYLOAD 1024     // GET ?after= page body that keeps a response inside one datagram (RFC 7252 4.6)
+#define LATEST_BODY_CAP 1152      // GET sensor/<n> body: a stored value up to 1 KB plus the envelope
+
+// Runtime configuration: positional [PORT] [LogFile] plus --options
+typedef struct
+{
+    int port;
+    const char *log_path;
+    size_t workers;
+    size_t queue_capacity;
+    int stats_interval;
+    int shards;         // receive sockets sharing the port via SO_REUSEPORT
+    int pin;            // pin each shard's receive thread to a core
+    size_t batch;       // datagrams per recvmmsg/sendmmsg call
+    int tx_delay_us;    // longest a response waits for its transmit batch to fill
+    int io_uring;       // use the io_uring backend instead of recvmmsg/sendmmsg
+    unsigned uring_depth;
+    size_t task_buf;    // bytes of datagram buffer in each pooled task
+    int exchange_lifetime; // seconds a Message ID is remembered for dedup (0 = off)
+    int separate;       // empty ACK first, result as a separate CON response
+    db_config_t db;     // SQLite connection pool
+    int checkpoint_interval; // seconds between explicit WAL checkpoints (0 = off)
+    int group_commit;   // rows per ingest transaction (0 = every insert commits on its own)
+    int group_commit_ms;
+    int block_size;     // largest Block2 block (0 = whole GET bodies in one datagram)
+    int observe;        // accept Observe registrations on sensor/<n>
+    int max_age;        // Max-Age of GET responses, seconds
+    int log_level;      // LOG_LEVEL_ERROR or LOG_LEVEL_INFO at startup
+    int log_sample;     // INFO lines of 1 in N requests
+    int log_binary;     // binary log records (tools/log_decode reads them)
+    size_t log_ring;    // queued log lines for the writer thread (0 = workers write the log themselves)
+    int metrics;        // record request counters and latency histograms
+    int trace;          // start with request tracing on
+    const char *trace_file; // where SIGQUIT writes the trace dump
+} server_config_t;
 
 // Task structure representing a single client request
 typedef struct
@@ -43,27 +111,135 @@ typedef struct
     int sock;                       // Server UDP socket
     struct sockaddr_in client_addr; // Client address
     socklen_t addr_len;
-    uint8_t buffer[BUF_SIZE];       // Incoming CoAP datagram
     ssize_t msg_len;                // Length of datagram
     FILE *log_file;                 // Pointer to log file
+    slab_pool_t *slab;              // Owning slab, NULL for heap-allocated tasks
+    uint64_t rx_ns;                 // Receive time while tracing, 0 otherwise
+    uint8_t buffer[];               // Incoming CoAP datagram (task_buf bytes, more when oversized)
 } client_task_t;
 
+// Give a task back to the slab it came from, or to the heap
+static void release_task(client_task_t *task)
+{
+    if (task->slab)
+        slab_pool_free(task->slab, task);
+    else
+        free(task);
+}
+
+// Exchange deduplication shared by all shards (NULL when disabled)
+static dedup_cache_t *dedup_cache = NULL;
+
+// Outstanding CON messages: separate responses and CON notifications (NULL
+// unless --separate or --observe)
+static retx_tracker_t *retx_tracker = NULL;
+static int separate_responses = 0; // --separate
+static _Atomic unsigned int next_mid = 0; // Message IDs of server-initiated messages
+
+// Observers of sensor/<n>, notified from the POST ingest path (NULL when off)
+static observe_registry_t *observe_registry = NULL;
+
+static uint32_t max_age = DEFAULT_MAX_AGE; // Max-Age sent with GET responses
+
+// Newest reading of every sensor, kept current by the write paths
+static latest_cache_t *latest_cache = NULL;
+
+// Snapshots of GET bodies sent block-wise (NULL when Block2 is off)
+static block_cache_t *block_cache = NULL;
+static uint8_t block_szx = COAP_BLOCK_MAX_SZX; // largest block the server sends
+
+// Resend a cached response to the client of a duplicate request
+static void replay_response(void *ctx, const uint8_t *data, size_t len)
+{
+    client_task_t *task = (client_task_t *)ctx;
+    udp_tx_send(task->sock, data, len, (struct sockaddr *)&task->client_addr, task->addr_len);
+}
+
+// Queue a notification datagram on the calling worker's transmit batch
+static void send_notification(int sock, const struct sockaddr_in *addr, const uint8_t *data, size_t len)
+{
+    udp_tx_send(sock, data, len, (const struct sockaddr *)addr, sizeof(*addr));
+}
+
+// The tracker gave up on a CON notification: the observer is gone
+static void expire_observer(void *ctx, const struct sockaddr_in *addr, uint16_t mid)
+{
+    observe_expire_mid((observe_registry_t *)ctx, addr, mid);
+}
+
 /* ------------------------
    Logging helper
    ------------------------ */
-// Writes log messages with timestamp and level (INFO/ERROR).
-static void log_message(FILE *logf, const char *level, const char *fmt, ...) {
+// Current level (SIGUSR1 raises it to INFO, SIGUSR2 lowers it to ERROR)
+static _Atomic int log_level = LOG_LEVEL_INFO;
+static unsigned int log_sample = 1; // INFO lines of 1 in N requests (--log-sample)
+static int log_binary = 0;          // fixed-size binary records instead of text lines
+// INFO lines of the request this worker is handling are sampled out
+static _Thread_local int log_sampled_out = 0;
+
+// Disabled levels cost one comparison: the arguments are not even evaluated
+#define log_message(logf, level, ...)                                                              \
+    do                                                                                             \
+    {                                                                                              \
+        if ((level) <= atomic_load_explicit(&log_level, memory_order_relaxed) &&                   \
+            ((level) == LOG_LEVEL_ERROR || !log_sampled_out))                                      \
+            log_write(logf, level, __VA_ARGS__);                                                   \
+    } while (0)
+
+// Wall clock split into the seconds and microseconds of a binary record
+static void log_bin_stamp(log_bin_record_t *rec, int type, int level)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = LOG_BIN_MAGIC;
+    rec->type = (uint8_t)type;
+    rec->level = (uint8_t)level;
+    rec->sec = (int64_t)now.tv_sec;
+    rec->usec = (uint32_t)(now.tv_nsec / 1000);
+}
+
+// Hand a binary record to the log writer, or write it directly
+static void log_write_record(FILE *logf, const log_bin_record_t *rec)
+{
+    if (async_log_active(logf))
+        async_log_write_binary(rec);
+    else
+    {
+        fwrite(rec, sizeof(*rec), 1, logf);
+        fflush(logf);
+    }
+}
+
+// Writes log messages with timestamp and level (INFO/ERROR). With the async
+// logger running the line is only queued; the writer thread adds the timestamp.
+static void log_write(FILE *logf, int level, const char *fmt, ...) {
     if (!logf) return;
 
+    va_list args;
+    va_start(args, fmt);
+    if (log_binary)
+    {
+        log_bin_record_t rec;
+        log_bin_stamp(&rec, LOG_BIN_TEXT, level);
+        vsnprintf(rec.u.text, sizeof(rec.u.text), fmt, args);
+        va_end(args);
+        log_write_record(logf, &rec);
+        return;
+    }
+    if (async_log_active(logf))
+    {
+        async_log_vprintf(log_level_name(level), fmt, args);
+        va_end(args);
+        return;
+    }
+
     time_t now = time(NULL);
     struct tm *t = localtime(&now);
     char tbuf[32];
     strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M:%S", t);
 
-    fprintf(logf, "[%s] %s: ", tbuf, level);
-
-    va_list args;
-    va_start(args, fmt);
+    fprintf(logf, "[%s] %s: ", tbuf, log_level_name(level));
     vfprintf(logf, fmt, args);
     va_end(args);
 
@@ -71,11 +247,60 @@ static void log_message(FILE *logf, const char *level, const char *fmt, ...) {
     fflush(logf);
 }
 
+// Per-request summary line; in binary mode its fields are stored without formatting
+static void log_request(FILE *logf, const coap_message_view_t *req, const char *uri_path, int response)
+{
+    if (!logf || atomic_load_explicit(&log_level, memory_order_relaxed) < LOG_LEVEL_INFO || log_sampled_out)
+        return;
+    if (!log_binary)
+    {
+        log_write(logf, LOG_LEVEL_INFO, "Processed MID=%u Code=%u Uri=%s Response=%d", req->message_id, req->code,
+                  uri_path ? uri_path : "(none)", response);
+        return;
+    }
+    log_bin_record_t rec;
+    log_bin_stamp(&rec, LOG_BIN_REQUEST, LOG_LEVEL_INFO);
+    rec.u.request.mid = req->message_id;
+    rec.u.request.method = req->code;
+    rec.u.request.response = (uint8_t)response;
+    snprintf(rec.u.request.uri, sizeof(rec.u.request.uri), "%s", uri_path ? uri_path : "(none)");
+    log_write_record(logf, &rec);
+}
+
+// Decide whether the INFO lines of the next request on this thread are kept
+static void log_sample_request(void)
+{
+    static _Thread_local unsigned int seen = 0;
+    log_sampled_out = log_sample > 1 && seen++ % log_sample != 0;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// SIGUSR1: log INFO lines again, SIGUSR2: only errors (a relaxed store is async-signal-safe)
+static void log_level_signal(int sig)
+{
+    int level = atomic_load_explicit(&log_level, memory_order_relaxed);
+    if (sig == SIGUSR1 && level < LOG_LEVEL_MAX)
+        level++;
+    else if (sig == SIGUSR2 && level > LOG_LEVEL_ERROR)
+        level--;
+    atomic_store_explicit(&log_level, level, memory_order_relaxed);
+}
+
+// SIGQUIT: the housekeeping loop writes the trace dump (stdio is not async-signal-safe)
+static _Atomic int trace_dump_requested = 0;
+
+static void trace_dump_signal(int sig)
+{
+    (void)sig;
+    atomic_store_explicit(&trace_dump_requested, 1, memory_order_relaxed);
+}
+#endif
+
 /* ------------------------
    Response initializer
    ------------------------ */
 // Creates a response template based on a request: copies MID, token, and sets type.
-static void init_response_from_request(const coap_message_t *req, coap_message_t *resp)
+static void init_response_from_request(const coap_message_view_t *req, coap_message_t *resp)
 {
     coap_init_message(resp);
     resp->version = COAP_VERSION;
@@ -158,8 +383,9 @@ static int extract_number_after(const char *s, const char *token, char *out, siz
     return 1;
 }
 
-// Extract Uri-Path options (number 11) and join them into a string like "sensor/1"
-static char *extract_uri_path(const coap_message_t *req)
+// Extract Uri-Path options (number 11) and join them into a string like "sensor/1".
+// The string lives in the request arena.
+static char *extract_uri_path(const coap_message_view_t *req, arena_t *arena)
 {
     if (!req || req->options_count == 0)
         return NULL;
@@ -173,25 +399,34 @@ static char *extract_uri_path(const coap_message_t *req)
     }
     if (total == 0)
         return NULL;
-    char *path = malloc(total + 1);
+    char *path = arena_alloc(arena, total + 1);
     if (!path)
         return NULL;
-    path[0] = '\0';
-    int first = 1;
+    size_t len = 0;
     for (size_t i = 0; i < req->options_count; ++i)
     {
         if (req->options[i].number == 11)
         {
-            if (!first)
-                strcat(path, "/");
-            else
-                first = 0;
-            strncat(path, (char *)req->options[i].value, req->options[i].length);
+            if (len > 0)
+                path[len++] = '/';
+            memcpy(path + len, req->options[i].value, req->options[i].length);
+            len += req->options[i].length;
         }
     }
+    path[len] = '\0';
     return path;
 }
 
+// Copy a response text into the request arena and attach it as payload
+static void set_payload_text(coap_message_t *resp, arena_t *arena, const char *text)
+{
+    size_t n = strlen(text);
+    resp->payload = arena_alloc(arena, n);
+    resp->payload_len = resp->payload ? n : 0;
+    if (resp->payload)
+        memcpy(resp->payload, text, n);
+}
+
 // Return 1 if string is a number, 0 otherwise
 static int is_numeric(const char *s)
 {
@@ -227,10 +462,404 @@ static int parse_sensor_uri(const char *uri_path)
     return atoi(p);
 }
 
+// Turn a Uri-Query timestamp ("YYYY-MM-DD", "YYYY-MM-DD HH:MM" ... or with a 'T')
+// into the stored "YYYY-MM-DD HH:MM:SS" form. Lower bounds compare fine as a prefix;
+// upper bounds get the missing fields filled up to the end of that day/hour/minute.
+static char *parse_query_timestamp(const uint8_t *v, size_t len, int upper, arena_t *arena)
+{
+    static const char shape[] = "0000-00-00 00:00:00";
+    static const char upper_fill[] = "9999-12-31 23:59:59";
+    if (len != 10 && len != 13 && len != 16 && len != 19)
+        return NULL;
+    char *ts = arena_alloc(arena, sizeof(shape));
+    if (!ts)
+        return NULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        char ch = (char)v[i];
+        if (shape[i] == '0' ? (ch < '0' || ch > '9') : (ch != shape[i] && !(i == 10 && ch == 'T')))
+            return NULL;
+        ts[i] = shape[i] == ' ' ? ' ' : ch;
+    }
+    size_t end = len;
+    if (upper)
+        for (; end < sizeof(shape) - 1; end++)
+            ts[end] = upper_fill[end];
+    ts[end] = '\0';
+    return ts;
+}
+
+// Parse a Uri-Query number with strtol. Returns 0 and sets *out, or -1 when
+// the value is empty, not a plain number or does not fit in an int
+static int parse_query_int(const uint8_t *v, size_t len, int *out)
+{
+    char buf[24];
+    if (len == 0 || len >= sizeof(buf))
+        return -1;
+    memcpy(buf, v, len);
+    buf[len] = '\0';
+    if (!is_numeric(buf))
+        return -1;
+    char *end;
+    errno = 0;
+    long n = strtol(buf, &end, 10);
+    if (errno == ERANGE || *end != '\0' || n < INT_MIN || n > INT_MAX)
+        return -1;
+    *out = (int)n;
+    return 0;
+}
+
+// Value of the Uri-Query option "key=<value>" in *value. Returns 0 if the
+// request has no such option, 1 when it holds a number and -1 when it does
+// not or the number is out of range
+static int query_number(const coap_message_view_t *req, const char *key, int *value)
+{
+    size_t klen = strlen(key);
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        const coap_option_view_t *opt = &req->options[i];
+        if (opt->number != 15 || opt->length <= klen || opt->value[klen] != '=' ||
+            memcmp(opt->value, key, klen) != 0)
+            continue;
+        return parse_query_int(opt->value + klen + 1, opt->length - klen - 1, value) == 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+// Uri-Query (option 15) filters of GET sensor/<n>: sensor=, from=, to=, limit=.
+// Returns 0 when the request carries none of them, 1 when q was filled and
+// -1 when a filter is malformed or no sensor is given (path or sensor=).
+static int parse_range_query(const coap_message_view_t *req, int path_sensor, db_range_t *q, arena_t *arena)
+{
+    int found = 0;
+    memset(q, 0, sizeof(*q));
+    q->sensor = path_sensor;
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        const coap_option_view_t *opt = &req->options[i];
+        if (opt->number != 15)
+            continue;
+        const char *eq = memchr(opt->value, '=', opt->length);
+        if (!eq)
+            continue;
+        size_t klen = (size_t)(eq - (const char *)opt->value);
+        const uint8_t *val = (const uint8_t *)eq + 1;
+        size_t vlen = opt->length - klen - 1;
+        if (klen == 4 && memcmp(opt->value, "from", 4) == 0)
+        {
+            if (!(q->from = parse_query_timestamp(val, vlen, 0, arena)))
+                return -1;
+        }
+        else if (klen == 2 && memcmp(opt->value, "to", 2) == 0)
+        {
+            if (!(q->to = parse_query_timestamp(val, vlen, 1, arena)))
+                return -1;
+        }
+        else if ((klen == 6 && memcmp(opt->value, "sensor", 6) == 0) ||
+                 (klen == 5 && memcmp(opt->value, "limit", 5) == 0))
+        {
+            int n;
+            if (parse_query_int(val, vlen, &n) != 0 || n <= 0)
+                return -1;
+            if (klen == 6)
+                q->sensor = n;
+            else
+                q->limit = n;
+        }
+        else
+        {
+            continue; // unknown filters are ignored
+        }
+        found = 1;
+    }
+    if (!found)
+        return 0;
+    return q->sensor > 0 ? 1 : -1;
+}
+
+// Add an option holding an unsigned integer in its shortest form (0 = empty value)
+static void add_uint_option(coap_message_t *resp, uint16_t number, uint32_t v)
+{
+    uint8_t buf[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    size_t skip = 0;
+    while (skip < sizeof(buf) && buf[skip] == 0)
+        skip++;
+    coap_add_option(resp, number, buf + skip, sizeof(buf) - skip);
+}
+
+/* ------------------------
+   Conditional GET
+   ------------------------ */
+// Record id addressed by a GET path "<id>", 0 otherwise
+static int uri_record_id(const char *uri_path)
+{
+    if (!uri_path || !is_numeric(uri_path))
+        return 0;
+    int id = atoi(uri_path);
+    return id > 0 ? id : 0;
+}
+
+static int has_uri_query(const coap_message_view_t *req)
+{
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        if (req->options[i].number == 15)
+            return 1;
+    }
+    return 0;
+}
+
+/* ------------------------
+   Observe
+   ------------------------ */
+// Observe option value of a request, -1 when absent
+static long request_observe(const coap_message_view_t *req)
+{
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        if (req->options[i].number != COAP_OPTION_OBSERVE)
+            continue;
+        long v = 0;
+        for (size_t j = 0; j < req->options[i].length && j < 3; j++)
+            v = (v << 8) | req->options[i].value[j];
+        return v;
+    }
+    return -1;
+}
+
+/* ------------------------
+   Latest reading per sensor
+   ------------------------ */
+// The representation of sensor/<n>, shared by GET, Observe registrations and
+// notifications: the newest reading from the latest-reading cache (which asks
+// the database for sensors it does not hold) and the sensor's ETag (taken
+// first, see etag.h). Returns the body length, 0 when the sensor has no
+// reading, -1 on error.
+static int latest_representation(int sensor, uint8_t etag[ETAG_LEN], char **body, arena_t *arena)
+{
+    etag_for_sensor(sensor, etag);
+    *body = arena_alloc(arena, LATEST_BODY_CAP);
+    return *body ? latest_cache_format(latest_cache, sensor, *body, LATEST_BODY_CAP) : -1;
+}
+
+// Push the sensor's newest reading to its observers after a POST stored one
+static void notify_observers(int sensor, arena_t *arena)
+{
+    if (!observe_registry || atomic_load_explicit(&observe_registry->observers, memory_order_relaxed) == 0)
+        return;
+    uint8_t etag[ETAG_LEN];
+    char *body;
+    int n = latest_representation(sensor, etag, &body, arena);
+    if (n > 0)
+        observe_notify(observe_registry, sensor, etag, ETAG_LEN, max_age, (const uint8_t *)body, (size_t)n);
+}
+
+// db_get_latest callback: store a sensor's newest row; ctx points at the id
+// of a row that was just rewritten or deleted (NULL when warming up)
+static void load_latest(void *ctx, int sensor, int id, const char *value, const char *ts)
+{
+    latest_cache_put(latest_cache, sensor, id, value, ts, ctx ? *(const int *)ctx : 0);
+}
+
+// A PUT or DELETE changed row id: if it is some sensor's newest reading,
+// reload that sensor from the database (or forget it when no rows are left)
+static void refresh_latest(int id)
+{
+    int sensor = latest_cache ? latest_cache_sensor_of(latest_cache, id) : 0;
+    if (sensor <= 0)
+        return;
+    if (db_get_latest(sensor, load_latest, &id) == 0)
+        latest_cache_remove(latest_cache, sensor, id);
+    etag_bump_sensor(sensor);
+}
+
+/* ------------------------
+   Block-wise transfer
+   ------------------------ */
+// Block2 option of a request: 1 with *b filled, 0 when absent, -1 when malformed
+static int request_block2(const coap_message_view_t *req, coap_block_t *b)
+{
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        if (req->options[i].number == COAP_OPTION_BLOCK2)
+            return coap_block_decode(req->options[i].value, req->options[i].length, b) == COAP_OK ? 1 : -1;
+    }
+    return 0;
+}
+
+// Attach Block2 to a response, plus Size2 (whole body size) on the first block
+static void add_block2(coap_message_t *resp, const coap_block_t *b, size_t total)
+{
+    uint8_t v[4];
+    int n = coap_block_encode(b, v);
+    if (n >= 0)
+        coap_add_option(resp, COAP_OPTION_BLOCK2, v, (size_t)n);
+    if (b->num == 0 && b->more)
+        add_uint_option(resp, COAP_OPTION_SIZE2, (uint32_t)total);
+}
+
+// Answer a request for block num > 0 from the snapshot taken when block 0 was
+// built. Returns 0 when there is no snapshot (the GET then runs again).
+static int serve_snapshot_block(const client_task_t *task, const coap_message_view_t *req, coap_block_t b,
+                                coap_message_t *resp, arena_t *arena)
+{
+    // Smaller blocks than asked for: same offset, so the block number scales up (RFC 7959 2.4)
+    if (b.szx > block_szx)
+    {
+        b.num <<= b.szx - block_szx;
+        b.szx = block_szx;
+    }
+    size_t size = COAP_BLOCK_SIZE(b.szx), total = 0, etag_len = 0;
+    uint8_t *slice = arena_alloc(arena, size);
+    uint8_t etag[BLOCK_ETAG_MAX];
+    if (!slice)
+        return 0;
+    long n = block_cache_read(block_cache, &task->client_addr, req->token, req->tkl, (size_t)b.num * size,
+                              slice, size, &total, etag, &etag_len);
+    if (n < 0)
+        return 0;
+    if (n == 0)
+    {
+        resp->code = COAP_CODE_BAD_REQUEST; // block past the end of the body
+        return 1;
+    }
+    resp->code = COAP_CODE_CONTENT;
+    resp->payload = slice;
+    resp->payload_len = (size_t)n;
+    b.more = (size_t)b.num * size + (size_t)n < total;
+    if (etag_len == ETAG_LEN)
+        etag_tag_response(resp, etag, max_age);
+    add_block2(resp, &b, total);
+    return 1;
+}
+
+// Cut a freshly built GET body down to the requested block (block 0 when the
+// client did not ask but the body is larger than one block) and keep the whole
+// body, with its ETag (NULL = none), as a snapshot while more blocks are to come.
+static void slice_block2(const client_task_t *task, const coap_message_view_t *req, const coap_block_t *asked,
+                         const uint8_t *etag, coap_message_t *resp)
+{
+    coap_block_t b = {0, 0, block_szx};
+    if (asked)
+    {
+        // Smaller blocks than asked for: same offset, so the block number scales up
+        b.num = asked->szx > b.szx ? asked->num << (asked->szx - b.szx) : asked->num;
+        if (asked->szx < b.szx)
+            b.szx = asked->szx;
+    }
+    size_t size = COAP_BLOCK_SIZE(b.szx), total = resp->payload_len, offset = (size_t)b.num * size;
+    if (!asked && total <= size)
+        return;
+    if (offset >= total && total > 0)
+    {
+        resp->code = COAP_CODE_BAD_REQUEST;
+        resp->payload = NULL;
+        resp->payload_len = 0;
+        return;
+    }
+    b.more = offset + size < total;
+    if (b.more)
+        block_cache_put(block_cache, &task->client_addr, req->token, req->tkl, resp->payload, total, etag,
+                        etag ? ETAG_LEN : 0);
+    if (resp->payload)
+        resp->payload += offset;
+    resp->payload_len = b.more ? size : total - offset;
+    add_block2(resp, &b, total);
+}
+
+/* ------------------------
+   Metrics and tracing resources
+   ------------------------ */
+// Stage boundary of handle_client for metrics and tracing; no clock read while both are off
+static inline uint64_t stage_clock(void)
+{
+    uint64_t now = metrics_now();
+    return now ? now : trace_now();
+}
+
+// JSON when the client sends Accept: application/json or ?format=json, text otherwise
+static int metrics_wants_json(const coap_message_view_t *req)
+{
+    for (size_t i = 0; i < req->options_count; ++i)
+    {
+        const coap_option_view_t *opt = &req->options[i];
+        if (opt->number == COAP_OPTION_ACCEPT && opt->length == 1 && opt->value[0] == COAP_FORMAT_JSON)
+            return 1;
+        if (opt->number == 15 && opt->length == 11 && memcmp(opt->value, "format=json", 11) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Answer GET .well-known/metrics with the summed counters of every worker
+static void serve_metrics(const coap_message_view_t *req, coap_message_t *resp, arena_t *arena)
+{
+    int json = metrics_wants_json(req);
+    metrics_snapshot_t *snap = malloc(sizeof(*snap));
+    char *body = arena_alloc(arena, METRICS_BODY_MAX);
+    int len = -1;
+    if (snap && body)
+    {
+        metrics_snapshot(snap);
+        len = metrics_format(snap, json, body, METRICS_BODY_MAX);
+    }
+    free(snap);
+    if (len < 0)
+    {
+        resp->code = COAP_CODE_INTERNAL_ERROR;
+        return;
+    }
+    resp->code = COAP_CODE_CONTENT;
+    resp->payload = (uint8_t *)body;
+    resp->payload_len = (size_t)len;
+    add_uint_option(resp, COAP_OPTION_CONTENT_FORMAT, json ? COAP_FORMAT_JSON : COAP_FORMAT_TEXT);
+}
+
+// Answer GET .well-known/trace[?limit=N] with the newest N (at most
+// TRACE_GET_MAX_LIMIT) traced requests of every worker as Chrome trace_event
+// JSON. Returns the heap body (freed by the caller).
+static char *serve_trace(const coap_message_view_t *req, coap_message_t *resp)
+{
+    int n;
+    int has_limit = query_number(req, "limit", &n);
+    size_t limit = TRACE_GET_DEFAULT_LIMIT;
+    if (has_limit)
+    {
+        if (has_limit < 0 || n <= 0)
+        {
+            resp->code = COAP_CODE_BAD_REQUEST;
+            return NULL;
+        }
+        limit = (size_t)n;
+        if (limit > TRACE_GET_MAX_LIMIT)
+            limit = TRACE_GET_MAX_LIMIT; // a worker answering over CoAP is no place for a whole ring
+    }
+    char *body = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&body, &len);
+    if (!mem)
+    {
+        resp->code = COAP_CODE_INTERNAL_ERROR;
+        return NULL;
+    }
+    trace_write_json(mem, limit);
+    if (fclose(mem) != 0 || !body)
+    {
+        free(body);
+        resp->code = COAP_CODE_INTERNAL_ERROR;
+        return NULL;
+    }
+    resp->code = COAP_CODE_CONTENT;
+    resp->payload = (uint8_t *)body;
+    resp->payload_len = len;
+    add_uint_option(resp, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_JSON);
+    return body;
+}
+
 /* ------------------------
    Worker thread
    ------------------------ */
-// Each incoming CoAP datagram spawns this handler in its own thread.
+// Each incoming CoAP datagram is handled by this function on a pool worker thread.
 // Parses request, executes CRUD on SQLite, builds response, and sends it back.
 #if defined(_WIN32) || defined(_WIN64)
 DWORD WINAPI handle_client(LPVOID arg)
@@ -239,15 +868,43 @@ void *handle_client(void *arg)
 #endif
 {
     client_task_t *task = (client_task_t *)arg;
+    uint64_t t_start = stage_clock();
+    PROBE1(request_start, task);
+    log_sample_request();
+
+    // Scratch memory for this request, released in one go at the end
+    arena_t *arena = arena_thread();
 
-    // Parse request
-    coap_message_t req;
-    memset(&req, 0, sizeof(req));
+    // Parse request (zero-copy: options and payload point into task->buffer)
+    coap_message_view_t req;
 
-    if (coap_parse(task->buffer, (size_t)task->msg_len, &req) != COAP_OK)
+    if (!arena || coap_parse_view(task->buffer, (size_t)task->msg_len, &req) != COAP_OK)
     {
-        log_message(task->log_file, "ERROR", "Failed to parse CoAP message\n");
-        free(task);
+        log_message(task->log_file, LOG_LEVEL_ERROR, "Failed to parse CoAP message\n");
+        release_task(task);
+#if defined(_WIN32) || defined(_WIN64)
+        return 0;
+#else
+        return NULL;
+#endif
+    }
+    uint64_t t_parsed = stage_clock();
+    PROBE2(request_parsed, req.message_id, req.code);
+
+    // Client ACK/RST for one of our separate responses: nothing to answer
+    if (req.code == COAP_CODE_EMPTY && (req.type == COAP_TYPE_ACK || req.type == COAP_TYPE_RST))
+    {
+        int matched = retx_tracker && retx_ack(retx_tracker, &task->client_addr, req.message_id);
+        // A RST answering a notification ends that observation, an ACK confirms a CON one
+        // (whose retransmission the tracker just stopped)
+        if (req.type == COAP_TYPE_RST && observe_registry)
+            matched |= observe_cancel_mid(observe_registry, &task->client_addr, req.message_id);
+        if (req.type == COAP_TYPE_ACK && observe_registry)
+            matched |= observe_ack_mid(observe_registry, &task->client_addr, req.message_id);
+        if (!matched)
+            log_message(task->log_file, LOG_LEVEL_INFO, "Unmatched %s MID=%u", req.type == COAP_TYPE_ACK ? "ACK" : "RST",
+                        req.message_id);
+        release_task(task);
 #if defined(_WIN32) || defined(_WIN64)
         return 0;
 #else
@@ -255,51 +912,261 @@ void *handle_client(void *arg)
 #endif
     }
 
-    // Prepare response template
+    int is_request = req.code != COAP_CODE_EMPTY && (req.code >> 5) == 0;
+
+    // Retransmitted request: answer from the dedup cache without touching SQLite
+    int dedup_tracked = 0;
+    if (dedup_cache && is_request && (req.type == COAP_TYPE_CON || req.type == COAP_TYPE_NON))
+    {
+        dedup_result_t dr = dedup_begin(dedup_cache, &task->client_addr, req.message_id,
+                                        replay_response, task);
+        if (dr != DEDUP_NEW)
+        {
+            PROBE2(dedup_hit, req.message_id, (int)dr);
+            log_message(task->log_file, LOG_LEVEL_INFO, "Duplicate MID=%u %s", req.message_id,
+                        dr == DEDUP_REPLAYED ? "answered from cache" : "dropped (in progress)");
+            release_task(task);
+#if defined(_WIN32) || defined(_WIN64)
+            return 0;
+#else
+            return NULL;
+#endif
+        }
+        dedup_tracked = 1;
+    }
+
+    // Separate response: the receive thread sent the empty ACK when it queued
+    // the request (dispatch_task); the result goes out as a CON of our own after
+    // the DB work. Retransmissions are ACKed there too, so dedup keeps no copy.
+    int separate = separate_responses && is_request && req.type == COAP_TYPE_CON;
+    if (separate && dedup_tracked)
+    {
+        dedup_complete(dedup_cache, &task->client_addr, req.message_id, NULL, 0);
+        dedup_tracked = 0;
+    }
+
+    // Prepare response template; its options live in the arena too
     coap_message_t resp;
     init_response_from_request(&req, &resp);
+    coap_set_allocator(&resp, arena_alloc_fn, arena);
 
-    char *uri_path = extract_uri_path(&req);  // Extract Uri-Path string
+    char *uri_path = extract_uri_path(&req, arena);  // Extract Uri-Path string
+    char *db_result = NULL;                          // heap string returned by db_get_* (freed at the end)
     char tmpbuf[1024];
 
+    coap_block_t block2;
+    int has_block2 = req.code == COAP_CODE_GET && block_cache ? request_block2(&req, &block2) : 0;
+    int block_served = 0;
+    uint8_t etag[ETAG_LEN];
+    int etag_set = 0;
+
     // Dispatch by request method
+    uint64_t t_dispatch = stage_clock();
     switch (req.code)
     {
     // GET: retrieve single record or all records
     case COAP_CODE_GET:
     {
-        // If uri_path is numeric (id) OR sensor/<id> -> treat as id-get
-        int id = -1;
-        if (uri_path)
+        // Later blocks of a block-wise transfer come from the snapshot of block 0
+        if (has_block2 < 0)
         {
-            if (is_numeric(uri_path))
-            {
-                id = atoi(uri_path);
-            }
-            else
-            {
-                int sensor_as_id = parse_sensor_uri(uri_path);
-                if (sensor_as_id > 0)
-                {
-                    id = sensor_as_id;
-                }
-            }
+            resp.code = COAP_CODE_BAD_REQUEST;
+            log_message(task->log_file, LOG_LEVEL_ERROR, "GET: malformed Block2 option");
+            break;
+        }
+        if (has_block2 && block2.num > 0 && serve_snapshot_block(task, &req, block2, &resp, arena))
+        {
+            block_served = 1;
+            log_message(task->log_file, LOG_LEVEL_INFO, "GET block %u: from snapshot", (unsigned)block2.num);
+            break;
         }
 
-        if (id > 0)
+        // .well-known/metrics: request counters and latency percentiles of all workers
+        if (uri_path && strcmp(uri_path, METRICS_PATH) == 0)
         {
-            char *val = db_get_by_id(id); // specific ID
-            if (val)
+            serve_metrics(&req, &resp, arena);
+            log_message(task->log_file, LOG_LEVEL_INFO, "GET metrics: %s",
+                        resp.code == COAP_CODE_CONTENT ? "Success" : "Failed");
+            break;
+        }
+        // .well-known/trace: newest traced requests as Chrome trace_event JSON
+        if (uri_path && strcmp(uri_path, TRACE_PATH) == 0)
+        {
+            db_result = serve_trace(&req, &resp);
+            log_message(task->log_file, LOG_LEVEL_INFO, "GET trace: %s",
+                        resp.code == COAP_CODE_CONTENT ? "Success" : "Failed");
+            break;
+        }
+
+        // Observe on sensor/<n>: register (0) or deregister (1) and answer like a
+        // plain GET of sensor/<n>; new readings are pushed from POST in the same form
+        long observe = observe_registry ? request_observe(&req) : -1;
+        int observe_sensor = parse_sensor_uri(uri_path);
+        if (observe >= 0 && observe_sensor > 0)
+        {
+            int registered = 0;
+            if (observe == OBSERVE_REGISTER)
+                registered = observe_register(observe_registry, observe_sensor, task->sock, &task->client_addr,
+                                              req.token, req.tkl) == 0;
+            else if (observe == OBSERVE_DEREGISTER)
+                observe_cancel(observe_registry, observe_sensor, &task->client_addr, req.token, req.tkl);
+            char *body;
+            int len = latest_representation(observe_sensor, etag, &body, arena);
+            etag_set = 1;
+            if (len > 0)
             {
                 resp.code = COAP_CODE_CONTENT;
-                resp.payload = (uint8_t *)val;
-                resp.payload_len = strlen(val);
-                log_message(task->log_file, "INFO", "GET id=%d: Found", id);
+                resp.payload = (uint8_t *)body;
+                resp.payload_len = (size_t)len;
+                if (registered)
+                    add_uint_option(&resp, COAP_OPTION_OBSERVE, observe_seq(observe_registry));
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET sensor=%d observe=%ld: %s", observe_sensor, observe,
+                            registered ? "Registered" : "Not observing");
             }
             else
             {
-                resp.code = COAP_CODE_NOT_FOUND;
-                log_message(task->log_file, "ERROR", "GET id=%d: Not found", id);
+                // Error responses end an observation (RFC 7641 4.2)
+                if (registered)
+                    observe_cancel(observe_registry, observe_sensor, &task->client_addr, req.token, req.tkl);
+                resp.code = len == 0 ? COAP_CODE_NOT_FOUND : COAP_CODE_INTERNAL_ERROR;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET sensor=%d observe: %s", observe_sensor,
+                            len == 0 ? "No readings" : "Latest reading too large");
+            }
+            break;
+        }
+
+        // Conditional GET: a record is versioned by its own write generation, the
+        // latest reading of a sensor by the sensor's, every list view by the table's.
+        // The tag is read before the data; when the client already holds it the
+        // answer is 2.03 Valid without a lookup.
+        int filtered_get = has_uri_query(&req);
+        int record_id = filtered_get ? 0 : uri_record_id(uri_path);
+        int latest_sensor = filtered_get || !latest_cache ? 0 : parse_sensor_uri(uri_path);
+        char *latest_body = NULL;
+        int latest_len = 0;
+        if (latest_sensor > 0)
+            latest_len = latest_representation(latest_sensor, etag, &latest_body, arena);
+        else if (record_id > 0)
+            etag_for_record(record_id, etag);
+        else
+            etag_for_table(etag);
+        etag_set = 1;
+        if ((!has_block2 || block2.num == 0) && etag_request_matches(&req, etag))
+        {
+            resp.code = COAP_CODE_VALID;
+            log_message(task->log_file, LOG_LEVEL_INFO, "GET %s: Valid (ETag matched)", uri_path ? uri_path : "all");
+            break;
+        }
+
+        // ?after=<id>&limit=<n> without a path: one keyset page of all rows,
+        // sized to fit one datagram, plus the cursor of the next page
+        int after_id = -1, limit = 0;
+        int has_after = query_number(&req, "after", &after_id);
+        if (has_after && (!uri_path || strcmp(uri_path, "all") == 0))
+        {
+            int has_limit = query_number(&req, "limit", &limit);
+            char *page = arena_alloc(arena, PAGE_MAX_PAYLOAD);
+            static const char head[] = "{\"rows\":";
+            const size_t tail_room = sizeof(",\"next\":2147483647}");
+            int next = 0, len = -1;
+            if (has_after < 0 || after_id < 0 || has_limit < 0 || (has_limit && limit <= 0))
+            {
+                resp.code = COAP_CODE_BAD_REQUEST;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET page: invalid cursor or limit");
+                break;
+            }
+            if (page)
+            {
+                memcpy(page, head, sizeof(head) - 1);
+                len = db_get_page(after_id, limit, page + sizeof(head) - 1,
+                                  PAGE_MAX_PAYLOAD - (sizeof(head) - 1) - tail_room, &next);
+            }
+            if (len >= 0)
+            {
+                len += (int)(sizeof(head) - 1);
+                len += snprintf(page + len, PAGE_MAX_PAYLOAD - (size_t)len, ",\"next\":%d}", next);
+                resp.code = COAP_CODE_CONTENT;
+                resp.payload = (uint8_t *)page;
+                resp.payload_len = (size_t)len;
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET page after=%d: Success (next=%d)", after_id, next);
+            }
+            else
+            {
+                resp.code = COAP_CODE_INTERNAL_ERROR;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET page after=%d: Database error", after_id);
+            }
+            break;
+        }
+
+        // sensor/<n>?from=..&to=..&limit=..: time range of one sensor
+        db_range_t range;
+        int filtered = parse_range_query(&req, parse_sensor_uri(uri_path), &range, arena);
+        if (filtered < 0)
+        {
+            resp.code = COAP_CODE_BAD_REQUEST;
+            log_message(task->log_file, LOG_LEVEL_ERROR, "GET: invalid query filter");
+            break;
+        }
+        if (filtered > 0)
+        {
+            db_result = db_get_sensor_range(&range);
+            if (db_result)
+            {
+                resp.code = COAP_CODE_CONTENT;
+                resp.payload = (uint8_t *)db_result;
+                resp.payload_len = strlen(db_result);
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET sensor=%d range: Success", range.sensor);
+            }
+            else
+            {
+                resp.code = COAP_CODE_INTERNAL_ERROR;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET sensor=%d range: Database error", range.sensor);
+            }
+            break;
+        }
+
+        // sensor/<n>: newest reading of sensor n, from memory or, for sensors the
+        // cache does not hold, the database (read with the ETag above)
+        if (latest_sensor > 0)
+        {
+            int len = latest_len;
+            if (len > 0)
+            {
+                resp.code = COAP_CODE_CONTENT;
+                resp.payload = (uint8_t *)latest_body;
+                resp.payload_len = (size_t)len;
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET sensor=%d: Latest", latest_sensor);
+            }
+            else if (len == 0)
+            {
+                resp.code = COAP_CODE_NOT_FOUND;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET sensor=%d: No readings", latest_sensor);
+            }
+            else
+            {
+                resp.code = COAP_CODE_INTERNAL_ERROR;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET sensor=%d: Latest reading too large", latest_sensor);
+            }
+            break;
+        }
+
+        // If uri_path is numeric -> treat as id-get
+        int id = record_id;
+        if (id > 0)
+        {
+            char *val = db_get_by_id(id); // specific ID
+            if (val)
+            {
+                db_result = val;
+                resp.code = COAP_CODE_CONTENT;
+                resp.payload = (uint8_t *)val;
+                resp.payload_len = strlen(val);
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET id=%d: Found", id);
+            }
+            else
+            {
+                resp.code = COAP_CODE_NOT_FOUND;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET id=%d: Not found", id);
             }
         }
         else
@@ -308,15 +1175,16 @@ void *handle_client(void *arg)
             char *all = db_get_all();
             if (all)
             {
+                db_result = all;
                 resp.code = COAP_CODE_CONTENT;
                 resp.payload = (uint8_t *)all;
                 resp.payload_len = strlen(all);
-                log_message(task->log_file, "INFO", "GET all: Success");
+                log_message(task->log_file, LOG_LEVEL_INFO, "GET all: Success");
             }
             else
             {
                 resp.code = COAP_CODE_INTERNAL_ERROR;
-                log_message(task->log_file, "ERROR", "GET all: Database error");
+                log_message(task->log_file, LOG_LEVEL_ERROR, "GET all: Database error");
             }
         }
         break;
@@ -327,7 +1195,7 @@ void *handle_client(void *arg)
         if (req.payload && req.payload_len > 0)
         {
             snprintf(tmpbuf, sizeof(tmpbuf), "%.*s",
-                     (int)req.payload_len, (char *)req.payload);
+                     (int)req.payload_len, (const char *)req.payload);
 
             // If URI is sensor/<n> then insert with sensor id
             int sensor_id = -1;
@@ -339,7 +1207,7 @@ void *handle_client(void *arg)
 
             // explicit id check (payload starts with "N " or "N=") preserved:
             int explicit_id = -1;
-            char *payload_copy = strndup(tmpbuf, sizeof(tmpbuf));
+            char *payload_copy = arena_strndup(arena, tmpbuf, sizeof(tmpbuf));
             if (payload_copy)
             {
                 char *sep = strpbrk(payload_copy, " =");
@@ -349,7 +1217,6 @@ void *handle_client(void *arg)
                     if (is_numeric(payload_copy))
                         explicit_id = atoi(payload_copy);
                 }
-                free(payload_copy);
             }
 
             int id = -1;
@@ -364,42 +1231,45 @@ void *handle_client(void *arg)
                     {
                         snprintf(tmpbuf, sizeof(tmpbuf), "{\"id\":%d}", id);
                         resp.code = COAP_CODE_CREATED;
-                        resp.payload_len = strlen(tmpbuf);
-                        resp.payload = (uint8_t *)malloc(resp.payload_len);
-                        if (resp.payload)
-                            memcpy(resp.payload, tmpbuf, resp.payload_len);
-                        log_message(task->log_file, "INFO", "POST: Created id=%d (explicit)", id);
+                        etag_bump(id);
+                        set_payload_text(&resp, arena, tmpbuf);
+                        log_message(task->log_file, LOG_LEVEL_INFO, "POST: Created id=%d (explicit)", id);
                     }
                     else
                     {
                         resp.code = COAP_CODE_BAD_REQUEST;
-                        log_message(task->log_file, "ERROR", "POST: explicit id=%d insert failed", explicit_id);
+                        log_message(task->log_file, LOG_LEVEL_ERROR, "POST: explicit id=%d insert failed", explicit_id);
                     }
                 }
                 else
                 {
                     resp.code = COAP_CODE_BAD_REQUEST;
-                    log_message(task->log_file, "ERROR", "POST: explicit id provided but no value");
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "POST: explicit id provided but no value");
                 }
             }
             else if (sensor_id > 0)
             {
                 // insert tying to sensor id (db_insert_with_sensor must exist)
-                id = db_insert_with_sensor(sensor_id, tmpbuf);
+                char ts[DB_TS_SIZE];
+                id = db_insert_with_sensor_ts(sensor_id, tmpbuf, ts);
                 if (id > 0)
                 {
+                    // -1: no room in the cache, GET reads this sensor from the database
+                    if (latest_cache && latest_cache_put(latest_cache, sensor_id, id, tmpbuf, ts, 0) != 0)
+                    {
+                        etag_bump_sensor(sensor_id);
+                        notify_observers(sensor_id, arena);
+                    }
                     snprintf(tmpbuf, sizeof(tmpbuf), "{\"id\":%d}", id);
                     resp.code = COAP_CODE_CREATED;
-                    resp.payload_len = strlen(tmpbuf);
-                    resp.payload = (uint8_t *)malloc(resp.payload_len);
-                    if (resp.payload)
-                        memcpy(resp.payload, tmpbuf, resp.payload_len);
-                    log_message(task->log_file, "INFO", "POST: Created id=%d (sensor=%d)", id, sensor_id);
+                    etag_bump(id);
+                    set_payload_text(&resp, arena, tmpbuf);
+                    log_message(task->log_file, LOG_LEVEL_INFO, "POST: Created id=%d (sensor=%d)", id, sensor_id);
                 }
                 else
                 {
                     resp.code = COAP_CODE_INTERNAL_ERROR;
-                    log_message(task->log_file, "ERROR", "POST: sensor insert failed (sensor=%d)", sensor_id);
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "POST: sensor insert failed (sensor=%d)", sensor_id);
                 }
             }
             else
@@ -410,34 +1280,51 @@ void *handle_client(void *arg)
                 {
                     snprintf(tmpbuf, sizeof(tmpbuf), "{\"id\":%d}", id);
                     resp.code = COAP_CODE_CREATED;
-                    resp.payload_len = strlen(tmpbuf);
-                    resp.payload = (uint8_t *)malloc(resp.payload_len);
-                    if (resp.payload)
-                        memcpy(resp.payload, tmpbuf, resp.payload_len);
-                    log_message(task->log_file, "INFO", "POST: Created id=%d", id);
+                    etag_bump(id);
+                    set_payload_text(&resp, arena, tmpbuf);
+                    log_message(task->log_file, LOG_LEVEL_INFO, "POST: Created id=%d", id);
                 }
                 else
                 {
                     resp.code = COAP_CODE_INTERNAL_ERROR;
-                    log_message(task->log_file, "ERROR", "POST: Database insert failed");
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "POST: Database insert failed");
                 }
             }
         }
         else
         {
             resp.code = COAP_CODE_BAD_REQUEST;
-            log_message(task->log_file, "ERROR", "POST: Empty payload");
+            log_message(task->log_file, LOG_LEVEL_ERROR, "POST: Empty payload");
         }
         break;
     }
     // PUT: update record by id (partial update temp/hum, or full replace)
     case COAP_CODE_PUT:
     {
+        // PUT .well-known/trace with "on" or "off": switch request tracing
+        if (uri_path && strcmp(uri_path, TRACE_PATH) == 0)
+        {
+            int on = req.payload_len == 2 && memcmp(req.payload, "on", 2) == 0;
+            if (on || (req.payload_len == 3 && memcmp(req.payload, "off", 3) == 0))
+            {
+                trace_set_enabled(on);
+                resp.code = COAP_CODE_CHANGED;
+                set_payload_text(&resp, arena, on ? "{\"trace\":\"on\"}" : "{\"trace\":\"off\"}");
+                log_message(task->log_file, LOG_LEVEL_INFO, "PUT trace: %s", on ? "on" : "off");
+            }
+            else
+            {
+                resp.code = COAP_CODE_BAD_REQUEST;
+                log_message(task->log_file, LOG_LEVEL_ERROR, "PUT trace: expected on or off");
+            }
+            break;
+        }
+
         int id = -1;
         char *payload = NULL;
         if (req.payload && req.payload_len > 0)
         {
-            char *p = strndup((char *)req.payload, req.payload_len);
+            char *p = arena_strndup(arena, (const char *)req.payload, req.payload_len);
             if (p)
             {
                 /* Accept formats: "id=value" or "id = value" (tolerant to spaces) */
@@ -450,10 +1337,9 @@ void *handle_client(void *arg)
                     if (is_numeric(p))
                     {
                         id = atoi(p);
-                        payload = strdup(eq + 1);
+                        payload = eq + 1;
                     }
                 }
-                free(p);
             }
         }
 
@@ -479,16 +1365,15 @@ void *handle_client(void *arg)
                 {
                     snprintf(tmpbuf, sizeof(tmpbuf), "{\"updated\":%d}", id);
                     resp.code = COAP_CODE_CHANGED;
-                    resp.payload_len = strlen(tmpbuf);
-                    resp.payload = (uint8_t *)malloc(resp.payload_len);
-                    if (resp.payload)
-                        memcpy(resp.payload, tmpbuf, resp.payload_len);
-                    log_message(task->log_file, "INFO", "PUT: Updated id=%d (temp+hum)", id);
+                    etag_bump(id);
+                    refresh_latest(id);
+                    set_payload_text(&resp, arena, tmpbuf);
+                    log_message(task->log_file, LOG_LEVEL_INFO, "PUT: Updated id=%d (temp+hum)", id);
                 }
                 else
                 {
                     resp.code = COAP_CODE_NOT_FOUND;
-                    log_message(task->log_file, "ERROR", "PUT: id=%d not found (temp+hum)\n", id);
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: id=%d not found (temp+hum)\n", id);
                 }
             }
             else if (has_temp)
@@ -500,22 +1385,21 @@ void *handle_client(void *arg)
                     {
                         snprintf(tmpbuf, sizeof(tmpbuf), "{\"updated\":%d}", id);
                         resp.code = COAP_CODE_CHANGED;
-                        resp.payload_len = strlen(tmpbuf);
-                        resp.payload = (uint8_t *)malloc(resp.payload_len);
-                        if (resp.payload)
-                            memcpy(resp.payload, tmpbuf, resp.payload_len);
-                        log_message(task->log_file, "INFO", "PUT: Updated temp id=%d", id);
+                        etag_bump(id);
+                        refresh_latest(id);
+                        set_payload_text(&resp, arena, tmpbuf);
+                        log_message(task->log_file, LOG_LEVEL_INFO, "PUT: Updated temp id=%d", id);
                     }
                     else
                     {
                         resp.code = COAP_CODE_NOT_FOUND;
-                        log_message(task->log_file, "ERROR", "PUT: id=%d not found (temp)", id);
+                        log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: id=%d not found (temp)", id);
                     }
                 }
                 else
                 {
                     resp.code = COAP_CODE_BAD_REQUEST;
-                    log_message(task->log_file, "ERROR", "PUT: temp value parse error for id=%d", id);
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: temp value parse error for id=%d", id);
                 }
             }
             else if (has_hum)
@@ -527,22 +1411,21 @@ void *handle_client(void *arg)
                     {
                         snprintf(tmpbuf, sizeof(tmpbuf), "{\"updated\":%d}", id);
                         resp.code = COAP_CODE_CHANGED;
-                        resp.payload_len = strlen(tmpbuf);
-                        resp.payload = (uint8_t *)malloc(resp.payload_len);
-                        if (resp.payload)
-                            memcpy(resp.payload, tmpbuf, resp.payload_len);
-                        log_message(task->log_file, "INFO", "PUT: Updated hum id=%d", id);
+                        etag_bump(id);
+                        refresh_latest(id);
+                        set_payload_text(&resp, arena, tmpbuf);
+                        log_message(task->log_file, LOG_LEVEL_INFO, "PUT: Updated hum id=%d", id);
                     }
                     else
                     {
                         resp.code = COAP_CODE_NOT_FOUND;
-                        log_message(task->log_file, "ERROR", "PUT: id=%d not found (hum)", id);
+                        log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: id=%d not found (hum)", id);
                     }
                 }
                 else
                 {
                     resp.code = COAP_CODE_BAD_REQUEST;
-                    log_message(task->log_file, "ERROR", "PUT: hum value parse error for id=%d", id);
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: hum value parse error for id=%d", id);
                 }
             }
             else
@@ -552,25 +1435,22 @@ void *handle_client(void *arg)
                 {
                     snprintf(tmpbuf, sizeof(tmpbuf), "{\"updated\":%d}", id);
                     resp.code = COAP_CODE_CHANGED;
-                    resp.payload_len = strlen(tmpbuf);
-                    resp.payload = (uint8_t *)malloc(resp.payload_len);
-                    if (resp.payload)
-                        memcpy(resp.payload, tmpbuf, resp.payload_len);
-                    log_message(task->log_file, "INFO", "PUT: Updated id=%d (full replace)", id);
+                    etag_bump(id);
+                    refresh_latest(id);
+                    set_payload_text(&resp, arena, tmpbuf);
+                    log_message(task->log_file, LOG_LEVEL_INFO, "PUT: Updated id=%d (full replace)", id);
                 }
                 else
                 {
                     resp.code = COAP_CODE_NOT_FOUND;
-                    log_message(task->log_file, "ERROR", "PUT: id=%d not found (full)", id);
+                    log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: id=%d not found (full)", id);
                 }
             }
-
-            free(payload);
         }
         else
         {
             resp.code = COAP_CODE_BAD_REQUEST;
-            log_message(task->log_file, "ERROR", "PUT: Invalid format (expected: id=value)");
+            log_message(task->log_file, LOG_LEVEL_ERROR, "PUT: Invalid format (expected: id=value)");
         }
         break;
     }
@@ -580,72 +1460,101 @@ void *handle_client(void *arg)
         int id = -1;
         if (req.payload && req.payload_len > 0)
         {
-            char *p = strndup((char *)req.payload, req.payload_len);
+            char *p = arena_strndup(arena, (const char *)req.payload, req.payload_len);
             if (p && is_numeric(p))
                 id = atoi(p);
-            free(p);
         }
         if (id > 0 && db_delete(id) == 0)
         {
             snprintf(tmpbuf, sizeof(tmpbuf), "{\"deleted\":%d}", id);
             resp.code = COAP_CODE_DELETED;
-            resp.payload_len = strlen(tmpbuf);
-            resp.payload = (uint8_t *)malloc(resp.payload_len);
-            if (resp.payload)
-            {
-                memcpy(resp.payload, tmpbuf, resp.payload_len);
-            }
-            log_message(task->log_file, "INFO", "DELETE: Deleted id=%d", id);
+            etag_bump(id);
+            refresh_latest(id);
+            set_payload_text(&resp, arena, tmpbuf);
+            log_message(task->log_file, LOG_LEVEL_INFO, "DELETE: Deleted id=%d", id);
         }
         else
         {
             resp.code = COAP_CODE_NOT_FOUND;
-            log_message(task->log_file, "ERROR", "DELETE: id=%d not found or invalid", id);
+            log_message(task->log_file, LOG_LEVEL_ERROR, "DELETE: id=%d not found or invalid", id);
         }
         break;
     }
     default:
         resp.code = COAP_CODE_BAD_REQUEST;
-        log_message(task->log_file, "ERROR", "Unsupported method code: %d", req.code);
+        log_message(task->log_file, LOG_LEVEL_ERROR, "Unsupported method code: %d", req.code);
         break;
     }
+    uint64_t t_handled = stage_clock();
 
-    // send response (using dynamic buffer sized to payload to avoid truncation for GET all)
-    size_t out_size = (size_t)resp.payload_len + 512; // overhead for header/options
-    uint8_t *out = malloc(out_size);
+    // Fresh GET representations (and 2.03 revalidations) carry their ETag and Max-Age
+    if (etag_set && (resp.code == COAP_CODE_CONTENT || resp.code == COAP_CODE_VALID))
+        etag_tag_response(&resp, etag, max_age);
+    if (req.code == COAP_CODE_GET && block_cache && !block_served && resp.code == COAP_CODE_CONTENT)
+        slice_block2(task, &req, has_block2 > 0 ? &block2 : NULL, etag_set ? etag : NULL, &resp);
+
+    // send response: exact wire size, serialized on the stack unless it exceeds one MTU (GET all)
+    uint8_t out_small[OUT_STACK_SIZE];
+    size_t out_size = coap_serialized_size(&resp);
+    uint8_t *out = out_size <= sizeof(out_small) ? out_small : arena_alloc(arena, out_size);
+    if (separate)
+    {
+        resp.type = COAP_TYPE_CON;
+        resp.message_id = (uint16_t)atomic_fetch_add_explicit(&next_mid, 1, memory_order_relaxed);
+    }
+
+    int out_len = 0;
     if (out)
     {
         int len = coap_serialize(&resp, out, out_size);
+        // Track before sending so a fast ACK always finds the entry
+        if (len > 0 && separate &&
+            retx_add(retx_tracker, task->sock, &task->client_addr, resp.message_id, out, (size_t)len) != 0)
+            log_message(task->log_file, LOG_LEVEL_ERROR, "Separate response MID=%u not tracked", resp.message_id);
         if (len > 0)
         {
-            sendto(task->sock, (const char *)out, len, 0,
-                   (struct sockaddr *)&task->client_addr, task->addr_len);
+            PROBE3(response_send, req.message_id, resp.code, len);
+            udp_tx_send(task->sock, out, (size_t)len,
+                        (struct sockaddr *)&task->client_addr, task->addr_len);
+            out_len = len;
         }
         else
         {
-            log_message(task->log_file, "ERROR", "coap_serialize failed (out_size=%zu payload_len=%zu)\n",
+            log_message(task->log_file, LOG_LEVEL_ERROR, "coap_serialize failed (out_size=%zu payload_len=%zu)\n",
                     out_size, (size_t)resp.payload_len);
         }
-        free(out);
     }
     else
     {
-        log_message(task->log_file, "ERROR", "malloc failed for out buffer (size=%zu)", out_size);
+        log_message(task->log_file, LOG_LEVEL_ERROR, "allocation failed for out buffer (size=%zu)", out_size);
     }
 
+    uint64_t t_sent = stage_clock();
+    if (t_start && t_sent)
+    {
+        uint64_t stages[METRICS_STAGES] = {t_parsed - t_start, t_handled - t_dispatch, t_sent - t_handled,
+                                           t_sent - t_start};
+        metrics_record(req.code, resp.code, stages);
+        if (trace_enabled())
+        {
+            trace_stamps_t st = {task->rx_ns, t_start, t_parsed, t_dispatch, t_handled, t_sent,
+                                 req.message_id, req.code, resp.code};
+            trace_record(&st, uri_path);
+        }
+    }
+
+    if (dedup_tracked)
+        dedup_complete(dedup_cache, &task->client_addr, req.message_id, out, (size_t)out_len);
+
     // Log summary
-    log_message(task->log_file, "INFO", "Processed MID=%u Code=%u Uri=%s Response=%d",
-            req.message_id, req.code,
-            uri_path ? uri_path : "(none)",
-            resp.code);
-    fflush(task->log_file);
-
-    // Free memory
-    if (uri_path)
-        free(uri_path);
-    coap_free_message(&req);
+    log_request(task->log_file, &req, uri_path, resp.code);
+
+    // Free memory: the DB result is on the heap, everything else lives in the arena
+    resp.payload = NULL;
     coap_free_message(&resp);
-    free(task);
+    free(db_result);
+    arena_reset(arena);
+    release_task(task);
 
 #if defined(_WIN32) || defined(_WIN64)
     return 0;
@@ -654,13 +1563,716 @@ void *handle_client(void *arg)
 #endif
 }
 
+/* ------------------------
+   Command line
+   ------------------------ */
+static void usage(const char *me)
+{
+    fprintf(stderr, "Usage: %s [PORT] [LogFile] [options]\n", me);
+    fprintf(stderr, "  --workers N         worker threads (default %d)\n", DEFAULT_WORKERS);
+    fprintf(stderr, "  --queue N           request queue capacity (default %d)\n", DEFAULT_QUEUE_CAPACITY);
+    fprintf(stderr, "  --stats-interval S  seconds between pool stats log lines, 0 = off (default %d)\n",
+            DEFAULT_STATS_INTERVAL);
+    fprintf(stderr, "  --shards N          SO_REUSEPORT receive sockets, one thread + pool each (default 1)\n");
+    fprintf(stderr, "  --no-pin            do not pin shard receive threads to cores\n");
+    fprintf(stderr, "  --batch N           datagrams per recvmmsg/sendmmsg call, 1..%d (default %d)\n",
+            UDP_MAX_BATCH, DEFAULT_BATCH);
+    fprintf(stderr, "  --tx-delay-us U     longest a response waits for its send batch, 0 = no bound (default %d)\n",
+            UDP_DEFAULT_TX_DELAY_US);
+    fprintf(stderr, "  --io-uring          io_uring receive/send backend\n");
+    fprintf(stderr, "  --uring-depth N     receives kept in flight per shard with --io-uring (default %d)\n",
+            DEFAULT_URING_DEPTH);
+    fprintf(stderr, "  --task-buf N        pooled datagram buffer bytes, %d..%d (default %d)\n",
+            MIN_TASK_BUF, BUF_SIZE, DEFAULT_TASK_BUF);
+    fprintf(stderr, "  --exchange-lifetime S  seconds a Message ID is deduplicated, 0 = off (default %d)\n",
+            EXCHANGE_LIFETIME);
+    fprintf(stderr, "  --separate          empty ACK immediately, result as a separate CON response\n");
+    fprintf(stderr, "  --db-readers N      read-only SQLite connections (default %d)\n", DB_DEFAULT_READERS);
+    fprintf(stderr, "  --db-busy-timeout MS  retry time on a locked database (default %d)\n",
+            DB_DEFAULT_BUSY_TIMEOUT_MS);
+    fprintf(stderr, "  --db-autocheckpoint N  WAL pages before an automatic checkpoint, 0 = off (default %d)\n",
+            DB_DEFAULT_WAL_AUTOCHECKPOINT);
+    fprintf(stderr, "  --db-checkpoint-interval S  seconds between explicit checkpoints, 0 = off (default 0)\n");
+    fprintf(stderr, "  --group-commit N    commit POST inserts N rows per transaction, 0 = off (default 0)\n");
+    fprintf(stderr, "  --group-commit-ms M longest wait for a batch to fill (default %d)\n", DEFAULT_GROUP_COMMIT_MS);
+    fprintf(stderr, "  --no-observe        ignore Observe registrations on sensor/<n>\n");
+    fprintf(stderr, "  --no-metrics        do not time requests for GET %s\n", METRICS_PATH);
+    fprintf(stderr, "  --trace             start with request tracing on (PUT %s on|off switches it)\n", TRACE_PATH);
+    fprintf(stderr, "  --trace-file PATH   where SIGQUIT writes the Chrome trace (default %s)\n", TRACE_DEFAULT_FILE);
+    fprintf(stderr, "  --log-ring N        log lines queued for the log writer thread, 0 = synchronous (default %d)\n",
+            ASYNC_LOG_DEFAULT_CAPACITY);
+    fprintf(stderr, "  --log-level L       error or info; SIGUSR1 raises, SIGUSR2 lowers it at runtime (default info)\n");
+    fprintf(stderr, "  --log-sample N      log the INFO lines of 1 in N requests, errors always (default 1)\n");
+    fprintf(stderr, "  --log-format F      text or binary (fixed-size records, read with log_decode)\n");
+    fprintf(stderr, "  --max-age S         Max-Age of GET responses in seconds (default %d)\n", DEFAULT_MAX_AGE);
+    fprintf(stderr, "  --block-size N      Block2 size for large GET bodies, 16..1024, 0 = off (default %d)\n",
+            DEFAULT_BLOCK_SIZE);
+}
+
+// Parse argv into cfg. Positional arguments keep the historical PORT/LogFile order.
+// Returns 0 on success, -1 on invalid input.
+static int parse_args(int argc, char *argv[], server_config_t *cfg)
+{
+    cfg->port = DEFAULT_PORT;
+    cfg->log_path = NULL;
+    cfg->workers = DEFAULT_WORKERS;
+    cfg->queue_capacity = DEFAULT_QUEUE_CAPACITY;
+    cfg->stats_interval = DEFAULT_STATS_INTERVAL;
+    cfg->shards = 1;
+    cfg->pin = 1;
+    cfg->batch = DEFAULT_BATCH;
+    cfg->tx_delay_us = UDP_DEFAULT_TX_DELAY_US;
+    cfg->io_uring = 0;
+    cfg->uring_depth = DEFAULT_URING_DEPTH;
+    cfg->task_buf = DEFAULT_TASK_BUF;
+    cfg->exchange_lifetime = EXCHANGE_LIFETIME;
+    cfg->separate = 0;
+    db_default_config(&cfg->db);
+    cfg->checkpoint_interval = 0;
+    cfg->group_commit = 0;
+    cfg->group_commit_ms = DEFAULT_GROUP_COMMIT_MS;
+    cfg->block_size = DEFAULT_BLOCK_SIZE;
+    cfg->observe = 1;
+    cfg->metrics = 1;
+    cfg->trace = 0;
+    cfg->trace_file = TRACE_DEFAULT_FILE;
+    cfg->max_age = DEFAULT_MAX_AGE;
+    cfg->log_ring = ASYNC_LOG_DEFAULT_CAPACITY;
+    cfg->log_level = LOG_LEVEL_INFO;
+    cfg->log_sample = 1;
+    cfg->log_binary = 0;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        if (strncmp(a, "--", 2) != 0)
+        {
+            if (positional == 0)
+                cfg->port = atoi(a);
+            else if (positional == 1)
+                cfg->log_path = a;
+            else
+                return -1;
+            positional++;
+            continue;
+        }
+        if (strcmp(a, "--no-pin") == 0)
+        {
+            cfg->pin = 0;
+            continue;
+        }
+        if (strcmp(a, "--io-uring") == 0)
+        {
+            cfg->io_uring = 1;
+            continue;
+        }
+        if (strcmp(a, "--separate") == 0)
+        {
+            cfg->separate = 1;
+            continue;
+        }
+        if (strcmp(a, "--trace") == 0)
+        {
+            cfg->trace = 1;
+            continue;
+        }
+        if (strcmp(a, "--no-metrics") == 0)
+        {
+            cfg->metrics = 0;
+            continue;
+        }
+        if (strcmp(a, "--no-observe") == 0)
+        {
+            cfg->observe = 0;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return -1;
+        const char *v = argv[++i];
+        if (strcmp(a, "--workers") == 0)
+            cfg->workers = (size_t)atoi(v);
+        else if (strcmp(a, "--queue") == 0)
+            cfg->queue_capacity = (size_t)atoi(v);
+        else if (strcmp(a, "--stats-interval") == 0)
+            cfg->stats_interval = atoi(v);
+        else if (strcmp(a, "--shards") == 0)
+            cfg->shards = atoi(v);
+        else if (strcmp(a, "--batch") == 0)
+            cfg->batch = (size_t)atoi(v);
+        else if (strcmp(a, "--tx-delay-us") == 0)
+            cfg->tx_delay_us = atoi(v);
+        else if (strcmp(a, "--uring-depth") == 0)
+            cfg->uring_depth = (unsigned)atoi(v);
+        else if (strcmp(a, "--task-buf") == 0)
+            cfg->task_buf = (size_t)atoi(v);
+        else if (strcmp(a, "--exchange-lifetime") == 0)
+            cfg->exchange_lifetime = atoi(v);
+        else if (strcmp(a, "--db-readers") == 0)
+            cfg->db.readers = atoi(v);
+        else if (strcmp(a, "--db-busy-timeout") == 0)
+            cfg->db.busy_timeout_ms = atoi(v);
+        else if (strcmp(a, "--db-autocheckpoint") == 0)
+            cfg->db.wal_autocheckpoint = atoi(v);
+        else if (strcmp(a, "--db-checkpoint-interval") == 0)
+            cfg->checkpoint_interval = atoi(v);
+        else if (strcmp(a, "--group-commit") == 0)
+            cfg->group_commit = atoi(v);
+        else if (strcmp(a, "--group-commit-ms") == 0)
+            cfg->group_commit_ms = atoi(v);
+        else if (strcmp(a, "--block-size") == 0)
+            cfg->block_size = atoi(v);
+        else if (strcmp(a, "--max-age") == 0)
+            cfg->max_age = atoi(v);
+        else if (strcmp(a, "--log-ring") == 0)
+            cfg->log_ring = (size_t)atol(v);
+        else if (strcmp(a, "--log-level") == 0)
+            cfg->log_level = strcasecmp(v, "error") == 0 ? LOG_LEVEL_ERROR : strcasecmp(v, "info") == 0 ? LOG_LEVEL_INFO : -1;
+        else if (strcmp(a, "--log-sample") == 0)
+            cfg->log_sample = atoi(v);
+        else if (strcmp(a, "--log-format") == 0)
+            cfg->log_binary = strcmp(v, "binary") == 0 ? 1 : strcmp(v, "text") == 0 ? 0 : -1;
+        else if (strcmp(a, "--trace-file") == 0)
+            cfg->trace_file = v;
+        else
+            return -1;
+    }
+    if (cfg->port <= 0 || cfg->port > 65535 || cfg->workers == 0 || cfg->queue_capacity == 0 ||
+        cfg->shards < 1 || cfg->batch < 1 || cfg->batch > UDP_MAX_BATCH || cfg->tx_delay_us < 0 ||
+        cfg->uring_depth < 1 || cfg->uring_depth > 4096 ||
+        cfg->task_buf < MIN_TASK_BUF || cfg->task_buf > BUF_SIZE || cfg->exchange_lifetime < 0 ||
+        cfg->db.readers < 0 || cfg->db.busy_timeout_ms < 0 || cfg->db.wal_autocheckpoint < 0 ||
+        cfg->checkpoint_interval < 0 || cfg->group_commit < 0 || cfg->group_commit_ms < 0 ||
+        (cfg->block_size != 0 && (cfg->block_size < 16 || cfg->block_size > 1024)) || cfg->max_age < 0 ||
+        cfg->log_ring > ASYNC_LOG_MAX_CAPACITY || cfg->log_level < 0 || cfg->log_sample < 1 || cfg->log_binary < 0)
+        return -1;
+    return 0;
+}
+
+// Open a UDP socket bound to INADDR_ANY:port. With reuseport set, several
+// sockets may bind the same port and the kernel hashes flows across them.
+static int open_udp_socket(int port, int reuseport)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+#ifdef SO_REUSEPORT
+    if (reuseport)
+    {
+        int one = 1;
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+        {
+            perror("setsockopt SO_REUSEPORT");
+            close_socket(sock);
+            return -1;
+        }
+    }
+#else
+    (void)reuseport;
+#endif
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close_socket(sock);
+        return -1;
+    }
+    return sock;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/* ------------------------
+   Receive shards
+   ------------------------ */
+// One receive socket, its receive thread and its worker pool. With --shards N
+// the N sockets share the port through SO_REUSEPORT.
+typedef struct
+{
+    int index;
+    int sock;
+    int cpu;                        // core the receive thread is pinned to (-1 = not pinned)
+    size_t batch;                   // datagrams per recvmmsg call
+    int io_uring;                   // receive through io_uring instead of recvmmsg
+    unsigned uring_depth;
+    size_t task_buf;                // datagram bytes held by a pooled task
+    FILE *log_file;
+    worker_pool_t pool;
+    slab_pool_t tasks;              // recycled client_task_t objects
+    pthread_t rx_thread;
+    _Atomic uint64_t rx_datagrams;
+    _Atomic uint64_t rx_syscalls;
+    _Atomic uint64_t rx_oversized;  // datagrams larger than task_buf (copied to a heap task)
+} shard_t;
+
+// Log queue depth, worker utilization and datagrams per receive syscall so
+// the pool and batch sizes can be tuned.
+static void log_pool_stats(FILE *logf, shard_t *sh)
+{
+    worker_pool_stats_t st;
+    worker_pool_get_stats(&sh->pool, &st);
+    uint64_t rx_dgrams = atomic_load_explicit(&sh->rx_datagrams, memory_order_relaxed);
+    uint64_t rx_calls = atomic_load_explicit(&sh->rx_syscalls, memory_order_relaxed);
+    log_message(logf, LOG_LEVEL_INFO,
+                "Shard %d pool: workers=%zu busy=%zu depth=%zu/%zu max_depth=%zu submitted=%llu "
+                "completed=%llu dropped=%llu utilization=%.1f%% rx=%llu/%llu calls (%.2f per call)",
+                sh->index, st.workers, st.busy, st.depth, st.capacity, st.max_depth,
+                (unsigned long long)st.submitted, (unsigned long long)st.completed,
+                (unsigned long long)st.rejected, st.utilization * 100.0,
+                (unsigned long long)rx_dgrams, (unsigned long long)rx_calls,
+                rx_calls ? (double)rx_dgrams / (double)rx_calls : 0.0);
+
+    slab_pool_stats_t ts;
+    slab_pool_get_stats(&sh->tasks, &ts);
+    log_message(logf, LOG_LEVEL_INFO, "Shard %d tasks: in_use=%zu/%zu object=%zuB slab_misses=%llu oversized=%llu",
+                sh->index, ts.in_use, ts.count, ts.obj_size, (unsigned long long)ts.misses,
+                (unsigned long long)atomic_load_explicit(&sh->rx_oversized, memory_order_relaxed));
+}
+
+// Allocations per request served by the worker arenas vs. heap fallbacks
+static void log_arena_stats(FILE *logf)
+{
+    arena_stats_t st;
+    arena_get_stats(&st);
+    double reqs = st.requests ? (double)st.requests : 1.0;
+    log_message(logf, LOG_LEVEL_INFO, "Arena: requests=%llu allocs/request=%.2f heap fallbacks/request=%.3f",
+                (unsigned long long)st.requests, (double)st.allocs / reqs, (double)st.fallbacks / reqs);
+}
+
+// Duplicate requests answered from the cache vs. new exchanges
+static void log_dedup_stats(FILE *logf)
+{
+    if (!dedup_cache)
+        return;
+    dedup_stats_t st;
+    dedup_get_stats(dedup_cache, &st);
+    log_message(logf, LOG_LEVEL_INFO, "Dedup: entries=%zu hits=%llu misses=%llu in_progress_drops=%llu expired=%llu",
+                st.entries, (unsigned long long)st.hits, (unsigned long long)st.misses,
+                (unsigned long long)st.inflight, (unsigned long long)st.expired);
+}
+
+// Observers and the notifications fanned out to them
+static void log_observe_stats(FILE *logf)
+{
+    if (!observe_registry)
+        return;
+    observe_stats_t st;
+    observe_get_stats(observe_registry, &st);
+    log_message(logf, LOG_LEVEL_INFO, "Observe: observers=%zu notifications=%llu sent=%llu cancelled=%llu expired=%llu",
+                st.observers, (unsigned long long)st.notifications, (unsigned long long)st.sent,
+                (unsigned long long)st.cancelled, (unsigned long long)st.expired);
+}
+
+// Lines written by the log writer thread and lines lost to a full ring
+static void log_async_stats(FILE *logf)
+{
+    if (!async_log_active(logf))
+        return;
+    async_log_stats_t st;
+    async_log_get_stats(&st);
+    log_message(logf, LOG_LEVEL_INFO, "Log: lines=%llu batches=%llu (%.1f lines per write) dropped=%llu",
+                (unsigned long long)st.lines, (unsigned long long)st.batches,
+                st.batches ? (double)st.lines / (double)st.batches : 0.0, (unsigned long long)st.dropped);
+}
+
+// Sensors in the latest-reading cache and how GET sensor/<n> was served
+static void log_latest_stats(FILE *logf)
+{
+    if (!latest_cache)
+        return;
+    latest_stats_t st;
+    latest_cache_get_stats(latest_cache, &st);
+    log_message(logf, LOG_LEVEL_INFO, "Latest: sensors=%zu hits=%llu misses=%llu updates=%llu", st.sensors,
+                (unsigned long long)st.hits, (unsigned long long)st.misses, (unsigned long long)st.updates);
+}
+
+// Block-wise GET transfers in flight and blocks served from their snapshots
+static void log_block_stats(FILE *logf)
+{
+    if (!block_cache)
+        return;
+    block_cache_stats_t st;
+    block_cache_get_stats(block_cache, &st);
+    log_message(logf, LOG_LEVEL_INFO, "Block2: snapshots=%zu bytes=%zu hits=%llu misses=%llu expired=%llu",
+                st.snapshots, st.bytes, (unsigned long long)st.hits, (unsigned long long)st.misses,
+                (unsigned long long)st.expired);
+}
+
+// CON messages (separate responses, CON notifications): ACKed, retransmitted, given up
+static void log_retx_stats(FILE *logf)
+{
+    if (!retx_tracker)
+        return;
+    retx_stats_t st;
+    retx_get_stats(retx_tracker, &st);
+    log_message(logf, LOG_LEVEL_INFO, "CON: outstanding=%zu sent=%llu acked=%llu retransmits=%llu gave_up=%llu",
+                st.outstanding, (unsigned long long)st.sent, (unsigned long long)st.acked,
+                (unsigned long long)st.retransmits, (unsigned long long)st.gave_up);
+}
+
+// Rows per ingest transaction when group commit is on
+static void log_group_commit_stats(FILE *logf)
+{
+    uint64_t batches, rows;
+    db_group_commit_stats(&batches, &rows);
+    if (batches == 0)
+        return;
+    log_message(logf, LOG_LEVEL_INFO, "Group commit: transactions=%llu rows=%llu (%.1f rows per commit)",
+                (unsigned long long)batches, (unsigned long long)rows, (double)rows / (double)batches);
+}
+
+// Transmit side counters are process-wide (workers of every shard batch into sendmmsg).
+static void log_tx_stats(FILE *logf)
+{
+    udp_io_counters_t tx;
+    udp_tx_get_counters(&tx);
+    log_message(logf, LOG_LEVEL_INFO, "UDP tx: datagrams=%llu calls=%llu (%.2f per call) timed_flushes=%llu",
+                (unsigned long long)tx.datagrams, (unsigned long long)tx.syscalls,
+                tx.syscalls ? (double)tx.datagrams / (double)tx.syscalls : 0.0, (unsigned long long)tx.timed_flushes);
+}
+
+// Write every traced request still in the workers' rings to path (SIGQUIT)
+static void dump_trace(FILE *logf, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        log_message(logf, LOG_LEVEL_ERROR, "Trace: cannot write %s", path);
+        return;
+    }
+    size_t n = trace_write_json(f, 0);
+    if (fclose(f) != 0)
+        log_message(logf, LOG_LEVEL_ERROR, "Trace: error writing %s", path);
+    else
+        log_message(logf, LOG_LEVEL_INFO, "Trace: %zu requests written to %s", n, path);
+}
+
+// Take a task able to hold buf_size datagram bytes: from the shard slab when it
+// fits and the slab is not exhausted, otherwise from the heap.
+static client_task_t *alloc_task(shard_t *sh, size_t buf_size)
+{
+    client_task_t *task = NULL;
+    if (buf_size <= sh->task_buf && (task = slab_pool_alloc(&sh->tasks)) != NULL)
+    {
+        task->slab = &sh->tasks;
+        return task;
+    }
+    if (buf_size < sh->task_buf)
+        buf_size = sh->task_buf;
+    task = malloc(sizeof(*task) + buf_size);
+    if (task)
+        task->slab = NULL;
+    return task;
+}
+
+// --separate: empty ACK for a CON request, read from the fixed header only
+// (the worker parses the rest). Returns 0 when the datagram needs none.
+static int separate_ack(const client_task_t *task, uint8_t ack[4])
+{
+    const uint8_t *b = task->buffer;
+    if (!separate_responses || task->msg_len < 4 || (b[0] >> 6) != COAP_VERSION ||
+        ((b[0] >> 4) & 0x03) != COAP_TYPE_CON || (b[0] & 0x0F) > 8 || b[1] == COAP_CODE_EMPTY || (b[1] >> 5) != 0)
+        return 0;
+    ack[0] = (uint8_t)(COAP_VERSION << 6 | COAP_TYPE_ACK << 4); // no token
+    ack[1] = COAP_CODE_EMPTY;
+    ack[2] = b[2]; // Message ID of the request, already in network order
+    ack[3] = b[3];
+    return 1;
+}
+
+// Hand one received datagram to the shard pool (or drop it when the queue is full).
+// With --separate a CON request that will be queued is acknowledged here, so
+// requests waiting behind a slow database do not keep the client retransmitting.
+static void dispatch_task(shard_t *sh, client_task_t *task)
+{
+    task->sock = sh->sock;
+    task->log_file = sh->log_file;
+    task->rx_ns = trace_now();
+    if (task->msg_len <= 0)
+    {
+        release_task(task);
+        return;
+    }
+
+    // The ACK goes out before the worker can send the response. This thread is
+    // the only one submitting to the shard pool, so room now means the submit
+    // below succeeds: a request is never ACKed and then dropped.
+    uint8_t ack[4];
+    if (separate_ack(task, ack) && worker_pool_has_room(&sh->pool))
+    {
+        udp_tx_send(sh->sock, ack, sizeof(ack), (struct sockaddr *)&task->client_addr, task->addr_len);
+        udp_tx_flush();
+    }
+
+    // The probe fires only for queued tasks, and the task may already be
+    // running (or done) by then: only its address is passed, as a key
+    void *key = task;
+    int len = task->msg_len;
+    if (worker_pool_submit(&sh->pool, task) != 0)
+    {
+        // Queue full: drop the datagram, the client will retransmit
+        release_task(task);
+        return;
+    }
+    PROBE2(request_receive, key, len);
+}
+
+#ifdef HAVE_IO_URING
+// Per-slot state of the io_uring receive loop: one RECVMSG in flight per slot
+typedef struct
+{
+    struct msghdr hdr;
+    struct iovec iov;
+    struct sockaddr_in addr;
+} uring_rx_slot_t;
+
+static int uring_arm_recv(uring_t *ring, int sock, uring_rx_slot_t *slot, size_t idx)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe)
+        return -1;
+    memset(&slot->hdr, 0, sizeof(slot->hdr));
+    slot->hdr.msg_name = &slot->addr;
+    slot->hdr.msg_namelen = sizeof(slot->addr);
+    slot->hdr.msg_iov = &slot->iov;
+    slot->hdr.msg_iovlen = 1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock;
+    sqe->addr = (uint64_t)(uintptr_t)&slot->hdr;
+    sqe->len = 1;
+    sqe->user_data = idx;
+    return 0;
+}
+
+// io_uring receive loop: keep uring_depth RECVMSGs in flight over one buffer
+// slab, re-arm each slot as soon as its datagram is copied out, and submit the
+// re-arms together with the next wait (one io_uring_enter per wakeup).
+// Returns -1 if the ring cannot be set up, or keeps failing, so the caller can
+// fall back to recvmmsg.
+static int receive_loop_uring(shard_t *sh)
+{
+    uring_t ring;
+    unsigned depth = sh->uring_depth;
+    if (uring_init(&ring, depth) != 0)
+        return -1;
+
+    uring_rx_slot_t *slots = calloc(depth, sizeof(*slots));
+    uint8_t *slab = malloc((size_t)depth * BUF_SIZE);
+    if (!slots || !slab)
+    {
+        free(slots);
+        free(slab);
+        uring_exit(&ring);
+        return -1;
+    }
+    for (unsigned i = 0; i < depth; i++)
+    {
+        slots[i].iov.iov_base = slab + (size_t)i * BUF_SIZE;
+        slots[i].iov.iov_len = BUF_SIZE;
+    }
+
+    for (unsigned i = 0; i < depth; i++)
+        uring_arm_recv(&ring, sh->sock, &slots[i], i);
+
+    log_message(sh->log_file, LOG_LEVEL_INFO, "Shard %d: io_uring backend, %u receives in flight", sh->index, depth);
+
+    int running = 1, failures = 0;
+    while (running)
+    {
+        if (uring_submit_and_wait(&ring, 1) < 0)
+        {
+            // Back off (2 ms, 4 ms, ...) in case the kernel is short of memory;
+            // completions already posted are still reaped below
+            if (++failures >= URING_MAX_FAILURES)
+            {
+                log_message(sh->log_file, LOG_LEVEL_ERROR, "Shard %d: io_uring_enter keeps failing (%s)", sh->index,
+                            strerror(errno));
+                break;
+            }
+            struct timespec pause = {0, 1000000L << failures};
+            nanosleep(&pause, NULL);
+        }
+        else
+        {
+            failures = 0;
+            atomic_fetch_add_explicit(&sh->rx_syscalls, 1, memory_order_relaxed);
+        }
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(&ring)) != NULL)
+        {
+            size_t idx = (size_t)cqe->user_data;
+            int res = cqe->res;
+            uring_cqe_seen(&ring);
+            uring_rx_slot_t *slot = &slots[idx];
+
+            if (res == -EBADF)
+            {
+                running = 0; // socket closed on shutdown
+                continue;
+            }
+            if (res > 0)
+            {
+                atomic_fetch_add_explicit(&sh->rx_datagrams, 1, memory_order_relaxed);
+                if ((size_t)res > sh->task_buf)
+                    atomic_fetch_add_explicit(&sh->rx_oversized, 1, memory_order_relaxed);
+                client_task_t *task = alloc_task(sh, (size_t)res);
+                if (task)
+                {
+                    memcpy(task->buffer, slot->iov.iov_base, (size_t)res);
+                    memcpy(&task->client_addr, &slot->addr, sizeof(slot->addr));
+                    task->addr_len = slot->hdr.msg_namelen;
+                    task->msg_len = res;
+                    dispatch_task(sh, task);
+                }
+            }
+            uring_arm_recv(&ring, sh->sock, slot, idx);
+        }
+    }
+
+    uring_exit(&ring); // closing the ring cancels the receives still in flight
+    free(slots);
+    free(slab);
+    return running ? -1 : 0;
+}
+#endif
+
+// Receive thread: pull up to `batch` datagrams per recvmmsg call (or keep
+// io_uring receives in flight) off the shard socket and hand them to the pool.
+static void *receive_loop(void *arg)
+{
+    shard_t *sh = (shard_t *)arg;
+
+    if (sh->cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(sh->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            log_message(sh->log_file, LOG_LEVEL_ERROR, "Shard %d: cannot pin receive thread to CPU %d",
+                        sh->index, sh->cpu);
+    }
+
+    if (sh->io_uring)
+    {
+#ifdef HAVE_IO_URING
+        if (receive_loop_uring(sh) == 0)
+            return NULL;
+#endif
+        log_message(sh->log_file, LOG_LEVEL_ERROR, "Shard %d: io_uring unavailable, using recvmmsg", sh->index);
+    }
+
+    client_task_t *tasks[UDP_MAX_BATCH] = {0};
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    struct iovec iov[UDP_MAX_BATCH][2];
+
+    // Datagrams larger than task_buf spill into a per-slot overflow area and
+    // are copied into a heap task of the right size.
+    size_t spill = BUF_SIZE - sh->task_buf;
+    uint8_t *overflow = spill ? malloc(sh->batch * spill) : NULL;
+    if (spill && !overflow)
+        log_message(sh->log_file, LOG_LEVEL_ERROR, "Shard %d: no overflow buffer, datagrams over %zu bytes are truncated",
+                    sh->index, sh->task_buf);
+
+    while (1)
+    {
+        // Refill the slots consumed by the previous call
+        size_t ready = 0;
+        while (ready < sh->batch)
+        {
+            if (!tasks[ready] && !(tasks[ready] = alloc_task(sh, sh->task_buf)))
+                break;
+            client_task_t *task = tasks[ready];
+            iov[ready][0].iov_base = task->buffer;
+            iov[ready][0].iov_len = sh->task_buf;
+            memset(&msgs[ready], 0, sizeof(msgs[ready]));
+            msgs[ready].msg_hdr.msg_name = &task->client_addr;
+            msgs[ready].msg_hdr.msg_namelen = sizeof(task->client_addr);
+            msgs[ready].msg_hdr.msg_iov = iov[ready];
+            msgs[ready].msg_hdr.msg_iovlen = 1;
+            if (overflow)
+            {
+                iov[ready][1].iov_base = overflow + ready * spill;
+                iov[ready][1].iov_len = spill;
+                msgs[ready].msg_hdr.msg_iovlen = 2;
+            }
+            ready++;
+        }
+        if (ready == 0)
+        {
+            sleep(1); // out of memory, back off
+            continue;
+        }
+
+        int n = recvmmsg(sh->sock, msgs, (unsigned int)ready, MSG_WAITFORONE, NULL);
+        atomic_fetch_add_explicit(&sh->rx_syscalls, 1, memory_order_relaxed);
+        if (n < 0)
+        {
+            if (errno == EBADF)
+                break; // socket closed on shutdown
+            continue;
+        }
+        atomic_fetch_add_explicit(&sh->rx_datagrams, (uint64_t)n, memory_order_relaxed);
+
+        for (int i = 0; i < n; i++)
+        {
+            client_task_t *task = tasks[i];
+            tasks[i] = NULL;
+            task->addr_len = msgs[i].msg_hdr.msg_namelen;
+            task->msg_len = (ssize_t)msgs[i].msg_len;
+            if ((size_t)task->msg_len > sh->task_buf)
+            {
+                // Oversized: move it into a heap task that holds the whole datagram
+                atomic_fetch_add_explicit(&sh->rx_oversized, 1, memory_order_relaxed);
+                client_task_t *big = alloc_task(sh, (size_t)task->msg_len);
+                if (big)
+                {
+                    big->client_addr = task->client_addr;
+                    big->addr_len = task->addr_len;
+                    big->msg_len = task->msg_len;
+                    memcpy(big->buffer, task->buffer, sh->task_buf);
+                    memcpy(big->buffer + sh->task_buf, iov[i][1].iov_base,
+                           (size_t)task->msg_len - sh->task_buf);
+                }
+                release_task(task);
+                if (!big)
+                    continue;
+                task = big;
+            }
+            dispatch_task(sh, task);
+        }
+    }
+
+    for (size_t i = 0; i < UDP_MAX_BATCH; i++)
+        if (tasks[i])
+            release_task(tasks[i]);
+    free(overflow);
+    return NULL;
+}
+#endif
+
 /* ------------------------
    Main function
    ------------------------ */
 // Initializes database, opens UDP socket, and enters infinite loop
-// spawning threads to handle incoming CoAP datagrams.
+// handing incoming CoAP datagrams to the worker pool.
 int main(int argc, char *argv[])
 {
+    server_config_t cfg;
+    if (parse_args(argc, argv, &cfg) != 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
     // Database setup
     char db_path[512];
     snprintf(db_path, sizeof(db_path), "./coap_data.db");
@@ -669,28 +2281,30 @@ int main(int argc, char *argv[])
     snprintf(db_dir, sizeof(db_dir), ".");
     mkdir(db_dir, 0755);
 
-    if (db_init(db_path) != 0)
+    if (db_init_pool(db_path, &cfg.db) != 0)
     {
         fprintf(stderr, "Error initializing database: %s\n", db_path);
         return EXIT_FAILURE;
     }
+    if (cfg.group_commit > 0 && db_group_commit_start(cfg.group_commit, cfg.group_commit_ms) != 0)
+    {
+        fprintf(stderr, "Error starting group commit writer\n");
+        return EXIT_FAILURE;
+    }
 
     // Port and logging setup
-    int port = DEFAULT_PORT;
+    int port = cfg.port;
     FILE *logf = stdout;
 
-    if (argc >= 2)
-        port = atoi(argv[1]);
-
-    if (argc >= 3)
+    if (cfg.log_path)
     {
-        FILE *f = fopen(argv[2], "a");
+        FILE *f = fopen(cfg.log_path, "a");
         if (f)
         {
             fflush(stdout);
             fflush(stderr);
-            freopen(argv[2], "a", stdout);
-            freopen(argv[2], "a", stderr);
+            freopen(cfg.log_path, "a", stdout);
+            freopen(cfg.log_path, "a", stderr);
             setvbuf(stdout, NULL, _IOLBF, 0); // line buffered
             setvbuf(stderr, NULL, _IOLBF, 0);
             logf = f;
@@ -700,6 +2314,27 @@ int main(int argc, char *argv[])
             perror("fopen log");
         }
     }
+    metrics_set_enabled(cfg.metrics);
+    trace_set_enabled(cfg.trace);
+    atomic_store(&log_level, cfg.log_level);
+    log_sample = (unsigned int)cfg.log_sample;
+    log_binary = cfg.log_binary;
+#if !defined(_WIN32) && !defined(_WIN64)
+    {
+        // sigaction, not signal(): under -std=c11 glibc's signal() resets the handler after one delivery
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = log_level_signal;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGUSR1, &sa, NULL);
+        sigaction(SIGUSR2, &sa, NULL);
+        sa.sa_handler = trace_dump_signal;
+        sigaction(SIGQUIT, &sa, NULL);
+    }
+#endif
+    if (cfg.log_ring > 0 && async_log_start(logf, cfg.log_ring) != 0)
+        fprintf(stderr, "Error starting log writer, logging synchronously\n");
 
     // Networking setup (cross-platform)
 #if defined(_WIN32) || defined(_WIN64)
@@ -709,34 +2344,20 @@ int main(int argc, char *argv[])
         fprintf(stderr, "WSAStartup failed\n");
         return EXIT_FAILURE;
     }
-#endif
 
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int sock = open_udp_socket(port, 0);
     if (sock < 0)
-    {
-        perror("socket");
         return EXIT_FAILURE;
-    }
-
-    struct sockaddr_in addr = {0};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
-
-    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
-    {
-        perror("bind");
-        return EXIT_FAILURE;
-    }
 
     printf("CoAP server listening on %d...\n", port);
 
     // Main loop: receive datagrams, spawn worker threads
     while (1)
     {
-        client_task_t *task = malloc(sizeof(*task));
+        client_task_t *task = malloc(sizeof(*task) + BUF_SIZE);
         if (!task)
             continue;
+        task->slab = NULL;
         task->sock = sock;
         task->addr_len = sizeof(task->client_addr);
         task->msg_len = recvfrom(sock, task->buffer, BUF_SIZE, 0,
@@ -748,34 +2369,185 @@ int main(int argc, char *argv[])
             continue;
         }
 
-#if defined(_WIN32) || defined(_WIN64)
         thread_t tid = CreateThread(NULL, 0, handle_client, task, 0, NULL);
         if (tid == NULL)
         {
-            log_message(logf, "ERROR", "CreateThread failed");
+            log_message(logf, LOG_LEVEL_ERROR, "CreateThread failed");
             free(task);
             continue;
         }
         CloseHandle(tid);
-#else
-        thread_t tid;
-        if (pthread_create(&tid, NULL, handle_client, task) != 0)
-        {
-            log_message(logf, "ERROR", "pthread_create failed");
-            free(task);
-            continue;
-        }
-        pthread_detach(tid);
-#endif
     }
 
-#if defined(_WIN32) || defined(_WIN64)
     closesocket(sock);
     WSACleanup();
 #else
-    close(sock);
+    shard_t *shards = calloc((size_t)cfg.shards, sizeof(shard_t));
+    if (!shards)
+        return EXIT_FAILURE;
+    if (cfg.exchange_lifetime > 0)
+    {
+        static dedup_cache_t cache;
+        if (dedup_init(&cache, cfg.exchange_lifetime) != 0)
+        {
+            fprintf(stderr, "Error initializing dedup cache\n");
+            return EXIT_FAILURE;
+        }
+        dedup_cache = &cache;
+    }
+    if (cfg.block_size > 0)
+    {
+        static block_cache_t blocks;
+        if (block_cache_init(&blocks) != 0)
+        {
+            fprintf(stderr, "Error initializing Block2 snapshot cache\n");
+            return EXIT_FAILURE;
+        }
+        block_szx = coap_block_szx_for((size_t)cfg.block_size);
+        block_cache = &blocks;
+    }
+    separate_responses = cfg.separate;
+    if (cfg.separate || cfg.observe)
+    {
+        static retx_tracker_t tracker;
+        if (retx_init(&tracker) != 0)
+        {
+            fprintf(stderr, "Error starting retransmission thread\n");
+            return EXIT_FAILURE;
+        }
+        retx_tracker = &tracker;
+    }
+    // Server-initiated messages (separate responses, notifications) start at a random Message ID
+    srand((unsigned int)time(NULL) ^ (unsigned int)getpid());
+    atomic_store(&next_mid, (unsigned int)rand());
+    etag_init((uint32_t)rand() ^ (uint32_t)time(NULL));
+    max_age = (uint32_t)cfg.max_age;
+    static latest_cache_t latest;
+    if (latest_cache_init(&latest) != 0)
+    {
+        fprintf(stderr, "Error initializing latest-reading cache\n");
+        return EXIT_FAILURE;
+    }
+    latest_cache = &latest;
+    int warmed = db_get_latest(0, load_latest, NULL);
+    if (warmed < 0)
+    {
+        fprintf(stderr, "Error loading latest readings\n");
+        return EXIT_FAILURE;
+    }
+    latest_cache_set_loader(&latest, db_get_latest);
+    log_message(logf, LOG_LEVEL_INFO, "Latest: %d sensors loaded", warmed);
+    if (cfg.observe)
+    {
+        static observe_registry_t registry;
+        if (observe_init(&registry, send_notification, &next_mid) != 0)
+        {
+            fprintf(stderr, "Error initializing observer registry\n");
+            return EXIT_FAILURE;
+        }
+        registry.retx = retx_tracker;
+        retx_tracker->give_up = expire_observer;
+        retx_tracker->give_up_ctx = &registry;
+        observe_registry = &registry;
+    }
+    udp_tx_set_batch(cfg.batch);
+    udp_tx_set_max_delay((unsigned)cfg.tx_delay_us);
+    udp_tx_set_backend(cfg.io_uring ? UDP_BACKEND_IO_URING : UDP_BACKEND_SOCKETS);
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1)
+        ncpu = 1;
+
+    // One socket, receive thread and worker pool per shard
+    for (int i = 0; i < cfg.shards; i++)
+    {
+        shard_t *sh = &shards[i];
+        sh->index = i;
+        sh->log_file = logf;
+        sh->cpu = (cfg.shards > 1 && cfg.pin) ? (int)(i % ncpu) : -1;
+        sh->batch = cfg.batch;
+        sh->io_uring = cfg.io_uring;
+        sh->uring_depth = cfg.uring_depth;
+        sh->task_buf = cfg.task_buf;
+        sh->sock = open_udp_socket(port, cfg.shards > 1);
+        if (sh->sock < 0)
+            return EXIT_FAILURE;
+        // Enough tasks for a full queue, one per busy worker and one receive batch
+        if (slab_pool_init(&sh->tasks, sizeof(client_task_t) + cfg.task_buf,
+                           cfg.queue_capacity + cfg.workers + UDP_MAX_BATCH) != 0)
+        {
+            fprintf(stderr, "Error allocating task slab\n");
+            return EXIT_FAILURE;
+        }
+        if (worker_pool_init(&sh->pool, cfg.workers, cfg.queue_capacity,
+                             handle_client, udp_tx_flush) != 0)
+        {
+            fprintf(stderr, "Error starting worker pool (%zu workers)\n", cfg.workers);
+            return EXIT_FAILURE;
+        }
+        if (pthread_create(&sh->rx_thread, NULL, receive_loop, sh) != 0)
+        {
+            fprintf(stderr, "Error starting receive thread for shard %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("CoAP server listening on %d (shards=%d workers/shard=%zu queue=%zu batch=%zu backend=%s)...\n",
+           port, cfg.shards, cfg.workers, cfg.queue_capacity, cfg.batch,
+           cfg.io_uring ? "io_uring" : "recvmmsg");
+
+    // Housekeeping loop: periodic stats while the shards do the work
+    time_t last_stats = time(NULL);
+    time_t last_checkpoint = time(NULL);
+    int logged_level = cfg.log_level;
+    while (1)
+    {
+        sleep(1);
+        int level = atomic_load(&log_level);
+        if (level != logged_level)
+        {
+            log_write(logf, LOG_LEVEL_INFO, "Log level now %s", log_level_name(level)); // written at any level
+            logged_level = level;
+        }
+        if (atomic_exchange(&trace_dump_requested, 0))
+            dump_trace(logf, cfg.trace_file);
+        if (cfg.stats_interval > 0 && time(NULL) - last_stats >= cfg.stats_interval)
+        {
+            for (int i = 0; i < cfg.shards; i++)
+                log_pool_stats(logf, &shards[i]);
+            log_tx_stats(logf);
+            log_arena_stats(logf);
+            log_dedup_stats(logf);
+            log_retx_stats(logf);
+            log_block_stats(logf);
+            log_observe_stats(logf);
+            log_latest_stats(logf);
+            log_group_commit_stats(logf);
+            log_async_stats(logf);
+            last_stats = time(NULL);
+        }
+        if (dedup_cache)
+            dedup_sweep(dedup_cache, time(NULL));
+        if (block_cache)
+            block_cache_sweep(block_cache, time(NULL));
+        if (cfg.checkpoint_interval > 0 && time(NULL) - last_checkpoint >= cfg.checkpoint_interval)
+        {
+            if (db_checkpoint() != 0)
+                log_message(logf, LOG_LEVEL_ERROR, "WAL checkpoint failed");
+            last_checkpoint = time(NULL);
+        }
+    }
+
+    for (int i = 0; i < cfg.shards; i++)
+    {
+        close(shards[i].sock);
+        pthread_join(shards[i].rx_thread, NULL);
+        worker_pool_shutdown(&shards[i].pool);
+    }
+    free(shards);
 #endif
 
+    async_log_stop();
     db_close();
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+#include "slab_pool.h"
+
+#include <stdlib.h>
+
+#define SLAB_ALIGN 64 // keep objects on separate cache lines
+
+int slab_pool_init(slab_pool_t *pool, size_t obj_size, size_t count)
+{
+    if (!pool || obj_size == 0 || count == 0)
+        return -1;
+
+    pool->obj_size = (obj_size + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+    pool->count = count;
+    atomic_init(&pool->misses, 0);
+
+    pool->mem = aligned_alloc(SLAB_ALIGN, pool->obj_size * count);
+    if (!pool->mem)
+        return -1;
+    if (mpmc_ring_init(&pool->free_list, count) != 0)
+    {
+        free(pool->mem);
+        pool->mem = NULL;
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++)
+        mpmc_ring_push(&pool->free_list, pool->mem + i * pool->obj_size);
+    return 0;
+}
+
+void slab_pool_destroy(slab_pool_t *pool)
+{
+    if (!pool || !pool->mem)
+        return;
+    mpmc_ring_destroy(&pool->free_list);
+    free(pool->mem);
+    pool->mem = NULL;
+}
+
+void *slab_pool_alloc(slab_pool_t *pool)
+{
+    void *obj = mpmc_ring_pop(&pool->free_list);
+    if (!obj)
+        atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+    return obj;
+}
+
+void slab_pool_free(slab_pool_t *pool, void *obj)
+{
+    // The ring holds at least `count` entries, so giving back an object never fails
+    mpmc_ring_push(&pool->free_list, obj);
+}
+
+void slab_pool_get_stats(slab_pool_t *pool, slab_pool_stats_t *out)
+{
+    size_t free_objs = mpmc_ring_size(&pool->free_list);
+    out->obj_size = pool->obj_size;
+    out->count = pool->count;
+    out->in_use = free_objs < pool->count ? pool->count - free_objs : 0;
+    out->misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+}
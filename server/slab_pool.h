@@ -0,0 +1,49 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "mpmc_ring.h"
+
+/* -------------------------
+   Fixed-size object slab
+   -------------------------
+   One contiguous block of `count` objects of `obj_size` bytes, with the free
+   objects kept on a lock-free MPMC ring. The receive thread takes objects and
+   the workers give them back, so neither side goes through malloc/free on the
+   hot path. When the slab is empty slab_pool_alloc returns NULL and the caller
+   falls back to the heap; those misses are counted.
+*/
+typedef struct
+{
+    uint8_t *mem;
+    size_t obj_size;
+    size_t count;
+    mpmc_ring_t free_list;
+    _Atomic uint64_t misses; // allocations that found the slab empty
+} slab_pool_t;
+
+typedef struct
+{
+    size_t obj_size;
+    size_t count;
+    size_t in_use;
+    uint64_t misses;
+} slab_pool_stats_t;
+
+/* Allocate `count` objects of `obj_size` bytes (rounded up to 64). Returns 0 on success. */
+int slab_pool_init(slab_pool_t *pool, size_t obj_size, size_t count);
+
+void slab_pool_destroy(slab_pool_t *pool);
+
+/* Take a free object, or NULL if the slab is exhausted. */
+void *slab_pool_alloc(slab_pool_t *pool);
+
+/* Return an object obtained from slab_pool_alloc. */
+void slab_pool_free(slab_pool_t *pool, void *obj);
+
+void slab_pool_get_stats(slab_pool_t *pool, slab_pool_stats_t *out);
+
+#endif // SLAB_POOL_H
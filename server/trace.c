@@ -0,0 +1,178 @@
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+    trace_stamps_t st;
+    char uri[TRACE_URI_LEN];
+} trace_entry_t;
+
+// One ring per recording thread. Only the owner writes entries; `head` counts
+// the entries ever written and is published after each one, so a reader can
+// tell which copied entries may have been overwritten meanwhile (seqlock style).
+// The spare slot is the one being written, never one of the newest
+// TRACE_RING_SIZE entries a reader keeps.
+#define TRACE_SLOTS (TRACE_RING_SIZE + 1)
+
+typedef struct trace_thread
+{
+    struct trace_thread *next;
+    int tid;
+    _Atomic uint64_t head;
+    trace_entry_t ring[TRACE_SLOTS];
+} trace_thread_t;
+
+#define TRACE_QUEUE_TID 1000 // queue spans of worker N are drawn on track N + 1000
+
+static _Atomic int enabled = 0;
+static _Atomic int next_tid = 1;
+static _Atomic(trace_thread_t *) threads = NULL; // rings are never freed: threads live as long as the server
+static _Thread_local trace_thread_t *tls_ring = NULL;
+
+static const char *const method_names[] = {"EMPTY", "GET", "POST", "PUT", "DELETE"};
+
+void trace_set_enabled(int on)
+{
+    atomic_store_explicit(&enabled, on != 0, memory_order_relaxed);
+}
+
+int trace_enabled(void)
+{
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+// Calling thread's ring, created and published the first time it traces
+static trace_thread_t *trace_thread(void)
+{
+    if (tls_ring)
+        return tls_ring;
+    trace_thread_t *t = calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+    t->tid = atomic_fetch_add(&next_tid, 1);
+    trace_thread_t *head = atomic_load_explicit(&threads, memory_order_relaxed);
+    do
+        t->next = head;
+    while (!atomic_compare_exchange_weak_explicit(&threads, &head, t, memory_order_release, memory_order_relaxed));
+    tls_ring = t;
+    return t;
+}
+
+int trace_record(const trace_stamps_t *st, const char *uri)
+{
+    if (!trace_enabled())
+        return -1;
+    trace_thread_t *t = trace_thread();
+    if (!t)
+        return -1;
+    uint64_t h = atomic_load_explicit(&t->head, memory_order_relaxed);
+    trace_entry_t *e = &t->ring[h % TRACE_SLOTS];
+    e->st = *st;
+    if (uri)
+        snprintf(e->uri, sizeof(e->uri), "%s", uri);
+    else
+        e->uri[0] = '\0';
+    atomic_store_explicit(&t->head, h + 1, memory_order_release);
+    return 0;
+}
+
+/* -------------------------
+   Chrome trace_event JSON
+   ------------------------- */
+
+static void json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// One complete ("X") event; skipped when a boundary is missing
+static void span(FILE *out, int *first, const char *name, const char *cat, int tid, uint64_t from, uint64_t to)
+{
+    if (!from || to < from)
+        return;
+    fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            *first ? "" : ",", name, cat, (int)getpid(), tid, (double)from / 1000.0, (double)(to - from) / 1000.0);
+    *first = 0;
+}
+
+static void write_entry(FILE *out, int *first, int tid, const trace_entry_t *e)
+{
+    const trace_stamps_t *st = &e->st;
+    const char *cat = st->method < sizeof(method_names) / sizeof(method_names[0]) ? method_names[st->method] : "other";
+
+    // Whole request, with its identity as args; the stages nest inside it
+    fprintf(out,
+            "%s\n{\"name\":\"request\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+            "\"args\":{\"mid\":%u,\"code\":\"%d.%02d\",\"uri\":",
+            *first ? "" : ",", cat, (int)getpid(), tid, (double)st->start_ns / 1000.0,
+            (double)(st->sent_ns - st->start_ns) / 1000.0, (unsigned)st->mid, st->code >> 5, st->code & 0x1F);
+    json_string(out, e->uri);
+    fputs("}}", out);
+    *first = 0;
+
+    span(out, first, "parse", cat, tid, st->start_ns, st->parsed_ns);
+    span(out, first, "dedup", cat, tid, st->parsed_ns, st->dispatch_ns);
+    span(out, first, "db", cat, tid, st->dispatch_ns, st->handled_ns);
+    span(out, first, "send", cat, tid, st->handled_ns, st->sent_ns);
+    // Queue wait overlaps the previous request of this worker: own track
+    span(out, first, "queue", cat, tid + TRACE_QUEUE_TID, st->rx_ns, st->start_ns);
+}
+
+static void thread_names(FILE *out, int *first, int tid)
+{
+    fprintf(out,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}},"
+            "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"worker %d queue\"}}",
+            *first ? "" : ",", (int)getpid(), tid, tid, (int)getpid(), tid + TRACE_QUEUE_TID, tid);
+    *first = 0;
+}
+
+size_t trace_write_json(FILE *out, size_t per_thread)
+{
+    size_t written = 0;
+    int first = 1;
+    trace_entry_t *copy = malloc(sizeof(trace_entry_t) * TRACE_RING_SIZE);
+    if (!copy)
+        return 0;
+    if (per_thread == 0 || per_thread > TRACE_RING_SIZE)
+        per_thread = TRACE_RING_SIZE;
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (trace_thread_t *t = atomic_load_explicit(&threads, memory_order_acquire); t; t = t->next)
+    {
+        uint64_t h1 = atomic_load_explicit(&t->head, memory_order_acquire);
+        uint64_t n = h1 < per_thread ? h1 : per_thread;
+        for (uint64_t i = h1 - n; i < h1; i++)
+            copy[i - (h1 - n)] = t->ring[i % TRACE_SLOTS];
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t h2 = atomic_load_explicit(&t->head, memory_order_relaxed);
+
+        thread_names(out, &first, t->tid);
+        for (uint64_t i = h1 - n; i < h1; i++)
+        {
+            // Entries the owner may have been rewriting while they were copied
+            if (h2 >= TRACE_SLOTS && i <= h2 - TRACE_SLOTS)
+                continue;
+            write_entry(out, &first, t->tid, &copy[i - (h1 - n)]);
+            written++;
+        }
+    }
+    fputs("\n]}\n", out);
+    free(copy);
+    return written;
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* -------------------------
+   Request tracing
+   -------------------------
+   While tracing is on, every request handled by a worker leaves one record
+   with the CLOCK_MONOTONIC time of each stage boundary of handle_client:
+   received (receive thread), dequeued, parsed, dedup check done, method
+   handled (SQLite and JSON building), response serialized and queued for
+   transmit. Records go to a ring owned by the worker thread (the oldest are
+   overwritten), so recording takes no lock. A dump turns the rings into
+   Chrome trace_event JSON, one span per stage, for chrome://tracing or
+   Perfetto. While tracing is off a stage costs one relaxed load.
+*/
+#define TRACE_PATH ".well-known/trace"
+#define TRACE_RING_SIZE 4096      // requests kept per worker thread
+#define TRACE_URI_LEN 24          // Uri-Path kept per request (longer ones are cut)
+#define TRACE_GET_DEFAULT_LIMIT 32 // requests per thread in a GET dump (?limit=N)
+#define TRACE_GET_MAX_LIMIT 256    // larger N is cut to this; full rings are dumped on SIGQUIT
+#define TRACE_DEFAULT_FILE "trace.json"
+
+// Stage boundaries of one request, nanoseconds; rx_ns is 0 when unknown
+typedef struct
+{
+    uint64_t rx_ns;
+    uint64_t start_ns;
+    uint64_t parsed_ns;
+    uint64_t dispatch_ns;
+    uint64_t handled_ns;
+    uint64_t sent_ns;
+    uint16_t mid;
+    uint8_t method;
+    uint8_t code;
+} trace_stamps_t;
+
+/* Turn tracing on or off at runtime (off by default). */
+void trace_set_enabled(int enabled);
+int trace_enabled(void);
+
+/* Monotonic nanoseconds, or 0 while tracing is off. */
+static inline uint64_t trace_now(void)
+{
+    if (!trace_enabled())
+        return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Keep one request in the calling thread's ring (uri may be NULL).
+   Returns 0, or -1 when tracing is off or the ring cannot be allocated. */
+int trace_record(const trace_stamps_t *st, const char *uri);
+
+/* Write the newest `per_thread` requests of every thread (0 = all kept) as
+   Chrome trace_event JSON. Returns the number of requests written. */
+size_t trace_write_json(FILE *out, size_t per_thread);
+
+#endif // TRACE_H
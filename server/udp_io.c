@@ -0,0 +1,221 @@
+#define _GNU_SOURCE // sendmmsg
+#include "udp_io.h"
+#include "uring.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+// Bytes of response data one thread may hold before it must flush
+#define TX_BUF_SIZE (64 * 1024)
+
+typedef struct
+{
+    int sock;                                 // socket of the pending datagrams
+    size_t count;
+    size_t used;                              // bytes used in data
+    uint64_t first_ns;                        // when the oldest pending datagram was queued
+    uint8_t *data;                            // copies of the queued datagrams
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    struct iovec iov[UDP_MAX_BATCH];
+    struct sockaddr_storage addrs[UDP_MAX_BATCH];
+    int ring_state;                           // 0 = not tried, 1 = ready, -1 = unavailable
+    uring_t ring;
+} tx_batch_t;
+
+static size_t tx_batch_size = 1;
+static uint64_t tx_max_delay_ns = UDP_DEFAULT_TX_DELAY_US * 1000ull;
+static udp_backend_t tx_backend = UDP_BACKEND_SOCKETS;
+static _Thread_local tx_batch_t *tls_tx = NULL;
+
+static _Atomic uint64_t tx_datagrams = 0;
+static _Atomic uint64_t tx_syscalls = 0;
+static _Atomic uint64_t tx_timed_flushes = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void udp_tx_set_batch(size_t batch)
+{
+    if (batch < 1)
+        batch = 1;
+    if (batch > UDP_MAX_BATCH)
+        batch = UDP_MAX_BATCH;
+    tx_batch_size = batch;
+}
+
+void udp_tx_set_max_delay(unsigned us)
+{
+    tx_max_delay_ns = (uint64_t)us * 1000ull;
+}
+
+void udp_tx_set_backend(udp_backend_t backend)
+{
+    tx_backend = backend;
+}
+
+#ifdef HAVE_IO_URING
+// Submit the batch as SENDMSG SQEs with a single io_uring_enter() and reap the
+// completions (UDP sends complete inline, so the wait is short and the slot
+// buffers can be reused right away). Returns how many datagrams from the front
+// of the batch the kernel took; the caller sends the rest with sendmmsg. SQEs
+// the kernel did not take are discarded so a later flush never submits them.
+static size_t flush_uring(tx_batch_t *b)
+{
+    if (b->ring_state == 0)
+        b->ring_state = uring_init(&b->ring, UDP_MAX_BATCH) == 0 ? 1 : -1;
+    if (b->ring_state < 0)
+        return 0;
+
+    size_t queued = 0;
+    for (; queued < b->count; queued++)
+    {
+        struct io_uring_sqe *sqe = uring_get_sqe(&b->ring);
+        if (!sqe)
+            break;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = b->sock;
+        sqe->addr = (uint64_t)(uintptr_t)&b->msgs[queued].msg_hdr;
+        sqe->len = 1;
+        sqe->user_data = queued;
+    }
+    atomic_fetch_add_explicit(&tx_syscalls, 1, memory_order_relaxed);
+    int submitted = uring_submit_and_wait(&b->ring, (unsigned)queued);
+    if (submitted < 0)
+    {
+        uring_discard(&b->ring);
+        b->ring_state = -1; // never enter this ring again, fall back to sendmmsg
+        return 0;
+    }
+    if ((size_t)submitted < queued)
+        uring_discard(&b->ring);
+
+    // A short submission returns without waiting: wait here for the rest
+    size_t reaped = 0;
+    while (reaped < (size_t)submitted)
+    {
+        struct io_uring_cqe *cqe = uring_peek_cqe(&b->ring);
+        if (!cqe)
+        {
+            if (uring_submit_and_wait(&b->ring, 1) < 0)
+            {
+                b->ring_state = -1; // completions cannot be reaped any more
+                break;
+            }
+            continue;
+        }
+        if (cqe->res >= 0)
+            atomic_fetch_add_explicit(&tx_datagrams, 1, memory_order_relaxed);
+        uring_cqe_seen(&b->ring);
+        reaped++;
+    }
+    return (size_t)submitted;
+}
+#endif
+
+// Single datagram, no batching
+static int send_now(int sock, const void *buf, size_t len,
+                    const struct sockaddr *addr, socklen_t addr_len)
+{
+    ssize_t n = sendto(sock, buf, len, 0, addr, addr_len);
+    atomic_fetch_add_explicit(&tx_syscalls, 1, memory_order_relaxed);
+    if (n < 0)
+        return -1;
+    atomic_fetch_add_explicit(&tx_datagrams, 1, memory_order_relaxed);
+    return 0;
+}
+
+void udp_tx_flush(void)
+{
+    tx_batch_t *b = tls_tx;
+    if (!b || b->count == 0)
+        return;
+
+    size_t sent = 0;
+#ifdef HAVE_IO_URING
+    if (tx_backend == UDP_BACKEND_IO_URING)
+        sent = flush_uring(b);
+#endif
+    while (sent < b->count)
+    {
+        int n = sendmmsg(b->sock, b->msgs + sent, (unsigned int)(b->count - sent), 0);
+        atomic_fetch_add_explicit(&tx_syscalls, 1, memory_order_relaxed);
+        if (n <= 0)
+        {
+            sent++; // skip the datagram that failed, keep the rest
+            continue;
+        }
+        atomic_fetch_add_explicit(&tx_datagrams, (uint64_t)n, memory_order_relaxed);
+        sent += (size_t)n;
+    }
+    b->count = 0;
+    b->used = 0;
+}
+
+int udp_tx_send(int sock, const void *buf, size_t len,
+                const struct sockaddr *addr, socklen_t addr_len)
+{
+    if ((tx_batch_size <= 1 && tx_backend != UDP_BACKEND_IO_URING) || len > TX_BUF_SIZE || addr_len > sizeof(struct sockaddr_storage))
+        return send_now(sock, buf, len, addr, addr_len);
+
+    tx_batch_t *b = tls_tx;
+    if (!b)
+    {
+        b = calloc(1, sizeof(*b));
+        if (b)
+            b->data = malloc(TX_BUF_SIZE);
+        if (!b || !b->data)
+        {
+            free(b);
+            return send_now(sock, buf, len, addr, addr_len);
+        }
+        tls_tx = b;
+    }
+
+    if (b->count > 0 && (b->sock != sock || b->used + len > TX_BUF_SIZE))
+        udp_tx_flush();
+
+    uint64_t now = now_ns();
+    if (b->count == 0)
+        b->first_ns = now;
+    size_t i = b->count;
+    memcpy(b->data + b->used, buf, len);
+    memcpy(&b->addrs[i], addr, addr_len);
+    b->iov[i].iov_base = b->data + b->used;
+    b->iov[i].iov_len = len;
+    memset(&b->msgs[i], 0, sizeof(b->msgs[i]));
+    b->msgs[i].msg_hdr.msg_name = &b->addrs[i];
+    b->msgs[i].msg_hdr.msg_namelen = addr_len;
+    b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+    b->msgs[i].msg_hdr.msg_iovlen = 1;
+    b->sock = sock;
+    b->used += len;
+    b->count++;
+
+    if (b->count >= tx_batch_size)
+    {
+        udp_tx_flush();
+    }
+    else if (tx_max_delay_ns && now - b->first_ns >= tx_max_delay_ns)
+    {
+        atomic_fetch_add_explicit(&tx_timed_flushes, 1, memory_order_relaxed);
+        udp_tx_flush();
+    }
+    return 0;
+}
+
+void udp_tx_get_counters(udp_io_counters_t *out)
+{
+    if (!out)
+        return;
+    out->datagrams = atomic_load_explicit(&tx_datagrams, memory_order_relaxed);
+    out->syscalls = atomic_load_explicit(&tx_syscalls, memory_order_relaxed);
+    out->timed_flushes = atomic_load_explicit(&tx_timed_flushes, memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+#ifndef UDP_IO_H
+#define UDP_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/* -------------------------
+   Batched UDP transmit
+   -------------------------
+   Responses are queued per thread and flushed with one sendmmsg() call once
+   the batch is full, the thread is about to run its last queued task or runs
+   out of work (worker pool idle hook), or the oldest queued datagram has
+   waited the maximum delay, so a deep queue does not hold responses back.
+   A batch size of 1 sends every datagram immediately, like plain sendto().
+   With the io_uring backend each thread flushes its batch as SENDMSG
+   submissions on its own ring, one io_uring_enter() per batch.
+*/
+
+// Upper bound for --batch (datagrams per recvmmsg/sendmmsg call)
+#define UDP_MAX_BATCH 64
+// Default for udp_tx_set_max_delay: microseconds a queued datagram may wait
+#define UDP_DEFAULT_TX_DELAY_US 200
+
+typedef struct
+{
+    uint64_t datagrams;
+    uint64_t syscalls;
+    uint64_t timed_flushes; // batches sent because the oldest datagram waited too long
+} udp_io_counters_t;
+
+typedef enum
+{
+    UDP_BACKEND_SOCKETS = 0, // sendto / sendmmsg
+    UDP_BACKEND_IO_URING = 1
+} udp_backend_t;
+
+/* Set the transmit batch size (1..UDP_MAX_BATCH). Call before workers start. */
+void udp_tx_set_batch(size_t batch);
+
+/* Longest time a queued datagram waits for its batch to fill, in microseconds
+   (0 = no time bound). Call before workers start. */
+void udp_tx_set_max_delay(unsigned us);
+
+/* Select the transmit backend. Call before workers start. */
+void udp_tx_set_backend(udp_backend_t backend);
+
+/* Queue a datagram for the calling thread's batch (the buffer is copied).
+   Returns 0 on success, -1 if the datagram could not be sent. */
+int udp_tx_send(int sock, const void *buf, size_t len,
+                const struct sockaddr *addr, socklen_t addr_len);
+
+/* Send everything queued by the calling thread. */
+void udp_tx_flush(void);
+
+/* Process-wide transmit counters. */
+void udp_tx_get_counters(udp_io_counters_t *out);
+
+#endif // UDP_IO_H
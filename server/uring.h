@@ -0,0 +1,80 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------
+   Minimal io_uring wrapper
+   -------------------------
+   Just enough of io_uring(7) for the server's UDP backend, talking to the
+   kernel through the raw syscalls so no extra library is needed. Available
+   when the kernel headers provide <linux/io_uring.h>; otherwise uring_init()
+   fails and the server falls back to the recvmmsg/sendmmsg path.
+*/
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+
+typedef struct
+{
+    int fd;
+    // Submission queue
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sq_local_tail;       // SQEs handed out but not yet published
+    struct io_uring_sqe *sqes;
+    // Completion queue
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    // Mappings
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+/* Set up a ring with at least `entries` SQEs. Returns 0 on success, -1 on error (errno set). */
+int uring_init(uring_t *ring, unsigned entries);
+
+void uring_exit(uring_t *ring);
+
+/* Next free SQE (zeroed), or NULL if the submission queue is full. */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+/* Publish prepared SQEs and enter the kernel once, submitting every SQE it has
+   not consumed yet (including ones left by an earlier failed call) and waiting
+   for at least wait_nr completions. Returns the number of SQEs submitted or -1;
+   the kernel does not wait when it submits fewer than it was given. */
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr);
+
+/* Drop every SQE the kernel has not consumed yet, published or not. */
+void uring_discard(uring_t *ring);
+
+/* Oldest unread completion, or NULL if none is ready. */
+struct io_uring_cqe *uring_peek_cqe(uring_t *ring);
+
+/* Mark the completion returned by uring_peek_cqe as consumed. */
+void uring_cqe_seen(uring_t *ring);
+
+#else
+
+typedef struct
+{
+    int fd;
+} uring_t;
+
+#endif // HAVE_IO_URING
+
+#endif // URING_H
@@ -0,0 +1,165 @@
+#include "worker_pool.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Worker loop: sleep on the semaphore, pop one task, run it. The idle hook
+// runs before sleeping and before the last queued task.
+static void *worker_main(void *arg)
+{
+    worker_pool_t *pool = (worker_pool_t *)arg;
+
+    for (;;)
+    {
+        if (sem_trywait(&pool->items) != 0)
+        {
+            if (pool->idle_fn)
+                pool->idle_fn();
+            while (sem_wait(&pool->items) != 0 && errno == EINTR)
+                ;
+        }
+
+        void *task = mpmc_ring_pop(&pool->queue);
+        if (!task)
+        {
+            if (atomic_load_explicit(&pool->stop, memory_order_acquire))
+                break;
+            // A token was posted, so a producer is between claiming its cell
+            // and publishing it. Wait for the publish instead of losing the task.
+            while (!(task = mpmc_ring_pop(&pool->queue)))
+                sched_yield();
+        }
+        // Last queued task: flush now rather than after it runs
+        if (pool->idle_fn && mpmc_ring_size(&pool->queue) == 0)
+            pool->idle_fn();
+
+        atomic_fetch_add_explicit(&pool->busy, 1, memory_order_relaxed);
+        uint64_t t0 = now_ns();
+        pool->fn(task);
+        atomic_fetch_add_explicit(&pool->busy_ns, now_ns() - t0, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&pool->busy, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&pool->completed, 1, memory_order_relaxed);
+    }
+    if (pool->idle_fn)
+        pool->idle_fn();
+    return NULL;
+}
+
+int worker_pool_init(worker_pool_t *pool, size_t workers, size_t queue_capacity,
+                     worker_fn_t fn, worker_idle_fn_t idle_fn)
+{
+    if (!pool || workers == 0 || !fn)
+        return -1;
+
+    if (mpmc_ring_init(&pool->queue, queue_capacity) != 0)
+        return -1;
+    if (sem_init(&pool->items, 0, 0) != 0)
+    {
+        mpmc_ring_destroy(&pool->queue);
+        return -1;
+    }
+
+    pool->fn = fn;
+    pool->idle_fn = idle_fn;
+    pool->nthreads = 0;
+    atomic_init(&pool->stop, 0);
+    atomic_init(&pool->submitted, 0);
+    atomic_init(&pool->completed, 0);
+    atomic_init(&pool->rejected, 0);
+    atomic_init(&pool->busy_ns, 0);
+    atomic_init(&pool->busy, 0);
+    atomic_init(&pool->max_depth, 0);
+    pool->started_ns = now_ns();
+
+    pool->threads = calloc(workers, sizeof(pthread_t));
+    if (!pool->threads)
+    {
+        sem_destroy(&pool->items);
+        mpmc_ring_destroy(&pool->queue);
+        return -1;
+    }
+
+    for (size_t i = 0; i < workers; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0)
+            break;
+        pool->nthreads++;
+    }
+    if (pool->nthreads == 0)
+    {
+        free(pool->threads);
+        sem_destroy(&pool->items);
+        mpmc_ring_destroy(&pool->queue);
+        return -1;
+    }
+    return 0;
+}
+
+int worker_pool_submit(worker_pool_t *pool, void *task)
+{
+    if (mpmc_ring_push(&pool->queue, task) != 0)
+    {
+        atomic_fetch_add_explicit(&pool->rejected, 1, memory_order_relaxed);
+        return -1;
+    }
+    sem_post(&pool->items);
+    atomic_fetch_add_explicit(&pool->submitted, 1, memory_order_relaxed);
+
+    size_t depth = mpmc_ring_size(&pool->queue);
+    size_t max = atomic_load_explicit(&pool->max_depth, memory_order_relaxed);
+    while (depth > max &&
+           !atomic_compare_exchange_weak_explicit(&pool->max_depth, &max, depth,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+    return 0;
+}
+
+int worker_pool_has_room(worker_pool_t *pool)
+{
+    return mpmc_ring_has_room(&pool->queue);
+}
+
+void worker_pool_get_stats(worker_pool_t *pool, worker_pool_stats_t *out)
+{
+    if (!pool || !out)
+        return;
+    out->workers = pool->nthreads;
+    out->capacity = mpmc_ring_capacity(&pool->queue);
+    out->depth = mpmc_ring_size(&pool->queue);
+    out->max_depth = atomic_load_explicit(&pool->max_depth, memory_order_relaxed);
+    out->busy = atomic_load_explicit(&pool->busy, memory_order_relaxed);
+    out->submitted = atomic_load_explicit(&pool->submitted, memory_order_relaxed);
+    out->completed = atomic_load_explicit(&pool->completed, memory_order_relaxed);
+    out->rejected = atomic_load_explicit(&pool->rejected, memory_order_relaxed);
+
+    uint64_t elapsed = now_ns() - pool->started_ns;
+    uint64_t busy_ns = atomic_load_explicit(&pool->busy_ns, memory_order_relaxed);
+    out->utilization = (elapsed && pool->nthreads)
+                           ? (double)busy_ns / ((double)elapsed * (double)pool->nthreads)
+                           : 0.0;
+}
+
+void worker_pool_shutdown(worker_pool_t *pool)
+{
+    if (!pool || !pool->threads)
+        return;
+    atomic_store_explicit(&pool->stop, 1, memory_order_release);
+    for (size_t i = 0; i < pool->nthreads; i++)
+        sem_post(&pool->items);
+    for (size_t i = 0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    free(pool->threads);
+    pool->threads = NULL;
+    sem_destroy(&pool->items);
+    mpmc_ring_destroy(&pool->queue);
+}
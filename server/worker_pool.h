@@ -0,0 +1,76 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "mpmc_ring.h"
+
+/* -------------------------
+   Fixed worker pool
+   -------------------------
+   A startup-sized set of threads that take tasks from a bounded MPMC ring.
+   Producers never block: when the ring is full the task is rejected and
+   the caller decides what to do with it (the server drops the datagram and
+   lets the client retransmit).
+*/
+typedef void *(*worker_fn_t)(void *task);
+typedef void (*worker_idle_fn_t)(void);
+
+typedef struct
+{
+    mpmc_ring_t queue;
+    sem_t items;                 // counts published tasks, workers sleep on it
+    pthread_t *threads;
+    size_t nthreads;
+    worker_fn_t fn;
+    worker_idle_fn_t idle_fn;    // run when the queue drains (e.g. flush batched sends)
+    _Atomic int stop;
+
+    // Counters (relaxed atomics, read by worker_pool_get_stats)
+    _Atomic uint64_t submitted;
+    _Atomic uint64_t completed;
+    _Atomic uint64_t rejected;   // queue full
+    _Atomic uint64_t busy_ns;    // total time spent inside fn
+    _Atomic size_t busy;         // workers currently running a task
+    _Atomic size_t max_depth;    // queue depth high-water mark
+    uint64_t started_ns;
+} worker_pool_t;
+
+typedef struct
+{
+    size_t workers;
+    size_t capacity;
+    size_t depth;
+    size_t max_depth;
+    size_t busy;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;
+    double utilization;          // busy time / (workers * uptime), 0..1
+} worker_pool_stats_t;
+
+/* Start `workers` threads running fn on each task. idle_fn (optional) runs
+   whenever a worker finds the queue empty, before it goes to sleep, and when
+   it takes the last queued task, before running it: with nothing queued
+   behind that task, work batched so far gains nothing by waiting for it.
+   Returns 0 on success. */
+int worker_pool_init(worker_pool_t *pool, size_t workers, size_t queue_capacity,
+                     worker_fn_t fn, worker_idle_fn_t idle_fn);
+
+/* Enqueue a task. Returns 0 on success, -1 if the queue is full. */
+int worker_pool_submit(worker_pool_t *pool, void *task);
+
+/* Nonzero when worker_pool_submit would accept a task now (and will, as long
+   as the caller is the only thread submitting to this pool). */
+int worker_pool_has_room(worker_pool_t *pool);
+
+void worker_pool_get_stats(worker_pool_t *pool, worker_pool_stats_t *out);
+
+/* Stop the workers after the queued tasks are drained and join them. */
+void worker_pool_shutdown(worker_pool_t *pool);
+
+#endif // WORKER_POOL_H
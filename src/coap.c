@@ -27,32 +27,129 @@ void coap_init_message(coap_message_t *msg)
 
     msg->options = NULL;         // No options initially
     msg->options_count = 0;
+    msg->alloc = NULL;           // Options from malloc
+    msg->alloc_ctx = NULL;
 
     msg->payload = NULL;         // No payload initially
     msg->payload_len = 0;
 }
 
 // ==========================
-// Serialization
+// Option delta/length encoding
 // ==========================
-// Convert a CoAP message structure into a byte buffer (wire format)
-int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_len)
+// RFC 7252 section 3.1: values 0..12 fit in the nibble, 13..268 use nibble 13
+// plus one extended byte (value - 13), 269..65804 use nibble 14 plus two
+// extended bytes (value - 269, network order). Nibble 15 is reserved.
+#define COAP_EXT8_BASE 13
+#define COAP_EXT16_BASE 269
+
+static uint8_t ext_nibble(uint32_t v)
 {
-    if (!msg || !out_buf)
-        return COAP_ERR_INVALID;
-    if (msg->tkl > COAP_MAX_TOKEN_LEN)
-        return COAP_ERR_TKL_TOO_LARGE;
+    if (v < COAP_EXT8_BASE)
+        return (uint8_t)v;
+    if (v < COAP_EXT16_BASE)
+        return 13;
+    return 14;
+}
+
+// Number of extended bytes that follow the option header for value v
+static size_t ext_size(uint32_t v)
+{
+    if (v < COAP_EXT8_BASE)
+        return 0;
+    if (v < COAP_EXT16_BASE)
+        return 1;
+    return 2;
+}
+
+static size_t put_ext(uint8_t *out, uint32_t v)
+{
+    if (v < COAP_EXT8_BASE)
+        return 0;
+    if (v < COAP_EXT16_BASE)
+    {
+        out[0] = (uint8_t)(v - COAP_EXT8_BASE);
+        return 1;
+    }
+    uint32_t e = v - COAP_EXT16_BASE;
+    out[0] = (uint8_t)((e >> 8) & 0xFF);
+    out[1] = (uint8_t)(e & 0xFF);
+    return 2;
+}
+
+// Decode an extended delta/length whose nibble is `nibble`.
+// Returns COAP_OK and advances *idx, or an error for reserved/truncated input.
+static int get_ext(const uint8_t *buf, size_t buf_len, size_t *idx, uint8_t nibble, uint32_t *out)
+{
+    size_t i = *idx;
+    if (nibble < 13)
+    {
+        *out = nibble;
+    }
+    else if (nibble == 13)
+    {
+        if (i + 1 > buf_len)
+            return COAP_ERR_TRUNCATED;
+        *out = (uint32_t)buf[i] + COAP_EXT8_BASE;
+        i += 1;
+    }
+    else if (nibble == 14)
+    {
+        if (i + 2 > buf_len)
+            return COAP_ERR_TRUNCATED;
+        *out = (((uint32_t)buf[i] << 8) | buf[i + 1]) + COAP_EXT16_BASE;
+        i += 2;
+    }
+    else
+    {
+        return COAP_ERR_INVALID; // 15 is reserved (payload marker)
+    }
+    *idx = i;
+    return COAP_OK;
+}
+
+// ==========================
+// Serialized size
+// ==========================
+// Exact number of bytes coap_serialize will write, or 0 if msg cannot be encoded
+size_t coap_serialized_size(const coap_message_t *msg)
+{
+    if (!msg || msg->tkl > COAP_MAX_TOKEN_LEN)
+        return 0;
 
-    // Estimate required buffer size
     size_t needed = 4 + msg->tkl;
+    uint16_t running = 0;
     for (size_t i = 0; i < msg->options_count; i++)
     {
-        needed += 1 + msg->options[i].length;  
+        const coap_option_t *opt = &msg->options[i];
+        if (opt->number < running)
+            return 0; // options must be sorted by number
+        uint16_t delta = opt->number - running;
+        running = opt->number;
+        needed += 1 + ext_size(delta) + ext_size(opt->length) + opt->length;
     }
     if (msg->payload_len)
     {
-        needed += 1 + msg->payload_len;  // add marker + payload
+        needed += 1 + msg->payload_len; // add marker + payload
     }
+    return needed;
+}
+
+// ==========================
+// Serialization
+// ==========================
+// Convert a CoAP message structure into a byte buffer (wire format)
+int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_len)
+{
+    if (!msg || !out_buf)
+        return COAP_ERR_INVALID;
+    if (msg->tkl > COAP_MAX_TOKEN_LEN)
+        return COAP_ERR_TKL_TOO_LARGE;
+
+    // Exact required buffer size (also validates option order)
+    size_t needed = coap_serialized_size(msg);
+    if (needed == 0)
+        return COAP_ERR_INVALID;
     if (out_buf_len < needed)
         return COAP_ERR_TRUNCATED;
 
@@ -67,10 +164,9 @@ int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_l
     out_buf[0] = first;
     out_buf[1] = msg->code;
 
-    // third and fourth bytes are message ID
-    uint16_t mid_net = htons(msg->message_id);
-    out_buf[2] = (uint8_t)((mid_net >> 8) & 0xFF);
-    out_buf[3] = (uint8_t)(mid_net & 0xFF);
+    // third and fourth bytes are message ID (network byte order)
+    out_buf[2] = (uint8_t)((msg->message_id >> 8) & 0xFF);
+    out_buf[3] = (uint8_t)(msg->message_id & 0xFF);
 
     size_t idx = 4;
 
@@ -81,7 +177,7 @@ int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_l
         idx += msg->tkl;
     }
 
-    // Serialize options (delta encoding simplified: only small deltas allowed)
+    // Serialize options (delta encoding, RFC 7252 section 3.1)
     uint16_t running_delta = 0;
     for (size_t i = 0; i < msg->options_count; i++)
     {
@@ -89,14 +185,11 @@ int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_l
         uint16_t option_delta = opt->number - running_delta;
         running_delta = opt->number;
 
-        if (opt->length > 15 || option_delta > 15)
-        {
-            return COAP_ERR_OPTIONS_NOT_SUPPORTED;
-        }
-
-        uint8_t header = (uint8_t)((option_delta << 4) | (opt->length & 0x0F));
-        out_buf[idx++] = header;
-        memcpy(out_buf + idx, opt->value, opt->length);
+        out_buf[idx++] = (uint8_t)((ext_nibble(option_delta) << 4) | ext_nibble(opt->length));
+        idx += put_ext(out_buf + idx, option_delta);
+        idx += put_ext(out_buf + idx, opt->length);
+        if (opt->length)
+            memcpy(out_buf + idx, opt->value, opt->length);
         idx += opt->length;
     }
 
@@ -113,6 +206,35 @@ int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_l
 // ==========================
 // Parsing
 // ==========================
+// Decode the option starting at buf[*idx] (which must not be the payload marker).
+// On success advances *idx past the option value, updates the running option
+// number and returns the option number, length and a pointer to its value.
+static int next_option(const uint8_t *buf, size_t buf_len, size_t *idx, uint16_t *running,
+                       uint16_t *number, uint16_t *length, const uint8_t **value)
+{
+    size_t i = *idx;
+    uint8_t byte = buf[i++];
+    uint32_t opt_delta, opt_len;
+
+    int st = get_ext(buf, buf_len, &i, (byte >> 4) & 0x0F, &opt_delta);
+    if (st != COAP_OK)
+        return st;
+    st = get_ext(buf, buf_len, &i, byte & 0x0F, &opt_len);
+    if (st != COAP_OK)
+        return st;
+    if ((uint32_t)*running + opt_delta > 0xFFFF || opt_len > 0xFFFF)
+        return COAP_ERR_INVALID;
+    if (i + opt_len > buf_len)
+        return COAP_ERR_TRUNCATED;
+
+    *running = (uint16_t)(*running + opt_delta);
+    *number = *running;
+    *length = (uint16_t)opt_len;
+    *value = buf + i;
+    *idx = i + opt_len;
+    return COAP_OK;
+}
+
 // Parse a raw byte buffer into a CoAP message structure
 int coap_parse(const uint8_t *buf, size_t buf_len, coap_message_t *msg)
 {
@@ -175,19 +297,11 @@ int coap_parse(const uint8_t *buf, size_t buf_len, coap_message_t *msg)
         }
 
         // Option header
-        uint8_t byte = buf[idx++];
-        uint8_t opt_delta = (byte >> 4) & 0x0F;
-        uint8_t opt_len = (byte & 0x0F);
-
-        if (opt_delta == 15 || opt_len == 15)
-        {
-            return COAP_ERR_OPTIONS_NOT_SUPPORTED;
-        }
-        if (idx + opt_len > buf_len)    
-            return COAP_ERR_TRUNCATED;
-
-        uint16_t opt_num = running_delta + opt_delta;
-        running_delta = opt_num;
+        uint16_t opt_num, opt_len;
+        const uint8_t *opt_val;
+        int st = next_option(buf, buf_len, &idx, &running_delta, &opt_num, &opt_len, &opt_val);
+        if (st != COAP_OK)
+            return st;
 
         // Add new option to the message (expand array)
         coap_option_t *tmp = realloc(msg->options, (msg->options_count + 1) * sizeof(coap_option_t));
@@ -198,11 +312,79 @@ int coap_parse(const uint8_t *buf, size_t buf_len, coap_message_t *msg)
         coap_option_t *opt = &msg->options[msg->options_count++];
         opt->number = opt_num;
         opt->length = opt_len;
-        opt->value = (uint8_t *)malloc(opt_len);
-        if (!opt->value)
-            return COAP_ERR_INVALID;
-        memcpy(opt->value, buf + idx, opt_len);
-        idx += opt_len;
+        opt->value = NULL;
+        if (opt_len > 0) // empty options (e.g. Observe=0) carry no value
+        {
+            opt->value = (uint8_t *)malloc(opt_len);
+            if (!opt->value)
+                return COAP_ERR_INVALID;
+            memcpy(opt->value, opt_val, opt_len);
+        }
+    }
+
+    return COAP_OK;
+}
+
+// ==========================
+// Zero-copy parsing
+// ==========================
+// Parse a raw byte buffer into a view whose options and payload point into buf
+int coap_parse_view(const uint8_t *buf, size_t buf_len, coap_message_view_t *view)
+{
+    if (!buf || !view)
+        return COAP_ERR_INVALID;
+    if (buf_len < 4)
+        return COAP_ERR_TRUNCATED;
+
+    uint8_t first = buf[0];
+    uint8_t version = (first >> 6) & 0x03;
+    uint8_t tkl = first & 0x0F;
+
+    view->version = version;
+    view->type = (coap_type_t)((first >> 4) & 0x03);
+    view->tkl = tkl;
+    view->code = buf[1];
+    view->message_id = ((uint16_t)buf[2] << 8) | (uint16_t)buf[3];
+    memset(view->token, 0, sizeof view->token);
+    view->options_count = 0;
+    view->payload = NULL;
+    view->payload_len = 0;
+
+    if (version != COAP_VERSION)
+        return COAP_ERR_VERSION_MISMATCH;
+
+    // Token
+    size_t idx = 4;
+    if (tkl > COAP_MAX_TOKEN_LEN)
+        return COAP_ERR_TKL_TOO_LARGE;
+    if (idx + tkl > buf_len)
+        return COAP_ERR_TRUNCATED;
+    if (tkl)
+        memcpy(view->token, buf + idx, tkl);
+    idx += tkl;
+
+    // Options and payload reference the input buffer
+    uint16_t running_delta = 0;
+    while (idx < buf_len)
+    {
+        if (buf[idx] == COAP_PAYLOAD_MARKER)
+        {
+            idx++;
+            if (idx >= buf_len)
+                return COAP_ERR_TRUNCATED;
+            view->payload = buf + idx;
+            view->payload_len = buf_len - idx;
+            return COAP_OK;
+        }
+
+        if (view->options_count >= COAP_MAX_VIEW_OPTIONS)
+            return COAP_ERR_TOO_MANY_OPTIONS;
+
+        coap_option_view_t *opt = &view->options[view->options_count];
+        int st = next_option(buf, buf_len, &idx, &running_delta, &opt->number, &opt->length, &opt->value);
+        if (st != COAP_OK)
+            return st;
+        view->options_count++;
     }
 
     return COAP_OK;
@@ -217,8 +399,13 @@ void coap_free_message(coap_message_t *msg)
     if (!msg)
         return;
 
-    // Free options
-    if (msg->options)
+    // Free options (allocator storage belongs to its owner)
+    if (msg->options && msg->alloc)
+    {
+        msg->options = NULL;
+        msg->options_count = 0;
+    }
+    else if (msg->options)
     {
         for (size_t i = 0; i < msg->options_count; i++)
         {
@@ -276,7 +463,7 @@ int coap_add_option(coap_message_t *msg, uint16_t number, const uint8_t *value,
         return COAP_ERR_INVALID;
     if (!value && length > 0)
         return COAP_ERR_INVALID;
-    if (length > 15)  // this implementation supports only small options
+    if (length > 0xFFFF) // option length must fit the extended encoding
         return COAP_ERR_OPTION_OVERSIZE;
 
     // Find insertion point to keep options sorted by number
@@ -287,8 +474,19 @@ int coap_add_option(coap_message_t *msg, uint16_t number, const uint8_t *value,
             break;
     }
 
-    // Reallocate memory for one more option
-    coap_option_t *tmp = (coap_option_t *)realloc(msg->options, (msg->options_count + 1) * sizeof(coap_option_t));
+    // Reallocate memory for one more option; allocator storage cannot be
+    // resized, so the list is copied into a larger one
+    coap_option_t *tmp;
+    if (msg->alloc)
+    {
+        tmp = (coap_option_t *)msg->alloc(msg->alloc_ctx, (msg->options_count + 1) * sizeof(coap_option_t));
+        if (tmp && msg->options_count > 0)
+            memcpy(tmp, msg->options, msg->options_count * sizeof(coap_option_t));
+    }
+    else
+    {
+        tmp = (coap_option_t *)realloc(msg->options, (msg->options_count + 1) * sizeof(coap_option_t));
+    }
     if (!tmp)
         return COAP_ERR_INVALID;
     msg->options = tmp;
@@ -306,13 +504,16 @@ int coap_add_option(coap_message_t *msg, uint16_t number, const uint8_t *value,
 
     if (length > 0)
     {
-        msg->options[idx].value = (uint8_t *)malloc(length);
+        msg->options[idx].value =
+            (uint8_t *)(msg->alloc ? msg->alloc(msg->alloc_ctx, length) : malloc(length));
         if (!msg->options[idx].value)
         {
             // Rollback if malloc fails
             for (size_t j = idx; j < msg->options_count; ++j)
                 msg->options[j] = msg->options[j + 1];
-            // reduce size
+            // reduce size (allocator storage stays until its owner releases it)
+            if (msg->alloc)
+                return COAP_ERR_INVALID;
             if (msg->options_count == 0)
             {
                 free(msg->options);
@@ -330,4 +531,51 @@ int coap_add_option(coap_message_t *msg, uint16_t number, const uint8_t *value,
     }
     msg->options_count++;
     return COAP_OK;
-}
\ No newline at end of file
+}
+
+// Set the allocator for option storage
+void coap_set_allocator(coap_message_t *msg, coap_alloc_fn alloc, void *ctx)
+{
+    if (!msg)
+        return;
+    msg->alloc = alloc;
+    msg->alloc_ctx = ctx;
+}
+
+// ==========================
+// Block option
+// ==========================
+// NUM | M | SZX packed big-endian in 0..3 bytes (RFC 7959 section 2.2)
+int coap_block_encode(const coap_block_t *block, uint8_t out[3])
+{
+    if (!block || block->szx > COAP_BLOCK_MAX_SZX || block->num > COAP_BLOCK_MAX_NUM)
+        return COAP_ERR_INVALID;
+    uint32_t v = (block->num << 4) | (block->more ? 0x08u : 0) | block->szx;
+    int len = v > 0xFFFF ? 3 : v > 0xFF ? 2 : v > 0 ? 1 : 0;
+    for (int i = 0; i < len; i++)
+        out[i] = (uint8_t)(v >> (8 * (len - 1 - i)));
+    return len;
+}
+
+int coap_block_decode(const uint8_t *value, size_t length, coap_block_t *block)
+{
+    if (!block || length > 3 || (length > 0 && !value))
+        return COAP_ERR_INVALID;
+    uint32_t v = 0;
+    for (size_t i = 0; i < length; i++)
+        v = (v << 8) | value[i];
+    if ((v & 0x07) == 7)
+        return COAP_ERR_INVALID;
+    block->num = v >> 4;
+    block->more = (v & 0x08) ? 1 : 0;
+    block->szx = (uint8_t)(v & 0x07);
+    return COAP_OK;
+}
+
+uint8_t coap_block_szx_for(size_t size)
+{
+    uint8_t szx = 0;
+    while (szx < COAP_BLOCK_MAX_SZX && COAP_BLOCK_SIZE(szx + 1) <= size)
+        szx++;
+    return szx;
+}
@@ -10,6 +10,7 @@
 #define COAP_VERSION 1
 #define COAP_MAX_TOKEN_LEN 8
 #define COAP_PAYLOAD_MARKER 0xFF
+#define COAP_MAX_VIEW_OPTIONS 16 // inline option slots in coap_message_view_t
 
 // ==========================
 // Types
@@ -40,7 +41,8 @@ typedef enum
     COAP_ERR_TKL_TOO_LARGE = -3,
     COAP_ERR_OPTIONS_NOT_SUPPORTED = -4,
     COAP_ERR_VERSION_MISMATCH = -5,
-    COAP_ERR_OPTION_OVERSIZE = -6
+    COAP_ERR_OPTION_OVERSIZE = -6,
+    COAP_ERR_TOO_MANY_OPTIONS = -7
 } coap_status_t;
 
 // ==========================
@@ -53,6 +55,9 @@ typedef struct
     uint8_t *value;  // buffer for option value
 } coap_option_t;
 
+// Allocator for option storage; the codec never frees what it returns
+typedef void *(*coap_alloc_fn)(void *ctx, size_t n);
+
 // ==========================
 // CoAP message structure
 // ==========================
@@ -68,10 +73,41 @@ typedef struct
     coap_option_t *options; // dinamic 
     size_t options_count;
 
+    coap_alloc_fn alloc; // option storage, NULL = malloc (coap_set_allocator)
+    void *alloc_ctx;
+
     uint8_t *payload; // dinamic
     size_t payload_len;
 } coap_message_t;
 
+// ==========================
+// Zero-copy message view
+// ==========================
+// Option and payload pointers reference the buffer passed to coap_parse_view,
+// which must outlive the view. Nothing is allocated, nothing needs freeing.
+typedef struct
+{
+    uint16_t number;
+    uint16_t length;
+    const uint8_t *value; // points into the parsed buffer
+} coap_option_view_t;
+
+typedef struct
+{
+    uint8_t version;
+    coap_type_t type;
+    uint8_t tkl;
+    uint8_t code;
+    uint16_t message_id;
+    uint8_t token[COAP_MAX_TOKEN_LEN];
+
+    coap_option_view_t options[COAP_MAX_VIEW_OPTIONS]; // inline, no heap
+    size_t options_count;
+
+    const uint8_t *payload; // points into the parsed buffer (NULL if none)
+    size_t payload_len;
+} coap_message_view_t;
+
 // ==========================
 // Function prototypes
 // ==========================
@@ -82,6 +118,13 @@ typedef struct
  */
 int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_len);
 
+/*
+ * Exact number of bytes coap_serialize() will produce for msg, including
+ * extended option delta/length bytes. Returns 0 if msg cannot be encoded
+ * (token too long or options not sorted by number).
+ */
+size_t coap_serialized_size(const coap_message_t *msg);
+
 /*
  * Parse bytes into coap_message_t.
  * On success returns COAP_OK and fills msg. Caller is responsible for freeing msg->payload if non-NULL.
@@ -89,8 +132,17 @@ int coap_serialize(const coap_message_t *msg, uint8_t *out_buf, size_t out_buf_l
  */
 int coap_parse(const uint8_t *buf, size_t buf_len, coap_message_t *msg);
 
+/*
+ * Parse bytes into a zero-copy view (no heap allocation).
+ * Options and payload reference buf, so buf must stay valid while the view is used.
+ * Returns COAP_OK, the same errors as coap_parse, or COAP_ERR_TOO_MANY_OPTIONS
+ * if the message carries more than COAP_MAX_VIEW_OPTIONS options.
+ */
+int coap_parse_view(const uint8_t *buf, size_t buf_len, coap_message_view_t *view);
+
 /*
  * Free resources inside a parsed message (frees payload if allocated).
+ * Options taken from a message allocator are left to its owner.
  */
 void coap_free_message(coap_message_t *msg);
 
@@ -112,6 +164,53 @@ void coap_init_message(coap_message_t *msg);
  */
 int coap_add_option(coap_message_t *msg, uint16_t number, const uint8_t *value, size_t length);
 
+/*
+ * Take the option list and values of msg from alloc(ctx, n) from now on
+ * (e.g. a request arena) instead of malloc. Call before the first option.
+ */
+void coap_set_allocator(coap_message_t *msg, coap_alloc_fn alloc, void *ctx);
+
+// ==========================
+// Content formats (RFC 7252 12.3)
+// ==========================
+#define COAP_OPTION_CONTENT_FORMAT 12
+#define COAP_OPTION_ACCEPT 17
+#define COAP_FORMAT_TEXT 0  // text/plain; charset=utf-8
+#define COAP_FORMAT_JSON 50 // application/json
+
+// ==========================
+// Block-wise transfer (RFC 7959)
+// ==========================
+#define COAP_OPTION_BLOCK2 23
+#define COAP_OPTION_SIZE2 28
+#define COAP_BLOCK_MAX_SZX 6               // 1024-byte blocks (SZX 7 is reserved)
+#define COAP_BLOCK_SIZE(szx) (16u << (szx)) // block size for a size exponent
+#define COAP_BLOCK_MAX_NUM 0xFFFFF         // block numbers are 20 bits
+
+typedef struct
+{
+    uint32_t num; // block number
+    uint8_t more; // M bit: more blocks follow
+    uint8_t szx;  // size exponent, block size = 16 << szx
+} coap_block_t;
+
+/*
+ * Encode a Block1/Block2 option value into out (up to 3 bytes, minimal length).
+ * Returns the value length (0 for block 0 of 16 bytes without M) or COAP_ERR_INVALID.
+ */
+int coap_block_encode(const coap_block_t *block, uint8_t out[3]);
+
+/*
+ * Decode a Block1/Block2 option value. Returns COAP_OK, or COAP_ERR_INVALID
+ * for a value longer than 3 bytes or the reserved SZX 7.
+ */
+int coap_block_decode(const uint8_t *value, size_t length, coap_block_t *block);
+
+/*
+ * Largest SZX whose block size does not exceed size (size >= 16), capped at COAP_BLOCK_MAX_SZX.
+ */
+uint8_t coap_block_szx_for(size_t size);
+
 // ==========================
 // CoAP Codes
 // ==========================
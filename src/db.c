@@ -1,183 +1,887 @@
 #define _POSIX_C_SOURCE 200809L
 #include "db.h"
+#include "probes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
 #include <strings.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
 
-static sqlite3 *db = NULL; // Global SQLite connection handle
+/* -------------------------
+   Connection pool and statement cache
+   -------------------------
+   One writer connection takes every INSERT/UPDATE/DELETE; N read-only
+   connections serve the SELECTs. With the database in WAL mode readers
+   see the last committed state and never block the writer, so GETs run in
+   parallel with ingest. Each thread sticks to one reader slot (taking any
+   idle reader when its own is busy).
+
+   Every statement is compiled once per connection, on first use, and then
+   reused with sqlite3_reset / sqlite3_clear_bindings. A prepared statement
+   can only be stepped by one thread at a time, so a call holds its
+   connection's lock for the whole bind/step/reset sequence (which also
+   keeps last_insert_rowid and changes() per call).
+*/
+typedef enum
+{
+    STMT_INSERT,
+    STMT_INSERT_WITH_ID,
+    STMT_INSERT_WITH_SENSOR,
+    STMT_GET_ALL,
+    STMT_GET_PAGE,
+    STMT_GET_RAW_BY_ID,
+    STMT_GET_BY_ID,
+    STMT_UPDATE,
+    STMT_UPDATE_TEMP,
+    STMT_UPDATE_HUM,
+    STMT_DELETE,
+    STMT_SENSOR_RANGE_ASC,
+    STMT_SENSOR_RANGE_LATEST,
+    STMT_LATEST_ONE,
+    STMT_LATEST_ALL,
+    STMT_COUNT
+} stmt_id_t;
+
+static const char *const stmt_sql[STMT_COUNT] = {
+    [STMT_INSERT] = "INSERT INTO data (value, temp, hum) VALUES (?, ?, ?);",
+    [STMT_INSERT_WITH_ID] = "INSERT INTO data (id, value, temp, hum) VALUES (?, ?, ?, ?);",
+    // Reports the stored timestamp, which orders the sensor's readings
+    [STMT_INSERT_WITH_SENSOR] = "INSERT INTO data (sensor, value, temp, hum) VALUES (?, ?, ?, ?) RETURNING timestamp;",
+    [STMT_GET_ALL] = "SELECT id,value,timestamp FROM (SELECT id,value,timestamp FROM data ORDER BY id DESC LIMIT 26)"
+                     " ORDER BY id;",
+    [STMT_GET_PAGE] = "SELECT id,value,timestamp FROM data WHERE id>?1 ORDER BY id LIMIT ?2;",
+    [STMT_GET_RAW_BY_ID] = "SELECT value FROM data WHERE id=?;",
+    [STMT_GET_BY_ID] = "SELECT value,timestamp FROM data WHERE id=?;",
+    [STMT_UPDATE] = "UPDATE data SET value=?, temp=?, hum=? WHERE id=?;",
+    // Partial updates: set one column and regenerate the normalized value text
+    // in the same statement (a missing reading becomes 0, as before). The text
+    // comes from reading_json(), not SQLite's printf(), which rounds differently.
+    [STMT_UPDATE_TEMP] = "UPDATE data SET temp=COALESCE(?1,temp,0.0), hum=COALESCE(hum,0.0),"
+                         " value=reading_json(COALESCE(?1,temp,0.0),COALESCE(hum,0.0))"
+                         " WHERE id=?2;",
+    [STMT_UPDATE_HUM] = "UPDATE data SET hum=COALESCE(?1,hum,0.0), temp=COALESCE(temp,0.0),"
+                        " value=reading_json(COALESCE(temp,0.0),COALESCE(?1,hum,0.0))"
+                        " WHERE id=?2;",
+    [STMT_DELETE] = "DELETE FROM data WHERE id=?;",
+    // Per-sensor time ranges, both range scans on idx_data_sensor_ts (sensor, timestamp).
+    // ASC walks forward from the lower bound; LATEST walks back from the upper
+    // bound and the outer query only re-sorts the (at most limit) rows it kept.
+    [STMT_SENSOR_RANGE_ASC] = "SELECT id,value,timestamp FROM data"
+                              " WHERE sensor=?1 AND timestamp>=?2 AND timestamp<=?3"
+                              " ORDER BY timestamp, id LIMIT ?4;",
+    [STMT_SENSOR_RANGE_LATEST] = "SELECT id,value,timestamp FROM ("
+                                 "SELECT id,value,timestamp FROM data"
+                                 " WHERE sensor=?1 AND timestamp>=?2 AND timestamp<=?3"
+                                 " ORDER BY timestamp DESC, id DESC LIMIT ?4)"
+                                 " ORDER BY timestamp, id;",
+    // Newest row of one sensor / of every sensor: one backwards step on
+    // idx_data_sensor_ts per sensor (DISTINCT walks the same index)
+    [STMT_LATEST_ONE] = "SELECT sensor,id,value,timestamp FROM data WHERE sensor=?1"
+                        " ORDER BY timestamp DESC, id DESC LIMIT 1;",
+    [STMT_LATEST_ALL] = "SELECT d.sensor,d.id,d.value,d.timestamp"
+                        " FROM (SELECT DISTINCT sensor FROM data WHERE sensor>0) s"
+                        " JOIN data d ON d.id=(SELECT id FROM data WHERE sensor=s.sensor"
+                        " ORDER BY timestamp DESC, id DESC LIMIT 1);",
+};
+
+typedef struct
+{
+    sqlite3 *handle;
+    sqlite3_stmt *stmts[STMT_COUNT];
+    pthread_mutex_t lock;
+} db_conn_t;
+
+static db_conn_t writer = {NULL, {NULL}, PTHREAD_MUTEX_INITIALIZER};
+static db_conn_t *readers = NULL;
+static int reader_count = 0;
+static _Atomic unsigned int next_reader_slot = 0;
+static _Thread_local int reader_slot = -1;
+
+// Lock the writer connection
+static db_conn_t *db_writer(void)
+{
+    pthread_mutex_lock(&writer.lock);
+    return &writer;
+}
+
+// Lock a reader connection: the thread's own slot if idle, else any idle
+// reader, else wait for the own slot. Without readers, reads use the writer.
+static db_conn_t *db_reader(void)
+{
+    if (reader_count == 0)
+        return db_writer();
+    if (reader_slot < 0 || reader_slot >= reader_count)
+        reader_slot = (int)(atomic_fetch_add_explicit(&next_reader_slot, 1, memory_order_relaxed) % (unsigned int)reader_count);
+    for (int i = 0; i < reader_count; i++)
+    {
+        db_conn_t *c = &readers[(reader_slot + i) % reader_count];
+        if (pthread_mutex_trylock(&c->lock) == 0)
+            return c;
+    }
+    pthread_mutex_lock(&readers[reader_slot].lock);
+    return &readers[reader_slot];
+}
+
+// Return the connection's cached statement (compiled on first use), or NULL
+static sqlite3_stmt *stmt_get(db_conn_t *c, stmt_id_t id)
+{
+    if (!c->stmts[id] &&
+        sqlite3_prepare_v3(c->handle, stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT,
+                           &c->stmts[id], NULL) != SQLITE_OK)
+        c->stmts[id] = NULL;
+    return c->stmts[id];
+}
+
+// stmt_get for a locked connection; on failure the connection is unlocked.
+static sqlite3_stmt *stmt_acquire(db_conn_t *c, stmt_id_t id)
+{
+    sqlite3_stmt *stmt = stmt_get(c, id);
+    if (!stmt)
+        pthread_mutex_unlock(&c->lock);
+    else
+        PROBE2(db_stmt_start, stmt, stmt_sql[id]);
+    return stmt;
+}
+
+// Reset the statement for its next use and unlock the connection
+static void stmt_release(db_conn_t *c, sqlite3_stmt *stmt)
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    pthread_mutex_unlock(&c->lock);
+    PROBE1(db_stmt_end, stmt);
+}
+
+static void conn_close(db_conn_t *c)
+{
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < STMT_COUNT; i++)
+    {
+        sqlite3_finalize(c->stmts[i]);
+        c->stmts[i] = NULL;
+    }
+    if (c->handle)
+    {
+        sqlite3_close(c->handle);
+        c->handle = NULL;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+static int exec_sql(sqlite3 *h, const char *sql, const char *what)
+{
+    char *errmsg = NULL;
+    if (sqlite3_exec(h, sql, 0, 0, &errmsg) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error %s: %s\n", what, errmsg ? errmsg : sqlite3_errmsg(h));
+        sqlite3_free(errmsg);
+        return -1;
+    }
+    return 0;
+}
 
 /* -------------------------
    Database initialization
    ------------------------- */
-// Opens (or creates) the SQLite database file.
-// Also creates a table `data` if it does not exist yet.
-// Columns: id (autoincrement), sensor id, value text, timestamp (default = current localtime).
+void db_default_config(db_config_t *cfg)
+{
+    cfg->readers = DB_DEFAULT_READERS;
+    cfg->busy_timeout_ms = DB_DEFAULT_BUSY_TIMEOUT_MS;
+    cfg->wal_autocheckpoint = DB_DEFAULT_WAL_AUTOCHECKPOINT;
+}
+
+// Opens (or creates) the SQLite database file with the default pool settings.
 int db_init(const char *filename)
 {
-    if (sqlite3_open(filename, &db) != SQLITE_OK)
+    db_config_t cfg;
+    db_default_config(&cfg);
+    return db_init_pool(filename, &cfg);
+}
+
+/* Helper: parse numeric temp/hum values from a stored string.
+   It looks for "temp":<number> and "hum":<number> anywhere in text.
+   If not found sets out_temp/out_hum to HUGE_VAL (NaN-like sentinel).
+*/
+static void parse_temp_hum(const char *s, double *out_temp, double *out_hum)
+{
+    const char *p;
+    char *end;
+    *out_temp = HUGE_VAL;
+    *out_hum = HUGE_VAL;
+
+    if (!s)
+        return;
+    // Look for "temp":<number>
+    p = strstr(s, "temp");
+    if (p)
     {
-        fprintf(stderr, "Error opening DB: %s\n", sqlite3_errmsg(db));
+        /* find ':' after temp */
+        p = strchr(p, ':');
+        if (p)
+        {
+            p++;
+            while (*p && isspace((unsigned char)*p))
+                p++;
+            double v = strtod(p, &end);
+            if (end != p)
+                *out_temp = v;
+        }
+    }
+    p = strstr(s, "hum");
+    if (p)
+    {
+        p = strchr(p, ':');
+        if (p)
+        {
+            p++;
+            while (*p && isspace((unsigned char)*p))
+                p++;
+            double v = strtod(p, &end);
+            if (end != p)
+                *out_hum = v;
+        }
+    }
+}
+
+// Bind a parsed reading, NULL when the value had none
+static void bind_reading(sqlite3_stmt *stmt, int col, double v)
+{
+    if (isfinite(v))
+        sqlite3_bind_double(stmt, col, v);
+    else
+        sqlite3_bind_null(stmt, col);
+}
+
+// SQL function reading_json(temp, hum): the normalized value text
+// {"temp":<x.xx>,"hum":<y.yy>}, formatted by the C library like every other
+// reading the server writes
+static void reading_json_fn(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    char out[96];
+    int n = snprintf(out, sizeof(out), "{\"temp\":%.2f,\"hum\":%.2f}", sqlite3_value_double(argv[0]),
+                     sqlite3_value_double(argv[1]));
+    if (n < 0 || (size_t)n >= sizeof(out))
+    {
+        sqlite3_result_error(ctx, "reading_json: value too long", -1);
+        return;
+    }
+    sqlite3_result_text(ctx, out, n, SQLITE_TRANSIENT);
+}
+
+// Single integer result of a query (or -1)
+static int query_int(sqlite3 *h, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    int v = -1;
+    if (sqlite3_prepare_v2(h, sql, -1, &stmt, NULL) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        v = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+// Add REAL column `name` to data unless it is already there (0 on success)
+static int add_reading_column(sqlite3 *h, const char *name)
+{
+    char sql[96];
+    snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM pragma_table_info('data') WHERE name='%s';", name);
+    int present = query_int(h, sql);
+    if (present != 0)
+        return present > 0 ? 0 : -1;
+    snprintf(sql, sizeof(sql), "ALTER TABLE data ADD COLUMN %s REAL;", name);
+    return exec_sql(h, sql, "adding reading column");
+}
+
+// Schema version 1: readings live in REAL columns temp/hum next to the value
+// text. Databases created before that get the columns added and filled from
+// their stored values, once (tracked in PRAGMA user_version). The columns are
+// added inside the migration transaction, so a failed run leaves neither.
+static int migrate_typed_readings(sqlite3 *h)
+{
+    if (query_int(h, "PRAGMA user_version;") >= 1)
+        return 0;
+
+    sqlite3_stmt *sel, *upd;
+    if (exec_sql(h, "BEGIN IMMEDIATE;", "starting migration") != 0)
+        return -1;
+    if (add_reading_column(h, "temp") != 0 || add_reading_column(h, "hum") != 0)
+    {
+        exec_sql(h, "ROLLBACK;", "rolling back migration");
+        return -1;
+    }
+    if (sqlite3_prepare_v2(h, "SELECT id,value FROM data;", -1, &sel, NULL) != SQLITE_OK)
+    {
+        exec_sql(h, "ROLLBACK;", "rolling back migration");
         return -1;
     }
+    if (sqlite3_prepare_v2(h, "UPDATE data SET temp=?, hum=? WHERE id=?;", -1, &upd, NULL) != SQLITE_OK)
+    {
+        sqlite3_finalize(sel);
+        exec_sql(h, "ROLLBACK;", "rolling back migration");
+        return -1;
+    }
+    int rows = 0, rc;
+    while ((rc = sqlite3_step(sel)) == SQLITE_ROW)
+    {
+        double temp, hum;
+        parse_temp_hum((const char *)sqlite3_column_text(sel, 1), &temp, &hum);
+        bind_reading(upd, 1, temp);
+        bind_reading(upd, 2, hum);
+        sqlite3_bind_int(upd, 3, sqlite3_column_int(sel, 0));
+        rc = sqlite3_step(upd);
+        sqlite3_reset(upd);
+        if (rc != SQLITE_DONE)
+            break;
+        rows++;
+    }
+    if (rc != SQLITE_DONE)
+        fprintf(stderr, "Error migrating readings: %s\n", sqlite3_errmsg(h));
+    sqlite3_finalize(sel);
+    sqlite3_finalize(upd);
+    if (rc != SQLITE_DONE)
+    {
+        // user_version stays 0, so the next open retries the migration
+        exec_sql(h, "ROLLBACK;", "rolling back migration");
+        return -1;
+    }
+    if (exec_sql(h, "PRAGMA user_version=1;", "setting schema version") != 0 ||
+        exec_sql(h, "COMMIT;", "committing migration") != 0)
+    {
+        exec_sql(h, "ROLLBACK;", "rolling back migration");
+        return -1;
+    }
+    if (rows > 0)
+        fprintf(stderr, "Migrated %d rows to typed temp/hum columns\n", rows);
+    return 0;
+}
+
+// Opens the writer connection, switches the file to WAL and creates the
+// table `data` if it does not exist yet, then opens the read-only connections.
+// Columns: id (autoincrement), sensor id, value text, timestamp (default = current localtime),
+// temp/hum readings parsed from the value (NULL when absent).
+int db_init_pool(const char *filename, const db_config_t *cfg)
+{
+    const int flags = SQLITE_OPEN_NOMUTEX; // every connection is guarded by its own lock
+    if (sqlite3_open_v2(filename, &writer.handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | flags,
+                        NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error opening DB: %s\n", sqlite3_errmsg(writer.handle));
+        goto fail;
+    }
+    sqlite3_busy_timeout(writer.handle, cfg->busy_timeout_ms);
+    if (sqlite3_create_function_v2(writer.handle, "reading_json", 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                                   reading_json_fn, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Error registering reading_json: %s\n", sqlite3_errmsg(writer.handle));
+        goto fail;
+    }
+
+    // In-memory databases are private to their connection: no WAL, no readers
+    int in_memory = strcmp(filename, ":memory:") == 0 || filename[0] == '\0';
+    if (!in_memory)
+    {
+        char pragma[64];
+        snprintf(pragma, sizeof(pragma), "PRAGMA wal_autocheckpoint=%d;", cfg->wal_autocheckpoint);
+        if (exec_sql(writer.handle, "PRAGMA journal_mode=WAL;", "enabling WAL") != 0 ||
+            exec_sql(writer.handle, pragma, "setting wal_autocheckpoint") != 0)
+            goto fail;
+    }
+
     const char *sql =
         "CREATE TABLE IF NOT EXISTS data ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "sensor INTEGER DEFAULT 0,"
         "value TEXT NOT NULL,"
-        "timestamp DATETIME DEFAULT (strftime('%Y-%m-%d %H:%M:%S','now','localtime'))"
+        "timestamp DATETIME DEFAULT (strftime('%Y-%m-%d %H:%M:%S','now','localtime')),"
+        "temp REAL,"
+        "hum REAL"
         ");";
-    char *errmsg = NULL;
-    if (sqlite3_exec(db, sql, 0, 0, &errmsg) != SQLITE_OK)
+    if (exec_sql(writer.handle, sql, "creating table") != 0 || migrate_typed_readings(writer.handle) != 0 ||
+        exec_sql(writer.handle, "CREATE INDEX IF NOT EXISTS idx_data_sensor_ts ON data (sensor, timestamp);",
+                 "creating sensor/timestamp index") != 0)
+        goto fail;
+
+    int n = in_memory ? 0 : cfg->readers;
+    if (n > 0 && !(readers = calloc((size_t)n, sizeof(*readers))))
+        goto fail;
+    for (int i = 0; i < n; i++)
     {
-        fprintf(stderr, "Error creating table: %s\n", errmsg);
-        sqlite3_free(errmsg);
-        return -1;
+        db_conn_t *c = &readers[i];
+        pthread_mutex_init(&c->lock, NULL);
+        reader_count++;
+        if (sqlite3_open_v2(filename, &c->handle, SQLITE_OPEN_READONLY | flags, NULL) != SQLITE_OK)
+        {
+            fprintf(stderr, "Error opening read connection: %s\n", sqlite3_errmsg(c->handle));
+            goto fail;
+        }
+        sqlite3_busy_timeout(c->handle, cfg->busy_timeout_ms);
     }
     return 0;
+
+fail:
+    db_close(); // the writer and every reader opened so far (reader_count counts the failed one too)
+    return -1;
+}
+
+// Passive checkpoint: copy WAL frames back into the database without
+// waiting for readers. Used when automatic checkpoints are disabled.
+int db_checkpoint(void)
+{
+    db_conn_t *c = db_writer();
+    int rc = sqlite3_wal_checkpoint_v2(c->handle, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    pthread_mutex_unlock(&c->lock);
+    return rc == SQLITE_OK ? 0 : -1;
+}
+
+// Run one INSERT (STMT_INSERT or STMT_INSERT_WITH_SENSOR) on the locked
+// writer connection. Returns the new id or -1; ts (may be NULL) gets the
+// stored timestamp of a sensor row.
+static int insert_row(db_conn_t *c, stmt_id_t id, int sensor, const char *value, char *ts)
+{
+    sqlite3_stmt *stmt = stmt_get(c, id);
+    if (!stmt)
+        return -1;
+    PROBE2(db_stmt_start, stmt, stmt_sql[id]);
+    double temp, hum;
+    parse_temp_hum(value, &temp, &hum);
+    int col = 1;
+    if (id == STMT_INSERT_WITH_SENSOR)
+        sqlite3_bind_int(stmt, col++, sensor);
+    sqlite3_bind_text(stmt, col++, value, -1, SQLITE_STATIC);
+    bind_reading(stmt, col++, temp);
+    bind_reading(stmt, col, hum);
+
+    int rowid = -1;
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) // RETURNING row, the insert is done once it is read
+    {
+        const unsigned char *stored = sqlite3_column_text(stmt, 0);
+        if (ts)
+            snprintf(ts, DB_TS_SIZE, "%s", stored ? (const char *)stored : "");
+        rc = sqlite3_step(stmt);
+    }
+    if (rc == SQLITE_DONE)
+        rowid = (int)sqlite3_last_insert_rowid(c->handle); // autoincrement
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    PROBE1(db_stmt_end, stmt);
+    return rowid;
 }
 
 /* -------------------------
-   Insert functions
-   ------------------------- */
+   Group commit
+   -------------------------
+   With the ingest writer running, db_insert / db_insert_with_sensor queue
+   the row and sleep. The writer thread waits until max_rows rows are queued
+   or max_delay_ms passed since the first one, inserts them all inside one
+   transaction (one fsync instead of one per row), stores each row id in its
+   request and wakes the callers. The value strings stay owned by the
+   blocked callers, so nothing is copied.
+*/
+typedef struct pending_insert
+{
+    struct pending_insert *next;
+    stmt_id_t stmt;
+    int sensor;
+    const char *value;
+    char *ts; // stored timestamp of a sensor row (NULL = not wanted)
+    int id;   // assigned row id, -1 on failure
+    int done;
+} pending_insert_t;
+
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work; // signalled when a row is queued or on stop
+    pthread_cond_t done; // broadcast after every commit
+    pending_insert_t *head;
+    pending_insert_t **tail;
+    int count;
+    int max_rows;
+    int max_delay_ms;
+    int running;
+    pthread_t thread;
+    uint64_t batches;
+    uint64_t rows;
+} ingest = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+            NULL, NULL, 0, 0, 0, 0, 0, 0, 0};
+
+// Insert a batch in one transaction. If COMMIT fails every row reports -1.
+static void commit_batch(pending_insert_t *batch)
+{
+    db_conn_t *c = db_writer();
+    int in_txn = exec_sql(c->handle, "BEGIN IMMEDIATE;", "starting batch") == 0;
+    for (pending_insert_t *p = batch; p; p = p->next)
+        p->id = insert_row(c, p->stmt, p->sensor, p->value, p->ts);
+    if (in_txn && exec_sql(c->handle, "COMMIT;", "committing batch") != 0)
+    {
+        exec_sql(c->handle, "ROLLBACK;", "rolling back batch");
+        for (pending_insert_t *p = batch; p; p = p->next)
+            p->id = -1;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
 
-// Insert a record with only `value`. ID is auto-assigned.
-int db_insert(const char *value)
+static void *ingest_main(void *arg)
 {
-    const char *sql = "INSERT INTO data (value) VALUES (?);";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    (void)arg;
+    pthread_mutex_lock(&ingest.lock);
+    while (1)
+    {
+        while (ingest.running && ingest.count == 0)
+            pthread_cond_wait(&ingest.work, &ingest.lock);
+        if (ingest.count == 0)
+            break; // stopped and drained
+
+        // Give the batch up to max_delay_ms to fill
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)ingest.max_delay_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        while (ingest.running && ingest.count < ingest.max_rows)
+        {
+            if (pthread_cond_timedwait(&ingest.work, &ingest.lock, &deadline) == ETIMEDOUT)
+                break;
+        }
+
+        pending_insert_t *batch = ingest.head;
+        int n = ingest.count;
+        ingest.head = NULL;
+        ingest.tail = &ingest.head;
+        ingest.count = 0;
+        pthread_mutex_unlock(&ingest.lock);
+
+        commit_batch(batch);
+
+        pthread_mutex_lock(&ingest.lock);
+        for (pending_insert_t *p = batch; p; p = p->next)
+            p->done = 1;
+        ingest.batches++;
+        ingest.rows += (uint64_t)n;
+        pthread_cond_broadcast(&ingest.done);
+    }
+    pthread_mutex_unlock(&ingest.lock);
+    return NULL;
+}
+
+// Queue a row for the writer thread and wait for its id.
+// Returns 0 if the row went through the queue, -1 if group commit is off.
+static int ingest_submit(stmt_id_t stmt, int sensor, const char *value, char *ts, int *id)
+{
+    pending_insert_t p = {NULL, stmt, sensor, value, ts, -1, 0};
+    pthread_mutex_lock(&ingest.lock);
+    if (!ingest.running)
+    {
+        pthread_mutex_unlock(&ingest.lock);
         return -1;
-    sqlite3_bind_text(stmt, 1, value, -1, SQLITE_STATIC);
+    }
+    *ingest.tail = &p;
+    ingest.tail = &p.next;
+    if (++ingest.count == 1 || ingest.count >= ingest.max_rows)
+        pthread_cond_signal(&ingest.work);
+    while (!p.done)
+        pthread_cond_wait(&ingest.done, &ingest.lock);
+    pthread_mutex_unlock(&ingest.lock);
+    *id = p.id;
+    return 0;
+}
 
-    if (sqlite3_step(stmt) != SQLITE_DONE)
+int db_group_commit_start(int max_rows, int max_delay_ms)
+{
+    if (max_rows < 1 || max_delay_ms < 0)
+        return -1;
+    pthread_mutex_lock(&ingest.lock);
+    if (ingest.running)
+    {
+        pthread_mutex_unlock(&ingest.lock);
+        return -1;
+    }
+    ingest.head = NULL;
+    ingest.tail = &ingest.head;
+    ingest.count = 0;
+    ingest.max_rows = max_rows;
+    ingest.max_delay_ms = max_delay_ms;
+    ingest.running = 1;
+    if (pthread_create(&ingest.thread, NULL, ingest_main, NULL) != 0)
     {
-        sqlite3_finalize(stmt);
+        ingest.running = 0;
+        pthread_mutex_unlock(&ingest.lock);
         return -1;
     }
+    pthread_mutex_unlock(&ingest.lock);
+    return 0;
+}
 
-    sqlite3_finalize(stmt);
-    return (int)sqlite3_last_insert_rowid(db); // autoincrement
+void db_group_commit_stop(void)
+{
+    pthread_mutex_lock(&ingest.lock);
+    if (!ingest.running)
+    {
+        pthread_mutex_unlock(&ingest.lock);
+        return;
+    }
+    ingest.running = 0;
+    pthread_cond_signal(&ingest.work);
+    pthread_mutex_unlock(&ingest.lock);
+    pthread_join(ingest.thread, NULL); // commits whatever is still queued
+}
+
+void db_group_commit_stats(uint64_t *batches, uint64_t *rows)
+{
+    pthread_mutex_lock(&ingest.lock);
+    *batches = ingest.batches;
+    *rows = ingest.rows;
+    pthread_mutex_unlock(&ingest.lock);
+}
+
+/* -------------------------
+   Insert functions
+   ------------------------- */
+
+// Insert a record with only `value`. ID is auto-assigned.
+int db_insert(const char *value)
+{
+    int id;
+    if (ingest_submit(STMT_INSERT, 0, value, NULL, &id) == 0)
+        return id;
+    db_conn_t *c = db_writer();
+    id = insert_row(c, STMT_INSERT, 0, value, NULL);
+    pthread_mutex_unlock(&c->lock);
+    return id;
 }
 
 // Insert with explicit ID (useful for PUT/POST with client-specified id)
 int db_insert_with_id(int id, const char *value)
 {
-    const char *sql = "INSERT INTO data (id, value) VALUES (?, ?);";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    db_conn_t *c = db_writer();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_INSERT_WITH_ID);
+    if (!stmt)
         return -1;
+    double temp, hum;
+    parse_temp_hum(value, &temp, &hum);
     sqlite3_bind_int(stmt, 1, id);
     sqlite3_bind_text(stmt, 2, value, -1, SQLITE_STATIC);
+    bind_reading(stmt, 3, temp);
+    bind_reading(stmt, 4, hum);
 
-    if (sqlite3_step(stmt) != SQLITE_DONE)
-    {
-        sqlite3_finalize(stmt);
-        return -1;
-    }
-
-    sqlite3_finalize(stmt);
-    return id;
+    int rc = sqlite3_step(stmt);
+    stmt_release(c, stmt);
+    return rc == SQLITE_DONE ? id : -1;
 }
 
 /* Insert including sensor id */
 // Insert with a specific sensor id (maps one record to a sensor)
 int db_insert_with_sensor(int sensor, const char *value)
 {
-    const char *sql = "INSERT INTO data (sensor, value) VALUES (?, ?);";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
-        return -1;
-    sqlite3_bind_int(stmt, 1, sensor);
-    sqlite3_bind_text(stmt, 2, value, -1, SQLITE_STATIC);
-
-    if (sqlite3_step(stmt) != SQLITE_DONE)
-    {
-        sqlite3_finalize(stmt);
-        return -1;
-    }
+    return db_insert_with_sensor_ts(sensor, value, NULL);
+}
 
-    sqlite3_finalize(stmt);
-    return (int)sqlite3_last_insert_rowid(db);
+// Same, also reporting the timestamp the row was stored with
+int db_insert_with_sensor_ts(int sensor, const char *value, char *ts)
+{
+    int id;
+    if (ts)
+        ts[0] = '\0';
+    if (ingest_submit(STMT_INSERT_WITH_SENSOR, sensor, value, ts, &id) == 0)
+        return id;
+    db_conn_t *c = db_writer();
+    id = insert_row(c, STMT_INSERT_WITH_SENSOR, sensor, value, ts);
+    pthread_mutex_unlock(&c->lock);
+    return id;
 }
 
 /* -------------------------
    Read functions
    ------------------------- */
 
-// Return last 26 rows as a JSON array string.
-// Rows are reversed to show oldest first.
-char *db_get_all(void)
+// Format the current (id, value, timestamp) row as one array element (snprintf semantics)
+static int row_json(sqlite3_stmt *stmt, int first, char *out, size_t room)
 {
-    // Get last 26 entries ordered by id desc (newest first)
-    const char *sql =
-        "SELECT id,value,timestamp FROM data "
-        "ORDER BY id DESC LIMIT 26;";
+    const unsigned char *val = sqlite3_column_text(stmt, 1);
+    const unsigned char *ts = sqlite3_column_text(stmt, 2);
+    return snprintf(out, room, "%s  {\"id\":%d, \"value\":\"%s\", \"ts\":\"%s\"}", first ? "" : ",\n",
+                    sqlite3_column_int(stmt, 0), val ? (const char *)val : "", ts ? (const char *)ts : "");
+}
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
-        return NULL;
+// Write the (id, value, timestamp) rows of an executed SELECT as a JSON array
+// into out (NUL-terminated). At most max_rows rows are written and a row that
+// would not fit in cap stops the page; *more is set when a row was left unwritten.
+// Returns the length written, or -1 on a database error or when cap cannot
+// even hold the empty array.
+static int write_rows_json(sqlite3_stmt *stmt, int max_rows, char *out, size_t cap, int *last_id, int *more)
+{
+    static const char tail[] = "\n]";
+    size_t len = 0;
+    int rows = 0, rc;
+    *more = 0;
+    if (cap < sizeof("[\n") - 1 + sizeof(tail))
+        return -1;
+    len += (size_t)snprintf(out, cap, "[\n");
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (rows == max_rows)
+        {
+            *more = 1;
+            break;
+        }
+        size_t room = cap - len - (sizeof(tail) - 1);
+        int n = row_json(stmt, rows == 0, out + len, room);
+        if (n < 0 || (size_t)n >= room)
+        {
+            *more = 1;
+            break;
+        }
+        len += (size_t)n;
+        *last_id = sqlite3_column_int(stmt, 0);
+        rows++;
+    }
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+        return -1;
+    memcpy(out + len, tail, sizeof(tail));
+    return (int)(len + sizeof(tail) - 1);
+}
 
-    // Prepare buffer
+// Run a bound SELECT into a malloc'd JSON array holding every row it returns.
+// The statement is stepped once; the buffer grows when a row does not fit.
+static char *rows_to_json(sqlite3_stmt *stmt)
+{
+    static const char tail[] = "\n]";
     size_t cap = 2048, len = 0;
     char *out = malloc(cap);
+    int rows = 0, rc;
     if (!out)
         return NULL;
-
-    len += snprintf(out + len, cap - len, "[\n");
-
-    int first = 1;
-    // save on a buffer first, then reverse order
-    typedef struct
+    len += (size_t)snprintf(out, cap, "[\n");
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        int id;
-        char val[256];
-        char ts[64];
-    } row_t;
-    row_t rows[26];
-    int count = 0;
-
-    // Read results (newest first)
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < 26)
+        size_t room = cap - len - (sizeof(tail) - 1);
+        int n = row_json(stmt, rows == 0, out + len, room);
+        if (n < 0)
+            break;
+        if ((size_t)n >= room)
+        {
+            // Column pointers stay valid until the next step: format the row again
+            size_t need = len + (size_t)n + sizeof(tail);
+            while (cap < need)
+                cap *= 2;
+            char *grown = realloc(out, cap);
+            if (!grown)
+                break;
+            out = grown;
+            n = row_json(stmt, rows == 0, out + len, cap - len - (sizeof(tail) - 1));
+        }
+        len += (size_t)n;
+        rows++;
+    }
+    if (rc != SQLITE_DONE)
     {
-        rows[count].id = sqlite3_column_int(stmt, 0);
-        snprintf(rows[count].val, sizeof(rows[count].val), "%s",
-                 sqlite3_column_text(stmt, 1));
-        snprintf(rows[count].ts, sizeof(rows[count].ts), "%s",
-                 sqlite3_column_text(stmt, 2));
-        count++;
+        free(out);
+        return NULL;
     }
-    sqlite3_finalize(stmt);
+    memcpy(out + len, tail, sizeof(tail));
+    return out;
+}
+
+// Return last 26 rows as a JSON array string, oldest first.
+char *db_get_all(void)
+{
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_GET_ALL);
+    if (!stmt)
+        return NULL;
+    char *out = rows_to_json(stmt);
+    stmt_release(c, stmt);
+    return out;
+}
 
-    // reverse order to have oldest first
-    for (int i = count - 1; i >= 0; i--)
+// One page of rows with id > after_id, in id order, written into out.
+// *next_after is the cursor for the following page (0 when this was the last).
+int db_get_page(int after_id, int limit, char *out, size_t cap, int *next_after)
+{
+    if (limit <= 0 || limit > DB_RANGE_MAX_LIMIT)
+        limit = DB_RANGE_MAX_LIMIT; // also keeps limit + 1 below from overflowing
+    *next_after = 0;
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_GET_PAGE);
+    if (!stmt)
+        return -1;
+    sqlite3_bind_int(stmt, 1, after_id);
+    sqlite3_bind_int(stmt, 2, limit + 1); // one extra row tells whether another page follows
+    int last_id = after_id, more;
+    int len = write_rows_json(stmt, limit, out, cap, &last_id, &more);
+    stmt_release(c, stmt);
+    if (len < 0)
+        return -1;
+    if (more)
     {
-        char item[512];
-        int n = snprintf(item, sizeof(item),
-                         "  %s{\"id\":%d, \"value\":\"%s\", \"ts\":\"%s\"}",
-                         first ? "" : ",\n", rows[i].id, rows[i].val, rows[i].ts);
-        if (len + n + 2 > cap)
-        {
-            cap = (cap + n) * 2;
-            out = realloc(out, cap);
-        }
-        memcpy(out + len, item, n);
-        len += n;
-        first = 0;
+        // A single row larger than the whole buffer would stall the cursor
+        if (last_id == after_id)
+            return -1;
+        *next_after = last_id;
     }
+    return len;
+}
 
-    len += snprintf(out + len, cap - len, "\n]");
+// Rows of one sensor inside [from, to], oldest first, in the db_get_all format.
+// With a lower bound the first `limit` rows from there are returned, otherwise
+// the latest `limit` rows up to `to`.
+char *db_get_sensor_range(const db_range_t *q)
+{
+    int limit = q->limit > 0 ? q->limit : DB_RANGE_DEFAULT_LIMIT;
+    if (limit > DB_RANGE_MAX_LIMIT)
+        limit = DB_RANGE_MAX_LIMIT;
+
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, q->from ? STMT_SENSOR_RANGE_ASC : STMT_SENSOR_RANGE_LATEST);
+    if (!stmt)
+        return NULL;
+    // Missing bounds are open ends; any stored timestamp sorts between these
+    sqlite3_bind_int(stmt, 1, q->sensor);
+    sqlite3_bind_text(stmt, 2, q->from ? q->from : "", -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, q->to ? q->to : "9999-12-31 23:59:59", -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, limit);
+    char *out = rows_to_json(stmt);
+    stmt_release(c, stmt);
     return out;
 }
 
+// Report the newest row of one sensor (sensor > 0) or of every sensor
+int db_get_latest(int sensor, db_latest_fn fn, void *ctx)
+{
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, sensor > 0 ? STMT_LATEST_ONE : STMT_LATEST_ALL);
+    if (!stmt)
+        return -1;
+    if (sensor > 0)
+        sqlite3_bind_int(stmt, 1, sensor);
+    int rows = 0, rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const unsigned char *val = sqlite3_column_text(stmt, 2);
+        const unsigned char *ts = sqlite3_column_text(stmt, 3);
+        fn(ctx, sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), val ? (const char *)val : "",
+           ts ? (const char *)ts : "");
+        rows++;
+    }
+    stmt_release(c, stmt);
+    return rc == SQLITE_DONE ? rows : -1;
+}
+
 /* Return the raw stored 'value' (no JSON envelope). Caller must free. */
 char *db_get_raw_by_id(int id)
 {
-    const char *sql = "SELECT value FROM data WHERE id=?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_GET_RAW_BY_ID);
+    if (!stmt)
         return NULL;
     sqlite3_bind_int(stmt, 1, id);
     char *out = NULL;
@@ -192,16 +896,16 @@ char *db_get_raw_by_id(int id)
                 memcpy(out, val, n);
         }
     }
-    sqlite3_finalize(stmt);
+    stmt_release(c, stmt);
     return out;
 }
 
 /* Return JSON object for a specific id {"id":x, "value":..., "ts":...} */
 char *db_get_by_id(int id)
 {
-    const char *sql = "SELECT value,timestamp FROM data WHERE id=?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    db_conn_t *c = db_reader();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_GET_BY_ID);
+    if (!stmt)
         return NULL;
     sqlite3_bind_int(stmt, 1, id);
     char *out = NULL;
@@ -214,7 +918,7 @@ char *db_get_by_id(int id)
             snprintf(out, 512,
                      "{\"id\":%d, \"value\":\"%s\", \"ts\":\"%s\"}", id, val ? (const char *)val : "", ts ? (const char *)ts : "");
     }
-    sqlite3_finalize(stmt);
+    stmt_release(c, stmt);
     return out;
 }
 
@@ -225,99 +929,62 @@ char *db_get_by_id(int id)
 // Update value for an id
 int db_update(int id, const char *value)
 {
-    const char *sql = "UPDATE data SET value=? WHERE id=?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    double temp, hum;
+    parse_temp_hum(value, &temp, &hum);
+    db_conn_t *c = db_writer();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_UPDATE);
+    if (!stmt)
         return -1;
     sqlite3_bind_text(stmt, 1, value, -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, id);
+    bind_reading(stmt, 2, temp);
+    bind_reading(stmt, 3, hum);
+    sqlite3_bind_int(stmt, 4, id);
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0) ? 0 : -1;
+    int changed = sqlite3_changes(c->handle) > 0;
+    stmt_release(c, stmt);
+    return (rc == SQLITE_DONE && changed) ? 0 : -1;
 }
 
 // Delete record by id
 int db_delete(int id)
 {
-    const char *sql = "DELETE FROM data WHERE id=?;";
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    db_conn_t *c = db_writer();
+    sqlite3_stmt *stmt = stmt_acquire(c, STMT_DELETE);
+    if (!stmt)
         return -1;
     sqlite3_bind_int(stmt, 1, id);
     int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return (rc == SQLITE_DONE && sqlite3_changes(db) > 0) ? 0 : -1;
+    int changed = sqlite3_changes(c->handle) > 0;
+    stmt_release(c, stmt);
+    return (rc == SQLITE_DONE && changed) ? 0 : -1;
 }
 
-/* Helper: parse numeric temp/hum values from a stored string.
-   It looks for "temp":<number> and "hum":<number> anywhere in text.
-   If not found sets out_temp/out_hum to HUGE_VAL (NaN-like sentinel).
-*/
-static void parse_temp_hum(const char *s, double *out_temp, double *out_hum)
-{
-    const char *p;
-    char *end;
-    *out_temp = HUGE_VAL;
-    *out_hum = HUGE_VAL;
-
-    if (!s)
-        return;
-    // Look for "temp":<number>
-    p = strstr(s, "temp");
-    if (p)
-    {
-        /* find ':' after temp */
-        p = strchr(p, ':');
-        if (p)
-        {
-            p++;
-            while (*p && isspace((unsigned char)*p))
-                p++;
-            double v = strtod(p, &end);
-            if (end != p)
-                *out_temp = v;
-        }
-    }
-    p = strstr(s, "hum");
-    if (p)
-    {
-        p = strchr(p, ':');
-        if (p)
-        {
-            p++;
-            while (*p && isspace((unsigned char)*p))
-                p++;
-            double v = strtod(p, &end);
-            if (end != p)
-                *out_hum = v;
-        }
-    }
-}
-
-/* Update only one field inside the stored JSON-like value (temp or hum).
+/* Update only one field (temp or hum) of a reading.
    If row doesn't exist return -1. On success return 0.
-   Strategy: read raw, parse temp and hum, replace the specified field and write back a clean JSON:
+   A single UPDATE sets the column and rewrites the stored value as a clean JSON:
      {"temp":<x.xx>,"hum":<y.yy>}
+   (an unparsable new_value keeps the current reading).
 */
 int db_update_field_in_json(int id, const char *field, const char *new_value)
 {
     if (!field || !new_value)
         return -1;
 
-    char *raw = db_get_raw_by_id(id);
-    if (!raw)
+    stmt_id_t which;
+    if (strcasecmp(field, "temp") == 0)
+        which = STMT_UPDATE_TEMP;
+    else if (strcasecmp(field, "hum") == 0)
+        which = STMT_UPDATE_HUM;
+    else
         return -1;
 
-    double temp_v = HUGE_VAL, hum_v = HUGE_VAL;
-    parse_temp_hum(raw, &temp_v, &hum_v);
-
     /* parse new_value as number if possible */
     char *endptr = NULL;
-    double newnum = strtod(new_value, &endptr);
-    if (endptr == new_value)
+    const char *p = new_value;
+    double newnum = strtod(p, &endptr);
+    if (endptr == p)
     {
         /* not a number; try to strip quotes and parse */
-        const char *p = new_value;
         while (*p && isspace((unsigned char)*p))
             p++;
         if (*p == '"' || *p == '\'')
@@ -325,41 +992,28 @@ int db_update_field_in_json(int id, const char *field, const char *new_value)
         newnum = strtod(p, &endptr);
     }
 
-    if (strcasecmp(field, "temp") == 0)
-    {
-        if (endptr != new_value)
-            temp_v = newnum;
-    }
-    else if (strcasecmp(field, "hum") == 0)
-    {
-        if (endptr != new_value)
-            hum_v = newnum;
-    }
-    else
-    {
-        free(raw);
+    db_conn_t *c = db_writer();
+    sqlite3_stmt *stmt = stmt_acquire(c, which);
+    if (!stmt)
         return -1;
-    }
-
-    /* If any value still not found, set to 0.0 as fallback */
-    if (!isfinite(temp_v))
-        temp_v = 0.0;
-    if (!isfinite(hum_v))
-        hum_v = 0.0;
-
-    char buf[128];
-    snprintf(buf, sizeof(buf), "{\"temp\":%.2f,\"hum\":%.2f}", temp_v, hum_v);
-
-    int rc = db_update(id, buf);
-    free(raw);
-    return rc;
+    bind_reading(stmt, 1, endptr != p ? newnum : HUGE_VAL);
+    sqlite3_bind_int(stmt, 2, id);
+    int rc = sqlite3_step(stmt);
+    int changed = sqlite3_changes(c->handle) > 0;
+    stmt_release(c, stmt);
+    return (rc == SQLITE_DONE && changed) ? 0 : -1;
 }
 
 void db_close(void)
 {
-    if (db)
+    db_group_commit_stop();
+    for (int i = 0; i < reader_count; i++)
     {
-        sqlite3_close(db);
-        db = NULL;
+        conn_close(&readers[i]);
+        pthread_mutex_destroy(&readers[i].lock);
     }
-}
\ No newline at end of file
+    free(readers);
+    readers = NULL;
+    reader_count = 0;
+    conn_close(&writer);
+}
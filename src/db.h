@@ -2,12 +2,34 @@
 #define DB_H
 
 #include <sqlite3.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /* -------------------------
    Database initialization
    ------------------------- */
+#define DB_DEFAULT_READERS 4
+#define DB_DEFAULT_BUSY_TIMEOUT_MS 5000
+#define DB_DEFAULT_WAL_AUTOCHECKPOINT 1000
+
+/* Connection pool settings: one writer plus `readers` read-only connections (WAL mode) */
+typedef struct
+{
+    int readers;            // read-only connections (0 = reads share the writer)
+    int busy_timeout_ms;    // how long a connection retries on SQLITE_BUSY
+    int wal_autocheckpoint; // WAL pages before an automatic checkpoint (0 = only db_checkpoint)
+} db_config_t;
+
+void db_default_config(db_config_t *cfg);
+
+/* Open with the default pool settings */
 int db_init(const char *filename);
 
+int db_init_pool(const char *filename, const db_config_t *cfg);
+
+/* Passive WAL checkpoint. Returns 0 on success. */
+int db_checkpoint(void);
+
 /* -------------------------
    Insert functions
    ------------------------- */
@@ -17,6 +39,25 @@ int db_insert_with_id(int id, const char *value);
 
 int db_insert_with_sensor(int sensor, const char *value);
 
+/* db_insert_with_sensor that also copies the row's stored timestamp
+   ("YYYY-MM-DD HH:MM:SS") into ts (DB_TS_SIZE bytes, may be NULL). */
+#define DB_TS_SIZE 20
+
+int db_insert_with_sensor_ts(int sensor, const char *value, char *ts);
+
+/* -------------------------
+   Group commit
+   ------------------------- */
+/* Start the ingest writer thread. From then on db_insert and db_insert_with_sensor
+   queue their row and block until it is committed; rows are committed together,
+   one transaction per max_rows rows or max_delay_ms after the first queued row. */
+int db_group_commit_start(int max_rows, int max_delay_ms);
+
+/* Commit what is queued and stop the thread (inserts run directly again). */
+void db_group_commit_stop(void);
+
+void db_group_commit_stats(uint64_t *batches, uint64_t *rows);
+
 /* -------------------------
    Read functions
    ------------------------- */
@@ -24,15 +65,47 @@ int db_insert_with_sensor(int sensor, const char *value);
 /* Return the raw stored 'value' (no JSON envelope). Caller must free. */
 char *db_get_raw_by_id(int id);
 
-/* Update only one field inside the stored JSON-like value (temp or hum).
+/* Update only one field of a reading (temp or hum).
    If row doesn't exist return -1. On success return 0.
-   Strategy: read raw, parse temp and hum, replace the specified field and write back a clean JSON:
+   One UPDATE sets the REAL column and rewrites the stored value as a clean JSON:
      {"temp":<x.xx>,"hum":<y.yy>}
 */
 int db_update_field_in_json(int id, const char *field, const char *new_value);
 
+/* Last 26 rows as a JSON array, oldest first. Caller must free. */
 char *db_get_all(void);
 
+/* Keyset pagination: rows with id > after_id in id order, at most `limit`
+   (<= 0 or larger -> DB_RANGE_MAX_LIMIT), as a JSON array written into out (NUL-terminated).
+   The page stops at the last row that fits in cap. *next_after is the after_id
+   of the next page, 0 once the last row was returned. Returns the length written,
+   -1 on error (or when a single row does not fit in cap). */
+int db_get_page(int after_id, int limit, char *out, size_t cap, int *next_after);
+
+/* Per-sensor time range query, answered by an index range scan on (sensor, timestamp) */
+#define DB_RANGE_DEFAULT_LIMIT 26
+#define DB_RANGE_MAX_LIMIT 100
+
+typedef struct
+{
+    int sensor;       // sensor id (rows stored through sensor/<n>)
+    const char *from; // inclusive lower bound "YYYY-MM-DD HH:MM:SS", NULL = open
+    const char *to;   // inclusive upper bound, NULL = open
+    int limit;        // max rows; <= 0 -> DB_RANGE_DEFAULT_LIMIT, capped at DB_RANGE_MAX_LIMIT
+} db_range_t;
+
+/* JSON array (same format as db_get_all), oldest first. With `from` the first `limit`
+   rows after it are returned, otherwise the latest `limit` rows. Caller must free. */
+char *db_get_sensor_range(const db_range_t *q);
+
+/* Newest reading (latest timestamp, then highest id) of sensor `sensor`, or of every
+   sensor when sensor <= 0: fn is called once per sensor, on the reader connection,
+   with strings that are only valid during the call. Returns the number of rows
+   reported, -1 on error. */
+typedef void (*db_latest_fn)(void *ctx, int sensor, int id, const char *value, const char *ts);
+
+int db_get_latest(int sensor, db_latest_fn fn, void *ctx);
+
 /* Return JSON object for a specific id {"id":x, "value":..., "ts":...} */
 char *db_get_by_id(int id);
 
@@ -0,0 +1,41 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/* -------------------------
+   USDT probes
+   -------------------------
+   Static probe points (provider "smartcoap") on the request and database hot
+   paths, for perf or bpftrace on a running server:
+
+     request_receive (task, len)        datagram handed to a worker queue (receive thread)
+     request_start   (task)             worker picked the datagram up
+     request_parsed  (mid, code)        CoAP header and options parsed
+     dedup_hit       (mid, result)      retransmission answered from cache (1) or dropped (2)
+     db_stmt_start   (stmt, sql)        statement bound to a locked connection
+     db_stmt_end     (stmt)             statement reset, connection unlocked
+     response_send   (mid, code, len)   response handed to the transmit batch
+
+   With <sys/sdt.h> (systemtap-sdt-dev) each probe is a single nop plus an
+   ELF note; the arguments are only read by an attached tracer. Without it,
+   or with -DSMARTCOAP_NO_PROBES, the probes compile to nothing. Sample
+   scripts are in sh_files/bpftrace/.
+*/
+#if !defined(SMARTCOAP_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SMARTCOAP_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef SMARTCOAP_HAVE_PROBES
+#define PROBE1(name, a) DTRACE_PROBE1(smartcoap, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(smartcoap, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(smartcoap, name, a, b, c)
+#else
+// sizeof keeps the arguments "used" without evaluating them
+#define PROBE1(name, a) ((void)sizeof(a))
+#define PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include "../src/db.h"
+
+/*
+ * Insert throughput: prepare/finalize per insert (the old db.c pattern)
+ * vs. db_insert_with_sensor with its cached prepared statement.
+ * Both run against in-memory databases so SQL compilation, not fsync,
+ * dominates the cost.
+ *
+ * Then, on a database file with BENCH_THREADS concurrent writers (like the
+ * worker pool), one transaction per insert vs. group commit.
+ *
+ * Usage: bench_db_insert [rows]   (default 20000)
+ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Baseline: compile the INSERT for every row
+static double bench_prepare_per_insert(int rows, const char *value)
+{
+    sqlite3 *db;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK)
+        return -1;
+    sqlite3_exec(db,
+                 "CREATE TABLE data (id INTEGER PRIMARY KEY AUTOINCREMENT, sensor INTEGER DEFAULT 0,"
+                 "value TEXT NOT NULL, timestamp DATETIME DEFAULT "
+                 "(strftime('%Y-%m-%d %H:%M:%S','now','localtime')));",
+                 0, 0, NULL);
+
+    double t0 = now_sec();
+    for (int i = 0; i < rows; i++)
+    {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, "INSERT INTO data (sensor, value) VALUES (?, ?);", -1, &stmt, NULL) != SQLITE_OK)
+            break;
+        sqlite3_bind_int(stmt, 1, i % 16);
+        sqlite3_bind_text(stmt, 2, value, -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    double dt = now_sec() - t0;
+    sqlite3_close(db);
+    return dt;
+}
+
+// Cached: db_insert_with_sensor reuses one statement
+static double bench_cached(int rows, const char *value)
+{
+    if (db_init(":memory:") != 0)
+        return -1;
+    double t0 = now_sec();
+    for (int i = 0; i < rows; i++)
+    {
+        if (db_insert_with_sensor(i % 16, value) <= 0)
+            break;
+    }
+    double dt = now_sec() - t0;
+    db_close();
+    return dt;
+}
+
+#define BENCH_THREADS 8
+#define BENCH_DB_FILE "bench_db_insert.db"
+
+typedef struct
+{
+    int rows;
+    const char *value;
+    int failed;
+} writer_arg_t;
+
+static void *writer_main(void *arg)
+{
+    writer_arg_t *w = (writer_arg_t *)arg;
+    for (int i = 0; i < w->rows; i++)
+    {
+        if (db_insert_with_sensor(i % 16, w->value) <= 0)
+            w->failed++;
+    }
+    return NULL;
+}
+
+// BENCH_THREADS threads insert `rows` rows in total into a fresh database file
+static double bench_file(int rows, const char *value, int group_rows)
+{
+    remove(BENCH_DB_FILE);
+    remove(BENCH_DB_FILE "-wal");
+    remove(BENCH_DB_FILE "-shm");
+    if (db_init(BENCH_DB_FILE) != 0)
+        return -1;
+    if (group_rows > 0 && db_group_commit_start(group_rows, 5) != 0)
+        return -1;
+
+    pthread_t th[BENCH_THREADS];
+    writer_arg_t args[BENCH_THREADS];
+    double t0 = now_sec();
+    for (int i = 0; i < BENCH_THREADS; i++)
+    {
+        args[i].rows = rows / BENCH_THREADS;
+        args[i].value = value;
+        args[i].failed = 0;
+        pthread_create(&th[i], NULL, writer_main, &args[i]);
+    }
+    int failed = 0;
+    for (int i = 0; i < BENCH_THREADS; i++)
+    {
+        pthread_join(th[i], NULL);
+        failed += args[i].failed;
+    }
+    double dt = now_sec() - t0;
+    db_close();
+    remove(BENCH_DB_FILE);
+    remove(BENCH_DB_FILE "-wal");
+    remove(BENCH_DB_FILE "-shm");
+    return failed ? -1 : dt;
+}
+
+int main(int argc, char **argv)
+{
+    int rows = argc > 1 ? atoi(argv[1]) : 20000;
+    if (rows <= 0)
+        rows = 20000;
+    const char *value = "{\"temp\":23.45,\"hum\":51.20}";
+
+    printf("=== bench_db_insert: %d rows ===\n", rows);
+    double before = bench_prepare_per_insert(rows, value);
+    double after = bench_cached(rows, value);
+    if (before <= 0 || after <= 0)
+    {
+        printf("bench_db_insert FAILED: database error\n");
+        return 1;
+    }
+    printf("prepare per insert : %10.0f inserts/s\n", rows / before);
+    printf("cached statement   : %10.0f inserts/s (%.2fx)\n", rows / after, before / after);
+
+    // fsync-bound: fewer rows keep the run short
+    int file_rows = rows / 10 < BENCH_THREADS ? BENCH_THREADS : rows / 10;
+    file_rows -= file_rows % BENCH_THREADS;
+    double single = bench_file(file_rows, value, 0);
+    double grouped = bench_file(file_rows, value, BENCH_THREADS);
+    if (single <= 0 || grouped <= 0)
+    {
+        printf("bench_db_insert FAILED: file database error\n");
+        return 1;
+    }
+    printf("file, %d writers, commit per row : %10.0f inserts/s\n", BENCH_THREADS, file_rows / single);
+    printf("file, %d writers, group commit   : %10.0f inserts/s (%.2fx)\n", BENCH_THREADS,
+           file_rows / grouped, single / grouped);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../src/coap.h"
+#include "../server/arena.h"
+#include "../server/etag.h"
+
+/*
+ * Request arena (server/arena.c)
+ * - allocations are 8-byte aligned and served from the arena block
+ * - what does not fit falls back to the heap and is counted; reset releases it
+ * - response options added through the codec allocator hook live in the arena
+ *   and coap_free_message leaves them alone
+ */
+
+static int in_arena(const arena_t *a, const void *p)
+{
+    const uint8_t *b = p;
+    return b >= a->base && b < a->base + a->cap;
+}
+
+int main(void)
+{
+    printf("=== Running request arena tests ===\n");
+
+    arena_t *a = arena_thread();
+    if (!a || arena_thread() != a)
+    {
+        printf("arena_thread failed\n");
+        return 1;
+    }
+
+    // TC-ARENA.1 aligned bump allocations, strndup, reset starts over
+    {
+        uint8_t *p1 = arena_alloc(a, 3);
+        uint8_t *p2 = arena_alloc(a, 5);
+        char *s = arena_strndup(a, "sensor/42?x", 9);
+        size_t used = a->used;
+        int ok = p1 && p2 && s && in_arena(a, p1) && in_arena(a, p2) && in_arena(a, s) && p2 == p1 + 8 &&
+                 ((uintptr_t)s & 7) == 0 && strcmp(s, "sensor/42") == 0 && a->allocs == 3 && a->fallbacks == 0;
+        arena_reset(a);
+        uint8_t *again = arena_alloc(a, 3);
+        arena_reset(a);
+        if (!ok || used != 26 || again != p1 || a->used != 0)
+        {
+            printf("TC-ARENA.1 FAILED: ok=%d used=%zu\n", ok, used);
+            return 1;
+        }
+        printf("TC-ARENA.1 PASS: 8-byte aligned allocations, reset reuses the block\n");
+    }
+
+    // TC-ARENA.2 an allocation that does not fit comes from the heap until the reset
+    {
+        arena_stats_t before, after;
+        arena_get_stats(&before);
+        uint8_t *small = arena_alloc(a, REQUEST_ARENA_SIZE - 16);
+        uint8_t *big = arena_alloc(a, 64); // past the end of the block
+        uint8_t *huge = arena_alloc(a, 4 * REQUEST_ARENA_SIZE);
+        int ok = small && big && huge && in_arena(a, small) && !in_arena(a, big) && !in_arena(a, huge) &&
+                 a->fallbacks == 2 && a->overflow != NULL && ((uintptr_t)big & 7) == 0;
+        if (ok)
+        {
+            memset(big, 0xAB, 64);
+            memset(huge, 0xCD, 4 * REQUEST_ARENA_SIZE);
+        }
+        arena_reset(a);
+        arena_get_stats(&after);
+        if (!ok || a->overflow != NULL || after.requests != before.requests + 1 || after.allocs != before.allocs + 3 ||
+            after.fallbacks != before.fallbacks + 2)
+        {
+            printf("TC-ARENA.2 FAILED: ok=%d fallbacks=%llu\n", ok,
+                   (unsigned long long)(after.fallbacks - before.fallbacks));
+            return 1;
+        }
+        printf("TC-ARENA.2 PASS: overflow served from the heap, released and counted on reset\n");
+    }
+
+    // TC-ARENA.3 response options through the codec allocator hook
+    {
+        coap_message_t m;
+        coap_init_message(&m);
+        m.type = COAP_TYPE_ACK;
+        m.code = COAP_CODE_CONTENT;
+        m.message_id = 0x1234;
+        coap_set_allocator(&m, arena_alloc_fn, a);
+        const uint8_t etag[4] = {1, 2, 3, 4}, fmt = COAP_FORMAT_JSON, age = 60;
+        int ok = coap_add_option(&m, COAP_OPTION_MAX_AGE, &age, 1) == COAP_OK &&
+                 coap_add_option(&m, COAP_OPTION_ETAG, etag, sizeof(etag)) == COAP_OK &&
+                 coap_add_option(&m, COAP_OPTION_CONTENT_FORMAT, &fmt, 1) == COAP_OK;
+        for (size_t i = 0; ok && i < m.options_count; i++)
+            ok = in_arena(a, m.options[i].value);
+        ok = ok && m.options_count == 3 && in_arena(a, m.options) && m.options[0].number == COAP_OPTION_ETAG &&
+             m.options[1].number == COAP_OPTION_CONTENT_FORMAT && m.options[2].number == COAP_OPTION_MAX_AGE;
+        uint8_t wire[64];
+        coap_message_view_t v;
+        int n = coap_serialize(&m, wire, sizeof(wire));
+        int parsed = n > 0 && coap_parse_view(wire, (size_t)n, &v) == COAP_OK && v.options_count == 3 &&
+                     v.options[0].length == sizeof(etag) && memcmp(v.options[0].value, etag, sizeof(etag)) == 0;
+        coap_free_message(&m); // must not free arena memory
+        int cleared = m.options == NULL && m.options_count == 0;
+        arena_reset(a);
+        if (!ok || !parsed || !cleared)
+        {
+            printf("TC-ARENA.3 FAILED: ok=%d parsed=%d cleared=%d\n", ok, parsed, cleared);
+            return 1;
+        }
+        printf("TC-ARENA.3 PASS: %zu-byte response whose options all came from the arena\n", (size_t)n);
+    }
+
+    printf("=== All request arena tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../server/async_log.h"
+
+/*
+ * Asynchronous logger (server/async_log.c)
+ * - lines from several threads all reach the file, each as one well-formed line
+ * - a full ring drops lines and counts them instead of blocking
+ * - overlong lines are cut at ASYNC_LOG_LINE_MAX
+ * - binary records reach the file unchanged, back to back
+ */
+
+#define THREADS 4
+#define LINES_PER_THREAD 2000
+
+static void log_line(const char *level, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    async_log_vprintf(level, fmt, ap);
+    va_end(ap);
+}
+
+static void *producer(void *arg)
+{
+    int t = (int)(long)arg;
+    for (int i = 0; i < LINES_PER_THREAD; i++)
+        log_line("INFO", "thread=%d line=%d", t, i);
+    return NULL;
+}
+
+// Count the lines of f that look like "[YYYY-MM-DD HH:MM:SS] LEVEL: text"
+static int count_lines(FILE *f, int *malformed, int *drop_notes, size_t *longest)
+{
+    char line[1024];
+    int n = 0;
+    *malformed = *drop_notes = 0;
+    *longest = 0;
+    rewind(f);
+    while (fgets(line, sizeof(line), f))
+    {
+        size_t len = strlen(line);
+        if (len < 24 || line[0] != '[' || line[20] != ']' || line[len - 1] != '\n')
+            (*malformed)++;
+        if (strstr(line, "lines dropped"))
+            (*drop_notes)++;
+        if (len > *longest)
+            *longest = len;
+        n++;
+    }
+    return n;
+}
+
+int main(void)
+{
+    printf("=== Running async logger tests ===\n");
+    int malformed, notes;
+    size_t longest;
+    async_log_stats_t st;
+
+    // TC-LOG.1 concurrent producers, every line written once
+    {
+        FILE *f = tmpfile();
+        if (!f || async_log_start(f, ASYNC_LOG_DEFAULT_CAPACITY) != 0 || !async_log_active(f))
+        {
+            printf("TC-LOG.1 FAILED: start\n");
+            return 1;
+        }
+        pthread_t th[THREADS];
+        for (long t = 0; t < THREADS; t++)
+            pthread_create(&th[t], NULL, producer, (void *)t);
+        for (int t = 0; t < THREADS; t++)
+            pthread_join(th[t], NULL);
+        async_log_stop();
+        async_log_get_stats(&st);
+        int n = count_lines(f, &malformed, &notes, &longest);
+        if (async_log_active(f) || st.lines + st.dropped != THREADS * LINES_PER_THREAD ||
+            (uint64_t)(n - notes) != st.lines || malformed != 0 || st.batches == 0)
+        {
+            printf("TC-LOG.1 FAILED: file=%d written=%llu dropped=%llu malformed=%d\n", n,
+                   (unsigned long long)st.lines, (unsigned long long)st.dropped, malformed);
+            return 1;
+        }
+        printf("TC-LOG.1 PASS: %llu lines in %llu writes\n", (unsigned long long)st.lines,
+               (unsigned long long)st.batches);
+        fclose(f);
+    }
+
+    // TC-LOG.2 tiny ring: producers never block, losses are counted and reported
+    {
+        FILE *f = tmpfile();
+        if (!f || async_log_start(f, 4) != 0)
+        {
+            printf("TC-LOG.2 FAILED: start\n");
+            return 1;
+        }
+        const int total = 20000;
+        for (int i = 0; i < total; i++)
+            log_line("INFO", "burst line=%d", i);
+        async_log_stop();
+        async_log_get_stats(&st);
+        int n = count_lines(f, &malformed, &notes, &longest);
+        if (st.lines + st.dropped != (uint64_t)total || (uint64_t)(n - notes) != st.lines || malformed != 0 ||
+            (st.dropped > 0 && notes == 0))
+        {
+            printf("TC-LOG.2 FAILED: written=%llu dropped=%llu notes=%d\n", (unsigned long long)st.lines,
+                   (unsigned long long)st.dropped, notes);
+            return 1;
+        }
+        printf("TC-LOG.2 PASS: %llu written, %llu dropped\n", (unsigned long long)st.lines,
+               (unsigned long long)st.dropped);
+        fclose(f);
+    }
+
+    // TC-LOG.3 overlong lines are cut
+    {
+        FILE *f = tmpfile();
+        char big[1000];
+        memset(big, 'x', sizeof(big) - 1);
+        big[sizeof(big) - 1] = '\0';
+        if (!f || async_log_start(f, 16) != 0)
+        {
+            printf("TC-LOG.3 FAILED: start\n");
+            return 1;
+        }
+        log_line("ERROR", "%s", big);
+        async_log_stop();
+        int n = count_lines(f, &malformed, &notes, &longest);
+        size_t expect = sizeof("[2025-01-01 00:00:00] ERROR: ") - 1 + ASYNC_LOG_LINE_MAX - 1 + 1;
+        if (n != 1 || malformed != 0 || longest != expect)
+        {
+            printf("TC-LOG.3 FAILED: lines=%d longest=%zu expected=%zu\n", n, longest, expect);
+            return 1;
+        }
+        printf("TC-LOG.3 PASS: long line cut to %d bytes of text\n", ASYNC_LOG_LINE_MAX - 1);
+        fclose(f);
+    }
+
+    // TC-LOG.4 binary records are written as is
+    {
+        FILE *f = tmpfile();
+        if (!f || async_log_start(f, 128) != 0)
+        {
+            printf("TC-LOG.4 FAILED: start\n");
+            return 1;
+        }
+        const int records = 100;
+        for (int i = 0; i < records; i++)
+        {
+            log_bin_record_t rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.magic = LOG_BIN_MAGIC;
+            rec.type = LOG_BIN_REQUEST;
+            rec.level = LOG_LEVEL_INFO;
+            rec.sec = 1700000000 + i;
+            rec.u.request.mid = (uint16_t)i;
+            rec.u.request.method = 1;
+            rec.u.request.response = 69;
+            snprintf(rec.u.request.uri, sizeof(rec.u.request.uri), "sensor/%d", i);
+            if (async_log_write_binary(&rec) != 0)
+            {
+                printf("TC-LOG.4 FAILED: record %d dropped\n", i);
+                return 1;
+            }
+        }
+        async_log_stop();
+        long size = ftell(f);
+        rewind(f);
+        int ok = size == (long)(records * sizeof(log_bin_record_t));
+        for (int i = 0; ok && i < records; i++)
+        {
+            log_bin_record_t rec;
+            char uri[16];
+            snprintf(uri, sizeof(uri), "sensor/%d", i);
+            ok = fread(&rec, sizeof(rec), 1, f) == 1 && rec.magic == LOG_BIN_MAGIC && rec.type == LOG_BIN_REQUEST &&
+                 rec.u.request.mid == i && rec.sec == 1700000000 + i && strcmp(rec.u.request.uri, uri) == 0;
+        }
+        if (!ok)
+        {
+            printf("TC-LOG.4 FAILED: size=%ld expected=%zu\n", size, records * sizeof(log_bin_record_t));
+            return 1;
+        }
+        printf("TC-LOG.4 PASS: %d binary records of %zu bytes\n", records, sizeof(log_bin_record_t));
+        fclose(f);
+    }
+
+    printf("=== All async logger tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include "../server/block_cache.h"
+
+/*
+ * Block2 response snapshots (server/block_cache.c)
+ * - blocks are sliced from the stored body with its ETag, and the snapshot
+ *   is dropped once its last block is read
+ * - snapshots are keyed by endpoint and token; a new block 0 replaces the old one
+ * - a block past the end reads 0 bytes, an expired snapshot is swept
+ */
+
+static struct sockaddr_in endpoint(const char *ip, uint16_t port)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    inet_pton(AF_INET, ip, &a.sin_addr);
+    return a;
+}
+
+int main(void)
+{
+    printf("=== Running block snapshot cache tests ===\n");
+
+    static block_cache_t cache;
+    if (block_cache_init(&cache) != 0)
+    {
+        printf("block_cache_init failed\n");
+        return 1;
+    }
+    struct sockaddr_in a = endpoint("10.0.0.1", 5000), b = endpoint("10.0.0.1", 5001);
+    const uint8_t tok[2] = {0xAB, 0xCD}, tok2[1] = {0x01};
+    const uint8_t tag[BLOCK_ETAG_MAX] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t body[100], out[32], etag[BLOCK_ETAG_MAX];
+    for (size_t i = 0; i < sizeof(body); i++)
+        body[i] = (uint8_t)i;
+
+    // TC-BLK.1 every block comes from the snapshot, the last read drops it
+    {
+        size_t total = 0, etag_len = 0;
+        int ok = block_cache_put(&cache, &a, tok, sizeof(tok), body, sizeof(body), tag, sizeof(tag)) == 0;
+        for (size_t off = 0; ok && off < sizeof(body); off += sizeof(out))
+        {
+            size_t want = sizeof(body) - off < sizeof(out) ? sizeof(body) - off : sizeof(out);
+            long n = block_cache_read(&cache, &a, tok, sizeof(tok), off, out, sizeof(out), &total, etag, &etag_len);
+            ok = n == (long)want && total == sizeof(body) && memcmp(out, body + off, want) == 0 &&
+                 etag_len == sizeof(tag) && memcmp(etag, tag, sizeof(tag)) == 0;
+        }
+        long after = block_cache_read(&cache, &a, tok, sizeof(tok), 0, out, sizeof(out), &total, etag, &etag_len);
+        block_cache_stats_t st;
+        block_cache_get_stats(&cache, &st);
+        if (!ok || after != -1 || st.snapshots != 0 || st.bytes != 0 || st.hits != 4 || st.misses != 1)
+        {
+            printf("TC-BLK.1 FAILED: ok=%d after=%ld snapshots=%zu hits=%llu\n", ok, after, st.snapshots,
+                   (unsigned long long)st.hits);
+            return 1;
+        }
+        printf("TC-BLK.1 PASS: 4 blocks with the ETag of block 0, snapshot dropped after the last\n");
+    }
+
+    // TC-BLK.2 keys: endpoint and token; a new block 0 replaces the snapshot
+    {
+        size_t total = 0, etag_len = 0;
+        block_cache_put(&cache, &a, tok, sizeof(tok), body, sizeof(body), NULL, 0);
+        block_cache_put(&cache, &a, tok, sizeof(tok), body + 50, 50, tag, sizeof(tag)); // replaces
+        block_cache_put(&cache, &b, tok, sizeof(tok), body, sizeof(body), NULL, 0);
+        block_cache_put(&cache, &a, tok2, sizeof(tok2), body, sizeof(body), NULL, 0);
+        long n = block_cache_read(&cache, &a, tok, sizeof(tok), 0, out, sizeof(out), &total, etag, &etag_len);
+        int replaced = n == (long)sizeof(out) && total == 50 && out[0] == 50 && etag_len == sizeof(tag);
+        long past = block_cache_read(&cache, &a, tok, sizeof(tok), 64, out, sizeof(out), &total, etag, &etag_len);
+        long other = block_cache_read(&cache, &b, tok, sizeof(tok), 0, out, sizeof(out), &total, etag, &etag_len);
+        int untagged = other == (long)sizeof(out) && total == sizeof(body) && etag_len == 0;
+        block_cache_stats_t st;
+        block_cache_get_stats(&cache, &st);
+        if (!replaced || past != 0 || !untagged || st.snapshots != 3)
+        {
+            printf("TC-BLK.2 FAILED: replaced=%d past=%ld untagged=%d snapshots=%zu\n", replaced, past, untagged,
+                   st.snapshots);
+            return 1;
+        }
+        printf("TC-BLK.2 PASS: one snapshot per (endpoint, token), block past the end reads nothing\n");
+    }
+
+    // TC-BLK.3 expired snapshots are swept
+    {
+        size_t total = 0, etag_len = 0;
+        block_cache_sweep(&cache, time(NULL) + BLOCK_SNAPSHOT_LIFETIME + 1);
+        long n = block_cache_read(&cache, &b, tok, sizeof(tok), 0, out, sizeof(out), &total, etag, &etag_len);
+        block_cache_stats_t st;
+        block_cache_get_stats(&cache, &st);
+        if (n != -1 || st.snapshots != 0 || st.expired != 3)
+        {
+            printf("TC-BLK.3 FAILED: n=%ld snapshots=%zu expired=%llu\n", n, st.snapshots,
+                   (unsigned long long)st.expired);
+            return 1;
+        }
+        printf("TC-BLK.3 PASS: %llu expired snapshots swept\n", (unsigned long long)st.expired);
+    }
+
+    block_cache_destroy(&cache);
+    printf("=== All block snapshot cache tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../src/coap.h"
+#include "../server/etag.h"
+
+/*
+ * Entity tags (server/etag.c)
+ * - a tag stays the same until its record, sensor or table is written,
+ *   and changes after that write; other records and sensors keep theirs
+ * - tags from another server start (nonce) never match
+ * - a GET carrying the current tag is answered 2.03 Valid with ETag and
+ *   Max-Age and no payload; a stale tag does not match
+ */
+
+// Serialize a GET with an ETag option and parse it back the way the server does
+static int get_with_etag(const uint8_t etag[ETAG_LEN], uint8_t *buf, size_t cap, coap_message_view_t *view)
+{
+    coap_message_t req;
+    coap_init_message(&req);
+    req.type = COAP_TYPE_CON;
+    req.code = COAP_CODE_GET;
+    req.message_id = 0x2001;
+    coap_add_option(&req, COAP_OPTION_ETAG, etag, ETAG_LEN);
+    int n = coap_serialize(&req, buf, cap);
+    coap_free_message(&req);
+    return n > 0 && coap_parse_view(buf, (size_t)n, view) == COAP_OK;
+}
+
+int main(void)
+{
+    printf("=== Running ETag tests ===\n");
+    etag_init(0x5A5A0001);
+
+    // TC-ETAG.1 stable without writes, changed by the write that concerns it
+    {
+        uint8_t r1[ETAG_LEN], r1_again[ETAG_LEN], r1_after[ETAG_LEN], r2[ETAG_LEN], r2_after[ETAG_LEN];
+        uint8_t table[ETAG_LEN], table_after[ETAG_LEN], s7[ETAG_LEN], s7_after[ETAG_LEN], s7_bumped[ETAG_LEN];
+        etag_for_record(1, r1);
+        etag_for_record(2, r2);
+        etag_for_table(table);
+        etag_for_sensor(7, s7);
+        etag_for_record(1, r1_again);
+        etag_bump(1);
+        etag_for_record(1, r1_after);
+        etag_for_record(2, r2_after);
+        etag_for_table(table_after);
+        etag_for_sensor(7, s7_after);
+        etag_bump_sensor(7);
+        etag_for_sensor(7, s7_bumped);
+        int stable = memcmp(r1, r1_again, ETAG_LEN) == 0;
+        int bumped = memcmp(r1, r1_after, ETAG_LEN) != 0 && memcmp(table, table_after, ETAG_LEN) != 0 &&
+                     memcmp(s7_after, s7_bumped, ETAG_LEN) != 0;
+        int others = memcmp(r2, r2_after, ETAG_LEN) == 0 && memcmp(s7, s7_after, ETAG_LEN) == 0;
+        if (!stable || !bumped || !others)
+        {
+            printf("TC-ETAG.1 FAILED: stable=%d bumped=%d others=%d\n", stable, bumped, others);
+            return 1;
+        }
+        printf("TC-ETAG.1 PASS: tags change with their own writes only\n");
+    }
+
+    // TC-ETAG.2 a restart (new nonce) never reuses a tag
+    {
+        uint8_t before[ETAG_LEN], after[ETAG_LEN];
+        etag_for_record(3, before);
+        etag_init(0x5A5A0002);
+        etag_for_record(3, after);
+        if (memcmp(before, after, ETAG_LEN) == 0)
+        {
+            printf("TC-ETAG.2 FAILED: same tag across nonces\n");
+            return 1;
+        }
+        printf("TC-ETAG.2 PASS: tags are salted per server start\n");
+    }
+
+    // TC-ETAG.3 conditional GET: current tag -> 2.03 with ETag and Max-Age, no payload
+    {
+        uint8_t current[ETAG_LEN], stale[ETAG_LEN], req_buf[64], resp_buf[64];
+        coap_message_view_t req, stale_req, v;
+        etag_for_record(4, stale);
+        etag_bump(4);
+        etag_for_record(4, current);
+        int matched = get_with_etag(current, req_buf, sizeof(req_buf), &req) && etag_request_matches(&req, current);
+        int stale_matched = get_with_etag(stale, req_buf, sizeof(req_buf), &stale_req) &&
+                            etag_request_matches(&stale_req, current);
+
+        coap_message_t resp;
+        coap_init_message(&resp);
+        resp.type = COAP_TYPE_ACK;
+        resp.code = COAP_CODE_VALID;
+        resp.message_id = 0x2001;
+        etag_tag_response(&resp, current, 60);
+        int n = coap_serialize(&resp, resp_buf, sizeof(resp_buf));
+        coap_free_message(&resp);
+        int valid = n > 0 && coap_parse_view(resp_buf, (size_t)n, &v) == COAP_OK && v.code == COAP_CODE_VALID &&
+                    v.options_count == 2 && v.options[0].number == COAP_OPTION_ETAG &&
+                    v.options[0].length == ETAG_LEN && memcmp(v.options[0].value, current, ETAG_LEN) == 0 &&
+                    v.options[1].number == COAP_OPTION_MAX_AGE && v.options[1].length == 1 &&
+                    v.options[1].value[0] == 60 && v.payload_len == 0;
+        if (!matched || stale_matched || !valid)
+        {
+            printf("TC-ETAG.3 FAILED: matched=%d stale=%d valid=%d\n", matched, stale_matched, valid);
+            return 1;
+        }
+        printf("TC-ETAG.3 PASS: matching ETag -> 2.03 with ETag and Max-Age, no payload\n");
+    }
+
+    printf("=== All ETag tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../server/latest_cache.h"
+
+/*
+ * Latest reading per sensor (server/latest_cache.c)
+ * - a newer reading (timestamp, then id) replaces the stored one, an older one does not
+ * - a rewritten/deleted row can be replaced by an older one, or dropped
+ * - the row-id lookup finds the sensor whose newest reading a row is
+ * - once the cache is full, further sensors are read from the loader
+ */
+
+// Stand-in for db_get_latest: sensor 500001 has a reading, every other none
+static int loader_calls;
+static int fake_load(int sensor, latest_put_fn put, void *ctx)
+{
+    loader_calls++;
+    if (sensor != 500001)
+        return 0;
+    put(ctx, sensor, 900001, "{\"temp\":5}", "2025-01-02 00:00:00");
+    return 1;
+}
+
+int main(void)
+{
+    printf("=== Running latest-reading cache tests ===\n");
+
+    static latest_cache_t cache;
+    if (latest_cache_init(&cache) != 0)
+    {
+        printf("latest_cache_init failed\n");
+        return 1;
+    }
+    char out[256];
+
+    // TC-LAT.1 newest wins, unknown sensors have no reading
+    {
+        int a = latest_cache_put(&cache, 7, 10, "{\"temp\":20}", "2025-01-01 08:00:00", 0);
+        int b = latest_cache_put(&cache, 7, 12, "{\"temp\":21}", "2025-01-01 08:00:05", 0);
+        int c = latest_cache_put(&cache, 7, 11, "{\"temp\":99}", "2025-01-01 08:00:03", 0); // late writer
+        int len = latest_cache_format(&cache, 7, out, sizeof(out));
+        const char *expect = "{\"sensor\":7, \"id\":12, \"value\":\"{\"temp\":21}\", \"ts\":\"2025-01-01 08:00:05\"}";
+        if (a != 1 || b != 1 || c != 0 || len != (int)strlen(expect) || strcmp(out, expect) != 0 ||
+            latest_cache_format(&cache, 8, out, sizeof(out)) != 0)
+        {
+            printf("TC-LAT.1 FAILED: %d %d %d len=%d out=%s\n", a, b, c, len, out);
+            return 1;
+        }
+        printf("TC-LAT.1 PASS: newer reading replaces, older is ignored\n");
+    }
+
+    // TC-LAT.2 stale replacement and removal after PUT/DELETE of the newest row
+    {
+        int sensor = latest_cache_sensor_of(&cache, 12);
+        int other = latest_cache_sensor_of(&cache, 11);
+        int replaced = latest_cache_put(&cache, 7, 10, "{\"temp\":20}", "2025-01-01 08:00:00", 12);
+        int kept_newer = latest_cache_remove(&cache, 7, 12);
+        int dropped = latest_cache_remove(&cache, 7, 10);
+        if (sensor != 7 || other != 0 || replaced != 1 || kept_newer != 0 || dropped != 1 ||
+            latest_cache_format(&cache, 7, out, sizeof(out)) != 0)
+        {
+            printf("TC-LAT.2 FAILED: sensor=%d other=%d replaced=%d kept=%d dropped=%d\n", sensor, other, replaced,
+                   kept_newer, dropped);
+            return 1;
+        }
+        printf("TC-LAT.2 PASS: rewritten/deleted newest row is replaced or dropped\n");
+    }
+
+    // TC-LAT.3 many sensors, small output buffer, stats
+    {
+        int ok = 1;
+        for (int s = 1; s <= 1000 && ok; s++)
+            ok = latest_cache_put(&cache, s, s * 3, "v", "2025-01-01 00:00:00", 0) == 1;
+        for (int s = 1; s <= 1000 && ok; s++)
+            ok = latest_cache_format(&cache, s, out, sizeof(out)) > 0 && strstr(out, "\"id\":") &&
+                 atoi(strstr(out, "\"id\":") + 5) == s * 3;
+        latest_stats_t st;
+        latest_cache_get_stats(&cache, &st);
+        if (!ok || st.sensors != 1000 || latest_cache_format(&cache, 5, out, 8) != -1 ||
+            latest_cache_sensor_of(&cache, 999 * 3) != 999)
+        {
+            printf("TC-LAT.3 FAILED: ok=%d sensors=%zu\n", ok, st.sensors);
+            return 1;
+        }
+        printf("TC-LAT.3 PASS: %zu sensors, %llu hits\n", st.sensors, (unsigned long long)st.hits);
+    }
+
+    // TC-LAT.4 the timestamp decides before the id, as in the database
+    {
+        int later_id = latest_cache_put(&cache, 2000, 50, "{\"temp\":1}", "2025-01-01 08:00:10", 0);
+        int backdated = latest_cache_put(&cache, 2000, 51, "{\"temp\":2}", "2025-01-01 08:00:09", 0);
+        int same_ts = latest_cache_put(&cache, 2000, 52, "{\"temp\":3}", "2025-01-01 08:00:10", 0);
+        int len = latest_cache_format(&cache, 2000, out, sizeof(out));
+        if (later_id != 1 || backdated != 0 || same_ts != 1 || len <= 0 || !strstr(out, "\"id\":52"))
+        {
+            printf("TC-LAT.4 FAILED: %d %d %d out=%s\n", later_id, backdated, same_ts, out);
+            return 1;
+        }
+        printf("TC-LAT.4 PASS: older timestamp loses despite a higher id\n");
+    }
+
+    // TC-LAT.5 a full cache falls back to the loader and still indexes row ids
+    {
+        int s = 10000, rc;
+        while ((rc = latest_cache_put(&cache, s, 100000 + s, "v", "2025-01-01 00:00:00", 0)) == 1)
+            s++;
+        latest_stats_t st;
+        latest_cache_get_stats(&cache, &st);
+        int full = rc == -1 && st.sensors == LATEST_MAX_SENSORS;
+        int unloaded = latest_cache_format(&cache, 500001, out, sizeof(out));
+        latest_cache_set_loader(&cache, fake_load);
+        int loaded = latest_cache_format(&cache, 500001, out, sizeof(out));
+        const char *expect =
+            "{\"sensor\":500001, \"id\":900001, \"value\":\"{\"temp\":5}\", \"ts\":\"2025-01-02 00:00:00\"}";
+        int none = latest_cache_format(&cache, 500002, out + 128, sizeof(out) - 128);
+        int cached = latest_cache_format(&cache, 10000, out + 128, sizeof(out) - 128) > 0 && loader_calls == 2;
+        if (!full || unloaded != 0 || loaded != (int)strlen(expect) || strcmp(out, expect) != 0 || none != 0 ||
+            !cached || latest_cache_sensor_of(&cache, 100000 + s - 1) != s - 1)
+        {
+            printf("TC-LAT.5 FAILED: full=%d unloaded=%d loaded=%d none=%d cached=%d out=%s\n", full, unloaded,
+                   loaded, none, cached, out);
+            return 1;
+        }
+        printf("TC-LAT.5 PASS: %zu sensors cached, the next one read from the loader\n", st.sensors);
+    }
+
+    latest_cache_destroy(&cache);
+    printf("=== All latest-reading cache tests PASSED ===\n");
+    return 0;
+}
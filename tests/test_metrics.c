@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../server/metrics.h"
+
+/*
+ * Request metrics (server/metrics.c)
+ * - log-linear buckets: monotonic, contiguous, at most 25% wide
+ * - per-thread counters from several threads add up in a snapshot
+ * - percentiles land in the right bucket; text and JSON summaries
+ */
+
+#define THREADS 4
+#define REQUESTS_PER_THREAD 10000
+
+static void *recorder(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < REQUESTS_PER_THREAD; i++)
+    {
+        // 1..100 us totals, evenly spread; every 10th request is a 4.04 POST
+        uint64_t total = 1000u * (uint64_t)(i % 100 + 1);
+        uint64_t stages[METRICS_STAGES] = {200, total / 2, 300, total};
+        if (i % 10 == 0)
+            metrics_record(2, 0x84, stages);
+        else
+            metrics_record(1, 0x45, stages);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    printf("=== Running metrics tests ===\n");
+
+    // TC-MET.1 bucket layout
+    {
+        int ok = metrics_bucket(0) == 0 && metrics_bucket(3) == 3 && metrics_bucket(~0ull) == METRICS_HIST_BUCKETS - 1;
+        for (size_t b = 1; ok && b < METRICS_HIST_BUCKETS; b++)
+        {
+            uint64_t low = metrics_bucket_low(b), prev = metrics_bucket_low(b - 1);
+            ok = low > prev && metrics_bucket(low) == b && metrics_bucket(low - 1) == b - 1 &&
+                 (b < 8 || (low - prev) * 4 <= prev);
+        }
+        if (!ok)
+        {
+            printf("TC-MET.1 FAILED: bucket layout\n");
+            return 1;
+        }
+        printf("TC-MET.1 PASS: %d buckets up to %llu ns\n", METRICS_HIST_BUCKETS,
+               (unsigned long long)metrics_bucket_low(METRICS_HIST_BUCKETS - 1));
+    }
+
+    static metrics_snapshot_t snap;
+
+    // TC-MET.2 several threads, one snapshot
+    {
+        pthread_t th[THREADS];
+        for (int t = 0; t < THREADS; t++)
+            pthread_create(&th[t], NULL, recorder, NULL);
+        for (int t = 0; t < THREADS; t++)
+            pthread_join(th[t], NULL);
+        metrics_snapshot(&snap);
+        const metrics_hist_t *get_total = &snap.latency[METRICS_STAGE_TOTAL][METRICS_METHOD_GET];
+        uint64_t gets = snap.requests[METRICS_METHOD_GET][0x45], posts = snap.requests[METRICS_METHOD_POST][0x84];
+        if (snap.threads != THREADS || gets != THREADS * REQUESTS_PER_THREAD * 9 / 10 ||
+            posts != THREADS * REQUESTS_PER_THREAD / 10 || get_total->count != gets ||
+            snap.latency[METRICS_STAGE_PARSE][METRICS_METHOD_POST].count != posts || get_total->max_ns != 100000)
+        {
+            printf("TC-MET.2 FAILED: threads=%llu gets=%llu posts=%llu\n", (unsigned long long)snap.threads,
+                   (unsigned long long)gets, (unsigned long long)posts);
+            return 1;
+        }
+        printf("TC-MET.2 PASS: %llu requests from %llu threads\n", (unsigned long long)(gets + posts),
+               (unsigned long long)snap.threads);
+    }
+
+    // TC-MET.3 percentiles within one bucket of the exact value
+    {
+        const metrics_hist_t *h = &snap.latency[METRICS_STAGE_TOTAL][METRICS_METHOD_GET];
+        uint64_t p50 = metrics_percentile(h, 0.50), p99 = metrics_percentile(h, 0.99);
+        uint64_t parse = metrics_percentile(&snap.latency[METRICS_STAGE_PARSE][METRICS_METHOD_GET], 0.99);
+        if (p50 < 50000 || p50 > 50000 * 5 / 4 || p99 < 99000 || p99 > 100000 || parse != 200)
+        {
+            printf("TC-MET.3 FAILED: p50=%llu p99=%llu parse=%llu\n", (unsigned long long)p50,
+                   (unsigned long long)p99, (unsigned long long)parse);
+            return 1;
+        }
+        printf("TC-MET.3 PASS: p50=%llu ns p99=%llu ns\n", (unsigned long long)p50, (unsigned long long)p99);
+    }
+
+    // TC-MET.4 text and JSON summaries, too-small buffer
+    {
+        char out[METRICS_BODY_MAX];
+        int text = metrics_format(&snap, 0, out, sizeof(out));
+        int ok = text > 0 && strstr(out, "requests method=GET code=2.05 count=36000\n") &&
+                 strstr(out, "requests method=POST code=4.04 count=4000\n") &&
+                 strstr(out, "latency stage=total method=GET count=36000 ") && !strstr(out, "method=PUT");
+        int json = metrics_format(&snap, 1, out, sizeof(out));
+        ok = ok && json > 0 && out[0] == '{' && out[json - 1] == '}' &&
+             strstr(out, "{\"method\":\"POST\",\"code\":\"4.04\",\"count\":4000}") &&
+             strstr(out, "{\"stage\":\"db\",\"method\":\"GET\",\"count\":36000,");
+        if (!ok || metrics_format(&snap, 1, out, 32) != -1)
+        {
+            printf("TC-MET.4 FAILED: text=%d json=%d\n", text, json);
+            return 1;
+        }
+        printf("TC-MET.4 PASS: %d bytes of text, %d bytes of JSON\n", text, json);
+    }
+
+    // TC-MET.5 nothing is recorded while metrics are off
+    {
+        uint64_t stages[METRICS_STAGES] = {1, 1, 1, 1};
+        metrics_set_enabled(0);
+        metrics_record(3, 0x44, stages);
+        uint64_t now = metrics_now();
+        metrics_set_enabled(1);
+        metrics_snapshot(&snap);
+        if (now != 0 || snap.requests[METRICS_METHOD_PUT][0x44] != 0 || metrics_now() == 0)
+        {
+            printf("TC-MET.5 FAILED\n");
+            return 1;
+        }
+        printf("TC-MET.5 PASS: disabled metrics record nothing\n");
+    }
+
+    printf("=== All metrics tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../server/mpmc_ring.h"
+#include "../server/worker_pool.h"
+
+/*
+ * Bounded MPMC ring (server/mpmc_ring.c) and the worker pool on top of it (server/worker_pool.c)
+ * - capacity is rounded up to a power of two, at least 2
+ * - a full ring rejects pushes, an empty one returns NULL, items come out in FIFO order across laps
+ * - concurrent producers and consumers lose and duplicate nothing
+ * - the idle hook runs when a worker finds the queue drained, before it runs the last
+ *   queued task, and on shutdown
+ */
+
+#define STRESS_PRODUCERS 4
+#define STRESS_CONSUMERS 4
+#define STRESS_ITEMS 50000 // per producer
+
+static mpmc_ring_t stress_ring;
+static _Atomic size_t stress_popped;
+static _Atomic uint64_t stress_sum;
+static _Atomic int stress_order_errors;
+
+// Item = producer << 32 | sequence (1-based, so it is never NULL)
+static void *stress_producer(void *arg)
+{
+    uintptr_t p = (uintptr_t)arg;
+    for (uintptr_t seq = 1; seq <= STRESS_ITEMS; seq++)
+        while (mpmc_ring_push(&stress_ring, (void *)(p << 32 | seq)) != 0)
+            sched_yield();
+    return NULL;
+}
+
+// One consumer pops positions in increasing order, so it must see each producer's items in order
+static void *stress_consumer(void *arg)
+{
+    (void)arg;
+    uintptr_t last[STRESS_PRODUCERS] = {0};
+    uint64_t sum = 0;
+    while (atomic_load(&stress_popped) < (size_t)STRESS_PRODUCERS * STRESS_ITEMS)
+    {
+        void *item = mpmc_ring_pop(&stress_ring);
+        if (!item)
+        {
+            sched_yield();
+            continue;
+        }
+        uintptr_t v = (uintptr_t)item, p = v >> 32, seq = v & 0xFFFFFFFFu;
+        if (p >= STRESS_PRODUCERS || seq <= last[p])
+            atomic_fetch_add(&stress_order_errors, 1);
+        else
+            last[p] = seq;
+        sum += seq;
+        atomic_fetch_add(&stress_popped, 1);
+    }
+    atomic_fetch_add(&stress_sum, sum);
+    return NULL;
+}
+
+static _Atomic size_t tasks_done;
+static _Atomic size_t idle_calls;
+static _Atomic size_t done_at_idle; // tasks_done seen by the latest idle call
+
+static void *count_task(void *task)
+{
+    (void)task;
+    atomic_fetch_add(&tasks_done, 1);
+    return NULL;
+}
+
+// Idle calls seen when the task starts running
+static _Atomic size_t idle_seen;
+
+static void *see_idle_task(void *task)
+{
+    (void)task;
+    atomic_store(&idle_seen, atomic_load(&idle_calls));
+    atomic_fetch_add(&tasks_done, 1);
+    return NULL;
+}
+
+static void record_idle(void)
+{
+    atomic_store(&done_at_idle, atomic_load(&tasks_done));
+    atomic_fetch_add(&idle_calls, 1);
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+int main(void)
+{
+    printf("=== Running MPMC ring tests ===\n");
+
+    // TC-RING.1 capacity rounding
+    {
+        const size_t req[] = {1, 2, 3, 5, 8, 9, 1000};
+        const size_t want[] = {2, 2, 4, 8, 8, 16, 1024};
+        mpmc_ring_t r;
+        for (size_t i = 0; i < sizeof(req) / sizeof(req[0]); i++)
+        {
+            if (mpmc_ring_init(&r, req[i]) != 0 || mpmc_ring_capacity(&r) != want[i] || mpmc_ring_size(&r) != 0)
+            {
+                printf("TC-RING.1 FAILED: capacity %zu\n", req[i]);
+                return 1;
+            }
+            mpmc_ring_destroy(&r);
+        }
+        if (mpmc_ring_init(&r, 0) == 0 || mpmc_ring_init(NULL, 4) == 0)
+        {
+            printf("TC-RING.1 FAILED: zero capacity accepted\n");
+            return 1;
+        }
+        printf("TC-RING.1 PASS: capacity rounded up to a power of two, zero rejected\n");
+    }
+
+    // TC-RING.2 full and empty, FIFO order over several laps
+    {
+        mpmc_ring_t r;
+        int items[4 * 5];
+        if (mpmc_ring_init(&r, 3) != 0)
+        {
+            printf("TC-RING.2 FAILED: init\n");
+            return 1;
+        }
+        int ok = mpmc_ring_pop(&r) == NULL && mpmc_ring_has_room(&r);
+        for (int lap = 0; ok && lap < 5; lap++)
+        {
+            int *base = &items[lap * 4];
+            for (int i = 0; ok && i < 4; i++)
+                ok = mpmc_ring_push(&r, &base[i]) == 0;
+            ok = ok && mpmc_ring_push(&r, &items[0]) == -1 && !mpmc_ring_has_room(&r) && mpmc_ring_size(&r) == 4;
+            // Popping one frees exactly one cell
+            ok = ok && mpmc_ring_pop(&r) == &base[0] && mpmc_ring_has_room(&r) &&
+                 mpmc_ring_push(&r, &base[0]) == 0 && mpmc_ring_push(&r, &base[0]) == -1;
+            for (int i = 1; ok && i < 4; i++)
+                ok = mpmc_ring_pop(&r) == &base[i];
+            ok = ok && mpmc_ring_pop(&r) == &base[0] && mpmc_ring_pop(&r) == NULL && mpmc_ring_size(&r) == 0;
+        }
+        mpmc_ring_destroy(&r);
+        if (!ok)
+        {
+            printf("TC-RING.2 FAILED\n");
+            return 1;
+        }
+        printf("TC-RING.2 PASS: full ring rejects, empty ring returns NULL, FIFO across 5 laps\n");
+    }
+
+    // TC-RING.3 stress: concurrent producers and consumers on a small ring
+    {
+        pthread_t prod[STRESS_PRODUCERS], cons[STRESS_CONSUMERS];
+        if (mpmc_ring_init(&stress_ring, 64) != 0)
+        {
+            printf("TC-RING.3 FAILED: init\n");
+            return 1;
+        }
+        for (uintptr_t i = 0; i < STRESS_CONSUMERS; i++)
+            pthread_create(&cons[i], NULL, stress_consumer, NULL);
+        for (uintptr_t i = 0; i < STRESS_PRODUCERS; i++)
+            pthread_create(&prod[i], NULL, stress_producer, (void *)i);
+        for (int i = 0; i < STRESS_PRODUCERS; i++)
+            pthread_join(prod[i], NULL);
+        for (int i = 0; i < STRESS_CONSUMERS; i++)
+            pthread_join(cons[i], NULL);
+
+        const uint64_t want = (uint64_t)STRESS_PRODUCERS * STRESS_ITEMS * (STRESS_ITEMS + 1) / 2;
+        size_t popped = atomic_load(&stress_popped);
+        uint64_t sum = atomic_load(&stress_sum);
+        int errors = atomic_load(&stress_order_errors);
+        int empty = mpmc_ring_pop(&stress_ring) == NULL;
+        mpmc_ring_destroy(&stress_ring);
+        if (popped != (size_t)STRESS_PRODUCERS * STRESS_ITEMS || sum != want || errors || !empty)
+        {
+            printf("TC-RING.3 FAILED: popped=%zu sum=%llu want=%llu order_errors=%d\n", popped,
+                   (unsigned long long)sum, (unsigned long long)want, errors);
+            return 1;
+        }
+        printf("TC-RING.3 PASS: %d producers x %d items through %d consumers, none lost or reordered\n",
+               STRESS_PRODUCERS, STRESS_ITEMS, STRESS_CONSUMERS);
+    }
+
+    // TC-RING.4 worker pool: every task runs, the idle hook follows the last one and runs on shutdown
+    {
+        worker_pool_t pool;
+        static int tasks[1000];
+        const size_t n = sizeof(tasks) / sizeof(tasks[0]);
+        if (worker_pool_init(&pool, 2, 16, count_task, record_idle) != 0)
+        {
+            printf("TC-RING.4 FAILED: init\n");
+            return 1;
+        }
+        size_t rejected = 0;
+        for (size_t i = 0; i < n; i++)
+            while (worker_pool_submit(&pool, &tasks[i]) != 0)
+            {
+                rejected++;
+                sched_yield();
+            }
+        for (int waited = 0; waited < 2000 && atomic_load(&done_at_idle) != n; waited++)
+            sleep_ms(1);
+
+        worker_pool_stats_t st;
+        worker_pool_get_stats(&pool, &st);
+        size_t flushed = atomic_load(&done_at_idle), idle_before = atomic_load(&idle_calls);
+        worker_pool_shutdown(&pool);
+        size_t idle_after = atomic_load(&idle_calls);
+        if (flushed != n || atomic_load(&tasks_done) != n || st.submitted != n || st.completed != n ||
+            st.rejected != rejected || st.capacity != 16 || st.depth != 0 || idle_after < idle_before + 2)
+        {
+            printf("TC-RING.4 FAILED: done_at_idle=%zu completed=%llu rejected=%llu idle=%zu/%zu\n", flushed,
+                   (unsigned long long)st.completed, (unsigned long long)st.rejected, idle_before, idle_after);
+            return 1;
+        }
+        printf("TC-RING.4 PASS: %zu tasks (%zu rejected while full), idle hook ran after the last one and on shutdown\n",
+               n, rejected);
+    }
+
+    // TC-RING.5 a lone task: the idle hook flushes before it runs, not only after
+    {
+        worker_pool_t pool;
+        static int task;
+        if (worker_pool_init(&pool, 1, 16, see_idle_task, record_idle) != 0)
+        {
+            printf("TC-RING.5 FAILED: init\n");
+            return 1;
+        }
+        sleep_ms(20); // let the worker go to sleep
+        atomic_store(&tasks_done, 0);
+        size_t base = atomic_load(&idle_calls);
+        int ok = worker_pool_submit(&pool, &task) == 0;
+        for (int waited = 0; ok && waited < 2000 && atomic_load(&idle_calls) < base + 2; waited++)
+            sleep_ms(1);
+        size_t seen = atomic_load(&idle_seen), after = atomic_load(&idle_calls);
+        worker_pool_shutdown(&pool);
+        if (!ok || atomic_load(&tasks_done) != 1 || seen != base + 1 || after != base + 2)
+        {
+            printf("TC-RING.5 FAILED: base=%zu seen=%zu after=%zu\n", base, seen, after);
+            return 1;
+        }
+        printf("TC-RING.5 PASS: idle hook ran before the last queued task and again after it\n");
+    }
+
+    printf("=== All MPMC ring tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include "../src/coap.h"
+#include "../server/observe.h"
+#include "../server/etag.h"
+
+/*
+ * Observe registry (server/observe.c)
+ * - a notification reaches every observer of the sensor, each with its own token,
+ *   and carries the ETag, Observe and Max-Age options of a GET response
+ * - observers of other sensors get nothing
+ * - deregistration and a RST for a notification remove the observer
+ * - a due observer gets a CON notification; its ACK confirms it. Later CON
+ *   notifications take the place of an unacknowledged one in the retransmission
+ *   tracker, and the observer is dropped once the tracker gives up
+ */
+
+#define MAX_SENT 8
+
+typedef struct
+{
+    struct sockaddr_in to;
+    uint8_t data[256];
+    size_t len;
+} sent_t;
+
+static sent_t sent[MAX_SENT];
+static int sent_count = 0;
+
+static void capture_send(int sock, const struct sockaddr_in *addr, const uint8_t *data, size_t len)
+{
+    (void)sock;
+    if (sent_count < MAX_SENT && len <= sizeof(sent[0].data))
+    {
+        sent[sent_count].to = *addr;
+        memcpy(sent[sent_count].data, data, len);
+        sent[sent_count].len = len;
+    }
+    sent_count++;
+}
+
+static uint64_t fake_now;
+
+static uint64_t fake_clock(void)
+{
+    return fake_now;
+}
+
+// The tracker gave up on a notification, as wired in the server
+static void expire_observer(void *ctx, const struct sockaddr_in *addr, uint16_t mid)
+{
+    observe_expire_mid((observe_registry_t *)ctx, addr, mid);
+}
+
+static struct sockaddr_in endpoint(const char *ip, uint16_t port)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    inet_pton(AF_INET, ip, &a.sin_addr);
+    return a;
+}
+
+int main(void)
+{
+    printf("=== Running observe registry tests ===\n");
+
+    static observe_registry_t reg;
+    static _Atomic unsigned int next_mid = 100;
+    if (observe_init(&reg, capture_send, &next_mid) != 0)
+    {
+        printf("observe_init failed\n");
+        return 1;
+    }
+    struct sockaddr_in a = endpoint("10.0.0.1", 5000), b = endpoint("10.0.0.2", 6000);
+    const uint8_t tok_a[4] = {1, 2, 3, 4}, tok_b[1] = {9};
+    const char *body = "{\"sensor\":42, \"id\":1, \"value\":\"x\", \"ts\":\"t\"}";
+    const uint8_t etag[ETAG_LEN] = {0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6, 0x07, 0x18};
+
+    // TC-OBS.1 fan-out: one notification per observer, each parses with its own token
+    {
+        observe_register(&reg, 42, 3, &a, tok_a, sizeof(tok_a));
+        observe_register(&reg, 42, 3, &b, tok_b, sizeof(tok_b));
+        observe_register(&reg, 42, 3, &b, tok_b, sizeof(tok_b)); // refresh, not a second observer
+        observe_register(&reg, 7, 3, &a, tok_a, sizeof(tok_a));
+        uint32_t seq0 = observe_seq(&reg);
+        size_t n = observe_notify(&reg, 42, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body));
+        int ok = n == 2 && sent_count == 2;
+        for (int i = 0; ok && i < 2; i++)
+        {
+            coap_message_view_t v;
+            const uint8_t *tok = sent[i].to.sin_port == a.sin_port ? tok_a : tok_b;
+            uint8_t tkl = sent[i].to.sin_port == a.sin_port ? sizeof(tok_a) : sizeof(tok_b);
+            ok = coap_parse_view(sent[i].data, sent[i].len, &v) == COAP_OK && v.type == COAP_TYPE_NON &&
+                 v.code == COAP_CODE_CONTENT && v.tkl == tkl && memcmp(v.token, tok, tkl) == 0 &&
+                 v.options_count == 3 && v.options[0].number == COAP_OPTION_ETAG &&
+                 v.options[0].length == sizeof(etag) && memcmp(v.options[0].value, etag, sizeof(etag)) == 0 &&
+                 v.options[1].number == COAP_OPTION_OBSERVE && v.options[1].length == 1 &&
+                 v.options[1].value[0] == (uint8_t)(seq0 + 1) && v.options[2].number == COAP_OPTION_MAX_AGE &&
+                 v.options[2].length == 1 && v.options[2].value[0] == 5 &&
+                 v.payload_len == strlen(body) && memcmp(v.payload, body, v.payload_len) == 0;
+        }
+        if (!ok)
+        {
+            printf("TC-OBS.1 FAILED: notified=%zu sent=%d\n", n, sent_count);
+            return 1;
+        }
+        printf("TC-OBS.1 PASS: one serialization fanned out to both observers\n");
+    }
+
+    // TC-OBS.2 other sensors are not notified
+    {
+        sent_count = 0;
+        if (observe_notify(&reg, 43, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body)) != 0 || sent_count != 0)
+        {
+            printf("TC-OBS.2 FAILED\n");
+            return 1;
+        }
+        printf("TC-OBS.2 PASS: unobserved sensor sends nothing\n");
+    }
+
+    // TC-OBS.3 deregistration and RST remove observers
+    {
+        sent_count = 0;
+        observe_notify(&reg, 7, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body));
+        // The client answers with a RST built by the same codec
+        coap_message_t note, reset;
+        coap_message_view_t v;
+        uint8_t rst_buf[8];
+        coap_init_message(&note);
+        int parsed = sent_count == 1 && coap_parse(sent[0].data, sent[0].len, &note) == COAP_OK;
+        coap_build_rst_for(&note, &reset);
+        coap_free_message(&note);
+        int rst_len = coap_serialize(&reset, rst_buf, sizeof(rst_buf));
+        int rst = parsed && rst_len > 0 && coap_parse_view(rst_buf, (size_t)rst_len, &v) == COAP_OK &&
+                  observe_cancel_mid(&reg, &a, v.message_id) == 1;
+        int dereg = observe_cancel(&reg, 42, &b, tok_b, sizeof(tok_b)) == 1 &&
+                    observe_cancel(&reg, 42, &b, tok_b, sizeof(tok_b)) == 0;
+        sent_count = 0;
+        size_t left = observe_notify(&reg, 42, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body));
+        size_t none = observe_notify(&reg, 7, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body));
+        observe_stats_t st;
+        observe_get_stats(&reg, &st);
+        if (!rst || !dereg || left != 1 || none != 0 || st.observers != 1 || st.cancelled != 2)
+        {
+            printf("TC-OBS.3 FAILED: rst=%d dereg=%d left=%zu none=%zu observers=%zu\n", rst, dereg, left, none,
+                   st.observers);
+            return 1;
+        }
+        printf("TC-OBS.3 PASS: deregistration and RST end observations\n");
+    }
+
+    // TC-OBS.4 a CON notification is sent once the observer is due and tracked
+    // until ACKed; an unanswered one is retransmitted, replaced by the next
+    // notification, and the observer dropped when the tracker gives up
+    {
+        static retx_tracker_t retx;
+        retx_init_clock(&retx, fake_clock);
+        retx.give_up = expire_observer;
+        retx.give_up_ctx = &reg;
+        reg.retx = &retx;
+        reg.con_interval = 0; // every notification is due to be CON
+        sent_count = 0;
+        observe_notify(&reg, 42, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body));
+        coap_message_view_t v;
+        int con = sent_count == 1 && coap_parse_view(sent[0].data, sent[0].len, &v) == COAP_OK &&
+                  v.type == COAP_TYPE_CON;
+        // the server hands an empty ACK to both
+        int acked = con && retx_ack(&retx, &a, v.message_id) == 1 && observe_ack_mid(&reg, &a, v.message_id) == 1 &&
+                    observe_ack_mid(&reg, &a, v.message_id) == 0; // nothing outstanding any more
+
+        observe_notify(&reg, 42, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body)); // unanswered CON
+        observe_notify(&reg, 42, etag, sizeof(etag), 5, (const uint8_t *)body, strlen(body)); // takes its place
+        retx_stats_t rs;
+        retx_get_stats(&retx, &rs);
+        int replaced = rs.outstanding == 1 && rs.sent == 3;
+        observe_stats_t st;
+        size_t alive_until = 0;
+        for (fake_now = 0; fake_now < 200000; fake_now += 100)
+        {
+            retx_poll(&retx, fake_now);
+            observe_get_stats(&reg, &st);
+            if (st.observers == 0)
+                break;
+            alive_until = (size_t)fake_now;
+        }
+        retx_get_stats(&retx, &rs);
+        if (!con || !acked || !replaced || sent_count != 3 || rs.retransmits != MAX_RETRANSMIT || rs.gave_up != 1 ||
+            st.observers != 0 || st.expired != 1 || alive_until < 30 * ACK_TIMEOUT_MS)
+        {
+            printf("TC-OBS.4 FAILED: con=%d acked=%d replaced=%d sent=%d retransmits=%llu observers=%zu expired=%llu\n",
+                   con, acked, replaced, sent_count, (unsigned long long)rs.retransmits, st.observers,
+                   (unsigned long long)st.expired);
+            return 1;
+        }
+        printf("TC-OBS.4 PASS: CON notification ACKed; unanswered one retransmitted %llu times, observer dropped "
+               "after %zu ms\n",
+               (unsigned long long)rs.retransmits, alive_until);
+        reg.retx = NULL;
+        retx_destroy(&retx);
+    }
+
+    observe_destroy(&reg);
+    printf("=== All observe registry tests PASSED ===\n");
+    return 0;
+}
@@ -316,6 +316,23 @@ int main(void)
         free(resp);
     }
 
+    // TC-001.4 Message ID is serialized in network byte order (RFC 7252 3)
+    {
+        uint8_t buf[64];
+        int n = build_con_msg(0x1234, NULL, 0, NULL, 0, buf, sizeof(buf));
+        coap_message_t parsed;
+        coap_init_message(&parsed);
+        if (n != 4 || buf[2] != 0x12 || buf[3] != 0x34 || coap_parse(buf, (size_t)n, &parsed) != COAP_OK ||
+            parsed.message_id != 0x1234)
+        {
+            printf("TC-001.4 FAILED: MID bytes %02X %02X\n", n >= 4 ? buf[2] : 0, n >= 4 ? buf[3] : 0);
+            coap_free_message(&parsed);
+            return 1;
+        }
+        printf("TC-001.4 PASS: MID 0x1234 -> bytes 12 34\n");
+        coap_free_message(&parsed);
+    }
+
     // TC-002.1: CON con Options -> ACK
     {
         coap_option_t opts[2];
@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../src/coap.h"
+
+/*
+ * REQ-002: codec extensions
+ * - coap_parse_view: zero-copy parsing (options/payload reference the input buffer)
+ * - RFC 7252 extended option delta/length encoding and coap_serialized_size
+ * - RFC 7959 Block option values
+ */
+
+/* Build a CON POST with Uri-Path options and a payload using the owning API */
+static int build_post(const char *const *segments, size_t nseg, const char *payload,
+                      uint8_t *out_buf, size_t out_buf_len)
+{
+    coap_message_t m;
+    coap_init_message(&m);
+    m.type = COAP_TYPE_CON;
+    m.code = COAP_METHOD_POST;
+    m.message_id = 0x4242;
+    m.tkl = 2;
+    m.token[0] = 0xCA;
+    m.token[1] = 0xFE;
+    for (size_t i = 0; i < nseg; i++)
+    {
+        if (coap_add_option(&m, 11, (const uint8_t *)segments[i], strlen(segments[i])) != COAP_OK)
+        {
+            coap_free_message(&m);
+            return COAP_ERR_INVALID;
+        }
+    }
+    m.payload = (uint8_t *)payload;
+    m.payload_len = payload ? strlen(payload) : 0;
+    int n = coap_serialize(&m, out_buf, out_buf_len);
+    m.payload = NULL; // not owned
+    coap_free_message(&m);
+    return n;
+}
+
+int main(void)
+{
+    printf("=== Running REQ-002 (CoAP codec) tests ===\n");
+
+    // TC-002.3 view parse references the input buffer
+    {
+        const char *segs[] = {"sensor", "7"};
+        const char *payload = "{\"temp\":21.5,\"hum\":40}";
+        uint8_t buf[256];
+        int n = build_post(segs, 2, payload, buf, sizeof(buf));
+        if (n < 0)
+        {
+            printf("Failed to build POST message\n");
+            return 1;
+        }
+
+        coap_message_view_t v;
+        if (coap_parse_view(buf, (size_t)n, &v) != COAP_OK)
+        {
+            printf("TC-002.3 FAILED: coap_parse_view error\n");
+            return 1;
+        }
+        if (v.type != COAP_TYPE_CON || v.code != COAP_METHOD_POST || v.message_id != 0x4242 ||
+            v.tkl != 2 || v.token[0] != 0xCA || v.token[1] != 0xFE)
+        {
+            printf("TC-002.3 FAILED: header mismatch\n");
+            return 1;
+        }
+        if (v.options_count != 2 || v.options[0].number != 11 || v.options[1].number != 11 ||
+            v.options[0].length != 6 || memcmp(v.options[0].value, "sensor", 6) != 0 ||
+            v.options[1].length != 1 || v.options[1].value[0] != '7')
+        {
+            printf("TC-002.3 FAILED: options mismatch\n");
+            return 1;
+        }
+        if (v.payload_len != strlen(payload) || memcmp(v.payload, payload, v.payload_len) != 0)
+        {
+            printf("TC-002.3 FAILED: payload mismatch\n");
+            return 1;
+        }
+        if (v.payload < buf || v.payload >= buf + n ||
+            v.options[0].value < buf || v.options[0].value >= buf + n)
+        {
+            printf("TC-002.3 FAILED: view does not reference the input buffer\n");
+            return 1;
+        }
+        printf("TC-002.3 PASS: coap_parse_view references the receive buffer\n");
+    }
+
+    // TC-002.4 view parse and owning parse agree; errors match
+    {
+        const char *segs[] = {"a", "b", "c"};
+        uint8_t buf[256];
+        int n = build_post(segs, 3, "x", buf, sizeof(buf));
+        coap_message_view_t v;
+        coap_message_t m;
+        coap_init_message(&m);
+        if (n < 0 || coap_parse_view(buf, (size_t)n, &v) != COAP_OK || coap_parse(buf, (size_t)n, &m) != COAP_OK)
+        {
+            printf("TC-002.4 FAILED: parse error\n");
+            coap_free_message(&m);
+            return 1;
+        }
+        int same = (v.options_count == m.options_count && v.payload_len == m.payload_len &&
+                    memcmp(v.payload, m.payload, m.payload_len) == 0);
+        for (size_t i = 0; same && i < m.options_count; i++)
+            same = (v.options[i].number == m.options[i].number && v.options[i].length == m.options[i].length &&
+                    memcmp(v.options[i].value, m.options[i].value, m.options[i].length) == 0);
+        coap_free_message(&m);
+        if (!same)
+        {
+            printf("TC-002.4 FAILED: view and owned parse differ\n");
+            return 1;
+        }
+
+        uint8_t bad_buf[] = {0x40, 0x01, 0x12, 0x34, 0xFF}; // marker without payload
+        if (coap_parse_view(bad_buf, sizeof(bad_buf), &v) != COAP_ERR_TRUNCATED)
+        {
+            printf("TC-002.4 FAILED: expected truncation error\n");
+            return 1;
+        }
+        printf("TC-002.4 PASS: view parse matches coap_parse\n");
+    }
+
+    // TC-002.5 more options than inline slots -> COAP_ERR_TOO_MANY_OPTIONS
+    {
+        uint8_t buf[256];
+        size_t idx = 0;
+        buf[idx++] = 0x40; // CON, tkl=0
+        buf[idx++] = COAP_METHOD_GET;
+        buf[idx++] = 0x00;
+        buf[idx++] = 0x01;
+        for (int i = 0; i < COAP_MAX_VIEW_OPTIONS + 1; i++)
+        {
+            buf[idx++] = (uint8_t)((i == 0 ? 11 : 0) << 4 | 1); // Uri-Path, length 1
+            buf[idx++] = 'p';
+        }
+        coap_message_view_t v;
+        if (coap_parse_view(buf, idx, &v) != COAP_ERR_TOO_MANY_OPTIONS)
+        {
+            printf("TC-002.5 FAILED: expected COAP_ERR_TOO_MANY_OPTIONS\n");
+            return 1;
+        }
+        printf("TC-002.5 PASS: inline option limit enforced\n");
+    }
+
+    // TC-002.6 extended delta/length round trip (13 and 14 forms) with exact size
+    {
+        char long_seg[40];
+        memset(long_seg, 'u', sizeof(long_seg));
+        uint8_t big_val[300];
+        for (size_t i = 0; i < sizeof(big_val); i++)
+            big_val[i] = (uint8_t)i;
+
+        coap_message_t m;
+        coap_init_message(&m);
+        m.code = COAP_METHOD_GET;
+        m.message_id = 7;
+        if (coap_add_option(&m, 11, (const uint8_t *)long_seg, sizeof(long_seg)) != COAP_OK || // length 40 -> ext8
+            coap_add_option(&m, 60, NULL, 0) != COAP_OK ||                                      // delta 49 -> ext8
+            coap_add_option(&m, 2100, big_val, sizeof(big_val)) != COAP_OK)                      // delta 2040, length 300 -> ext16
+        {
+            printf("TC-002.6 FAILED: coap_add_option rejected an extended option\n");
+            coap_free_message(&m);
+            return 1;
+        }
+
+        uint8_t buf[1024];
+        size_t expect = coap_serialized_size(&m);
+        int n = coap_serialize(&m, buf, sizeof(buf));
+        if (n <= 0 || (size_t)n != expect)
+        {
+            printf("TC-002.6 FAILED: serialized size %d, coap_serialized_size %zu\n", n, expect);
+            coap_free_message(&m);
+            return 1;
+        }
+        // Option 1: delta 11, length 40 -> 0xBD, ext 27
+        if (buf[4] != 0xBD || buf[5] != 40 - 13)
+        {
+            printf("TC-002.6 FAILED: wrong extended length encoding\n");
+            coap_free_message(&m);
+            return 1;
+        }
+        if (coap_serialize(&m, buf, expect - 1) != COAP_ERR_TRUNCATED)
+        {
+            printf("TC-002.6 FAILED: undersized buffer not rejected\n");
+            coap_free_message(&m);
+            return 1;
+        }
+        coap_free_message(&m);
+
+        coap_message_view_t v;
+        if (coap_parse_view(buf, (size_t)n, &v) != COAP_OK || v.options_count != 3 ||
+            v.options[0].number != 11 || v.options[0].length != sizeof(long_seg) ||
+            v.options[1].number != 60 || v.options[1].length != 0 ||
+            v.options[2].number != 2100 || v.options[2].length != sizeof(big_val) ||
+            memcmp(v.options[2].value, big_val, sizeof(big_val)) != 0)
+        {
+            printf("TC-002.6 FAILED: extended options did not round trip\n");
+            return 1;
+        }
+        coap_message_t back;
+        coap_init_message(&back);
+        if (coap_parse(buf, (size_t)n, &back) != COAP_OK || back.options_count != 3 ||
+            back.options[2].number != 2100 || back.options[2].length != sizeof(big_val))
+        {
+            printf("TC-002.6 FAILED: coap_parse rejected extended options\n");
+            coap_free_message(&back);
+            return 1;
+        }
+        coap_free_message(&back);
+        printf("TC-002.6 PASS: extended option delta/length round trip\n");
+    }
+
+    // TC-002.7 reserved nibble and truncated extended bytes are rejected
+    {
+        uint8_t reserved[] = {0x40, 0x01, 0x00, 0x01, 0xF1, 'x'};  // delta nibble 15
+        uint8_t truncated[] = {0x40, 0x01, 0x00, 0x01, 0xE1, 0x00}; // delta 14 needs two bytes
+        coap_message_view_t v;
+        if (coap_parse_view(reserved, sizeof(reserved), &v) == COAP_OK ||
+            coap_parse_view(truncated, sizeof(truncated), &v) != COAP_ERR_TRUNCATED)
+        {
+            printf("TC-002.7 FAILED: malformed extended option accepted\n");
+            return 1;
+        }
+        printf("TC-002.7 PASS: malformed extended options rejected\n");
+    }
+
+    // TC-002.8 Block option values: minimal length, round trip, reserved SZX
+    {
+        coap_block_t cases[] = {{0, 0, 0}, {0, 1, 6}, {5, 1, 2}, {300, 0, 6}, {COAP_BLOCK_MAX_NUM, 1, 4}};
+        int lens[] = {0, 1, 1, 2, 3};
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        {
+            uint8_t v[3];
+            coap_block_t back;
+            int n = coap_block_encode(&cases[i], v);
+            if (n != lens[i] || coap_block_decode(v, (size_t)n, &back) != COAP_OK || back.num != cases[i].num ||
+                back.more != cases[i].more || back.szx != cases[i].szx)
+            {
+                printf("TC-002.8 FAILED: block %u/%u/%u (len %d)\n", (unsigned)cases[i].num,
+                       (unsigned)cases[i].more, (unsigned)cases[i].szx, n);
+                return 1;
+            }
+        }
+        uint8_t reserved = 0x07, too_long[4] = {0};
+        coap_block_t b, bad_num = {COAP_BLOCK_MAX_NUM + 1, 0, 0};
+        uint8_t v[3];
+        if (coap_block_decode(&reserved, 1, &b) == COAP_OK || coap_block_decode(too_long, 4, &b) == COAP_OK ||
+            coap_block_encode(&bad_num, v) >= 0 || coap_block_szx_for(1000) != 5 || coap_block_szx_for(4096) != 6 ||
+            COAP_BLOCK_SIZE(coap_block_szx_for(16)) != 16)
+        {
+            printf("TC-002.8 FAILED: invalid block values accepted\n");
+            return 1;
+        }
+        printf("TC-002.8 PASS: Block option encode/decode\n");
+    }
+
+    printf("=== All REQ-002 tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "../server/retransmit.h"
+
+/*
+ * CON retransmission (server/retransmit.c), driven by a fake clock
+ * - an ACK from the same endpoint for the same MID stops the message, once
+ * - a message is resent after ACK_TIMEOUT * [1, ACK_RANDOM_FACTOR], then at
+ *   doubling intervals, MAX_RETRANSMIT times, and dropped after that
+ */
+
+static uint64_t fake_now;
+
+static uint64_t fake_clock(void)
+{
+    return fake_now;
+}
+
+static struct sockaddr_in endpoint(const char *ip, uint16_t port)
+{
+    struct sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    inet_pton(AF_INET, ip, &a.sin_addr);
+    return a;
+}
+
+// Datagrams waiting on sock, each compared with want
+static int drain(int sock, const uint8_t *want, size_t len)
+{
+    uint8_t buf[64];
+    int n = 0;
+    ssize_t r;
+    while ((r = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) >= 0)
+    {
+        if ((size_t)r != len || memcmp(buf, want, len) != 0)
+            return -1;
+        n++;
+    }
+    return n;
+}
+
+int main(void)
+{
+    printf("=== Running retransmission tests ===\n");
+
+    static retx_tracker_t t;
+    if (retx_init_clock(&t, fake_clock) != 0)
+    {
+        printf("retx_init_clock failed\n");
+        return 1;
+    }
+    // The tracker resends with sendto: give it a real loopback peer to send to
+    int tx = socket(AF_INET, SOCK_DGRAM, 0), rx = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in peer = endpoint("127.0.0.1", 0);
+    socklen_t plen = sizeof(peer);
+    if (tx < 0 || rx < 0 || bind(rx, (struct sockaddr *)&peer, sizeof(peer)) != 0 ||
+        getsockname(rx, (struct sockaddr *)&peer, &plen) != 0)
+    {
+        printf("socket setup failed\n");
+        return 1;
+    }
+    const uint8_t msg[] = {0x41, 0x45, 0x12, 0x34, 0xAA, 0xFF, 'o', 'k'};
+
+    // TC-RETX.1 ACK matching: endpoint and MID, only once
+    {
+        struct sockaddr_in other = endpoint("127.0.0.1", (uint16_t)(ntohs(peer.sin_port) + 1));
+        int added = retx_add(&t, tx, &peer, 0x1234, msg, sizeof(msg)) == 0;
+        int wrong_port = retx_ack(&t, &other, 0x1234);
+        int wrong_mid = retx_ack(&t, &peer, 0x1235);
+        int acked = retx_ack(&t, &peer, 0x1234);
+        int again = retx_ack(&t, &peer, 0x1234);
+        fake_now = 1000000;
+        size_t resent = retx_poll(&t, fake_now);
+        retx_stats_t st;
+        retx_get_stats(&t, &st);
+        if (!added || wrong_port || wrong_mid || acked != 1 || again || resent != 0 || st.outstanding != 0 ||
+            st.acked != 1 || drain(rx, msg, sizeof(msg)) != 0)
+        {
+            printf("TC-RETX.1 FAILED: added=%d port=%d mid=%d acked=%d again=%d resent=%zu\n", added, wrong_port,
+                   wrong_mid, acked, again, resent);
+            return 1;
+        }
+        printf("TC-RETX.1 PASS: ACK matched by endpoint and MID, an ACKed message is not resent\n");
+    }
+
+    // TC-RETX.2 exponential backoff, then give up after MAX_RETRANSMIT
+    {
+        const uint64_t start = fake_now, step = 10;
+        uint64_t at[MAX_RETRANSMIT + 1];
+        int resends = 0, ok = retx_add(&t, tx, &peer, 0x2000, msg, sizeof(msg)) == 0;
+        retx_stats_t st;
+        for (fake_now = start; ok && fake_now < start + 200000; fake_now += step)
+        {
+            size_t n = retx_poll(&t, fake_now);
+            if (n > 1 || (n == 1 && resends == MAX_RETRANSMIT))
+                ok = 0;
+            else if (n == 1)
+                at[resends++] = fake_now - start;
+            retx_get_stats(&t, &st);
+            if (st.outstanding == 0)
+            {
+                at[MAX_RETRANSMIT] = fake_now - start;
+                break;
+            }
+        }
+        // The first timeout is in [ACK_TIMEOUT, ACK_TIMEOUT * ACK_RANDOM_FACTOR]; each
+        // later interval is twice the previous one (plus at most one poll step)
+        uint64_t first = resends > 0 ? at[0] : 0;
+        ok = ok && resends == MAX_RETRANSMIT && st.outstanding == 0 && st.gave_up == 1 &&
+             first >= ACK_TIMEOUT_MS && first <= (uint64_t)(ACK_TIMEOUT_MS * ACK_RANDOM_FACTOR) + step;
+        for (int k = 1; ok && k <= MAX_RETRANSMIT; k++)
+        {
+            uint64_t interval = at[k] - at[k - 1], expect = first << k;
+            ok = interval + (step << k) >= expect && interval <= expect + step;
+        }
+        int received = drain(rx, msg, sizeof(msg));
+        if (!ok || received != MAX_RETRANSMIT || st.retransmits != MAX_RETRANSMIT)
+        {
+            printf("TC-RETX.2 FAILED: resends=%d received=%d gave_up=%llu first=%llu\n", resends, received,
+                   (unsigned long long)st.gave_up, (unsigned long long)first);
+            return 1;
+        }
+        printf("TC-RETX.2 PASS: resent after %llu, %llu, %llu, %llu ms, dropped after %llu ms\n",
+               (unsigned long long)at[0], (unsigned long long)at[1], (unsigned long long)at[2],
+               (unsigned long long)at[3], (unsigned long long)at[4]);
+    }
+
+    retx_destroy(&t);
+    close(tx);
+    close(rx);
+    printf("=== All retransmission tests PASSED ===\n");
+    return 0;
+}
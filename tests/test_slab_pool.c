@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../server/slab_pool.h"
+
+/*
+ * Fixed-size object slab (server/slab_pool.c)
+ * - object size is rounded up to 64 bytes, objects are 64-byte aligned and disjoint
+ * - an exhausted slab returns NULL and counts the miss
+ * - a freed object is handed out again
+ * - objects taken on one thread and given back on others all return to the slab
+ */
+
+#define SLAB_COUNT 5       // deliberately not a power of two
+#define HANDOFF_ROUNDS 100000
+#define RETURNERS 2
+
+typedef struct
+{
+    uint64_t round;
+    uint64_t check;
+} stamp_t;
+
+static slab_pool_t slab;
+static mpmc_ring_t handoff; // allocating thread -> returning threads
+static _Atomic size_t returned;
+static _Atomic int corrupt;
+
+// Like the workers: take an object off the queue, check it, give it back to the slab
+static void *returner(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&returned) < HANDOFF_ROUNDS)
+    {
+        stamp_t *s = mpmc_ring_pop(&handoff);
+        if (!s)
+        {
+            sched_yield();
+            continue;
+        }
+        if (s->check != ~s->round)
+            atomic_fetch_add(&corrupt, 1);
+        slab_pool_free(&slab, s);
+        atomic_fetch_add(&returned, 1);
+    }
+    return NULL;
+}
+
+// Take every object; fails if one is missing, out of the block, misaligned or handed out twice
+static int take_all(void **objs)
+{
+    for (size_t i = 0; i < SLAB_COUNT; i++)
+    {
+        uint8_t *p = objs[i] = slab_pool_alloc(&slab);
+        if (!p || p < slab.mem || p >= slab.mem + slab.obj_size * SLAB_COUNT ||
+            (size_t)(p - slab.mem) % slab.obj_size != 0)
+            return 0;
+        for (size_t j = 0; j < i; j++)
+            if (objs[j] == p)
+                return 0;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    printf("=== Running slab pool tests ===\n");
+
+    if (slab_pool_init(&slab, sizeof(stamp_t) + 100, SLAB_COUNT) != 0)
+    {
+        printf("slab_pool_init failed\n");
+        return 1;
+    }
+    void *objs[SLAB_COUNT];
+
+    // TC-SLAB.1 exhaustion: every object once, then NULL and a counted miss
+    {
+        slab_pool_stats_t st;
+        int ok = take_all(objs) && slab.obj_size == 128;
+        void *extra = slab_pool_alloc(&slab);
+        void *extra2 = slab_pool_alloc(&slab);
+        slab_pool_get_stats(&slab, &st);
+        if (!ok || extra || extra2 || st.misses != 2 || st.in_use != SLAB_COUNT || st.count != SLAB_COUNT)
+        {
+            printf("TC-SLAB.1 FAILED: ok=%d misses=%llu in_use=%zu\n", ok, (unsigned long long)st.misses, st.in_use);
+            return 1;
+        }
+        printf("TC-SLAB.1 PASS: %d objects of %zu bytes, then NULL with %llu misses counted\n", SLAB_COUNT,
+               st.obj_size, (unsigned long long)st.misses);
+    }
+
+    // TC-SLAB.2 reuse: a freed object is the next one handed out
+    {
+        slab_pool_stats_t st;
+        slab_pool_free(&slab, objs[2]);
+        void *again = slab_pool_alloc(&slab);
+        int ok = again == objs[2] && slab_pool_alloc(&slab) == NULL;
+        for (size_t i = 0; i < SLAB_COUNT; i++)
+            slab_pool_free(&slab, objs[i]);
+        slab_pool_get_stats(&slab, &st);
+        ok = ok && st.in_use == 0 && take_all(objs);
+        for (size_t i = 0; i < SLAB_COUNT; i++)
+            slab_pool_free(&slab, objs[i]);
+        if (!ok)
+        {
+            printf("TC-SLAB.2 FAILED\n");
+            return 1;
+        }
+        printf("TC-SLAB.2 PASS: freed objects are handed out again\n");
+    }
+
+    // TC-SLAB.3 taken on this thread, given back on others
+    {
+        pthread_t th[RETURNERS];
+        slab_pool_stats_t before, after;
+        slab_pool_get_stats(&slab, &before);
+        if (mpmc_ring_init(&handoff, SLAB_COUNT) != 0)
+        {
+            printf("TC-SLAB.3 FAILED: handoff ring\n");
+            return 1;
+        }
+        for (int i = 0; i < RETURNERS; i++)
+            pthread_create(&th[i], NULL, returner, NULL);
+        uint64_t waits = 0;
+        for (uint64_t round = 0; round < HANDOFF_ROUNDS; round++)
+        {
+            stamp_t *s;
+            while (!(s = slab_pool_alloc(&slab)))
+            {
+                waits++;
+                sched_yield();
+            }
+            s->round = round;
+            s->check = ~round;
+            // The slab never hands out more objects than the ring holds
+            if (mpmc_ring_push(&handoff, s) != 0)
+            {
+                printf("TC-SLAB.3 FAILED: more objects out than the slab holds\n");
+                return 1;
+            }
+        }
+        for (int i = 0; i < RETURNERS; i++)
+            pthread_join(th[i], NULL);
+        slab_pool_get_stats(&slab, &after);
+        int ok = atomic_load(&returned) == HANDOFF_ROUNDS && !atomic_load(&corrupt) && after.in_use == 0 &&
+                 after.misses - before.misses == waits && take_all(objs) && slab_pool_alloc(&slab) == NULL;
+        mpmc_ring_destroy(&handoff);
+        if (!ok)
+        {
+            printf("TC-SLAB.3 FAILED: returned=%zu corrupt=%d in_use=%zu\n", atomic_load(&returned),
+                   atomic_load(&corrupt), after.in_use);
+            return 1;
+        }
+        printf("TC-SLAB.3 PASS: %d objects cycled through %d returning threads, all back in the slab\n",
+               HANDOFF_ROUNDS, RETURNERS);
+    }
+
+    slab_pool_destroy(&slab);
+    printf("=== All slab pool tests PASSED ===\n");
+    return 0;
+}
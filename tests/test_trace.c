@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../server/trace.h"
+
+/*
+ * Request tracing (server/trace.c)
+ * - nothing is recorded (and no clock is read) while tracing is off
+ * - requests traced on several threads all reach the Chrome JSON dump
+ * - the per-thread ring keeps the newest TRACE_RING_SIZE requests
+ * - Uri-Path strings are cut and escaped
+ */
+
+#define THREADS 2
+#define REQUESTS_PER_THREAD 10
+
+static void stamps(trace_stamps_t *st, uint16_t mid)
+{
+    uint64_t base = 1000000000ull + (uint64_t)mid * 10000;
+    trace_stamps_t s = {base - 500, base, base + 100, base + 150, base + 2000, base + 2300, mid, 1, 0x45};
+    *st = s;
+}
+
+static void *tracer(void *arg)
+{
+    int t = (int)(long)arg;
+    for (int i = 0; i < REQUESTS_PER_THREAD; i++)
+    {
+        trace_stamps_t st;
+        stamps(&st, (uint16_t)(t * 100 + i));
+        trace_record(&st, "sensor/7");
+    }
+    return NULL;
+}
+
+// Dump into a string (caller frees); *requests gets the count reported by the dump
+static char *dump(size_t per_thread, size_t *requests)
+{
+    FILE *f = tmpfile();
+    if (!f)
+        return NULL;
+    *requests = trace_write_json(f, per_thread);
+    long size = ftell(f);
+    char *s = malloc((size_t)size + 1);
+    rewind(f);
+    if (s)
+        s[fread(s, 1, (size_t)size, f)] = '\0';
+    fclose(f);
+    return s;
+}
+
+static int count(const char *s, const char *needle)
+{
+    int n = 0;
+    for (const char *p = s; (p = strstr(p, needle)) != NULL; p += strlen(needle))
+        n++;
+    return n;
+}
+
+int main(void)
+{
+    printf("=== Running trace tests ===\n");
+    size_t n;
+    char *out;
+
+    // TC-TRC.1 off by default: no clock read, nothing recorded
+    {
+        trace_stamps_t st;
+        stamps(&st, 1);
+        if (trace_enabled() || trace_now() != 0 || trace_record(&st, "x") != -1)
+        {
+            printf("TC-TRC.1 FAILED\n");
+            return 1;
+        }
+        printf("TC-TRC.1 PASS: tracing off records nothing\n");
+    }
+
+    // TC-TRC.2 several threads, Chrome trace_event JSON with one span per stage
+    trace_set_enabled(1);
+    {
+        pthread_t th[THREADS];
+        for (long t = 0; t < THREADS; t++)
+            pthread_create(&th[t], NULL, tracer, (void *)t);
+        for (int t = 0; t < THREADS; t++)
+            pthread_join(th[t], NULL);
+        out = dump(0, &n);
+        int total = THREADS * REQUESTS_PER_THREAD;
+        if (!out || n != (size_t)total || strncmp(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 39) != 0 ||
+            count(out, "\"name\":\"request\"") != total || count(out, "\"name\":\"parse\"") != total ||
+            count(out, "\"name\":\"db\"") != total || count(out, "\"name\":\"queue\"") != total ||
+            count(out, "\"name\":\"thread_name\"") != 2 * THREADS || !strstr(out, "\"code\":\"2.05\"") ||
+            !strstr(out, "\"ts\":1000000.000,\"dur\":2.300") || !strstr(out, "\"name\":\"db\",\"cat\":\"GET\""))
+        {
+            printf("TC-TRC.2 FAILED: requests=%zu\n%s\n", n, out ? out : "(null)");
+            return 1;
+        }
+        free(out);
+        out = dump(3, &n);
+        if (!out || n != 3 * THREADS || count(out, "\"name\":\"request\"") != 3 * THREADS)
+        {
+            printf("TC-TRC.2 FAILED: limited dump has %zu requests\n", n);
+            return 1;
+        }
+        free(out);
+        printf("TC-TRC.2 PASS: %d requests from %d threads, 5 spans each\n", total, THREADS);
+    }
+
+    // TC-TRC.3 the ring keeps the newest requests, a long or odd Uri-Path is cut and escaped
+    {
+        pthread_t th;
+        pthread_create(&th, NULL, tracer, (void *)3L); // a fresh thread, own ring
+        pthread_join(th, NULL);
+        trace_stamps_t st;
+        for (int i = 0; i < TRACE_RING_SIZE + 100; i++)
+        {
+            stamps(&st, (uint16_t)(1000 + i));
+            trace_record(&st, i == TRACE_RING_SIZE + 99 ? "a\"b\\c/very/long/path/that/is/cut" : "sensor/1");
+        }
+        out = dump(0, &n);
+        char oldest[32], newest[32];
+        snprintf(oldest, sizeof(oldest), "\"mid\":%d,", 1000 + 99);
+        snprintf(newest, sizeof(newest), "\"mid\":%d,", 1000 + 100);
+        size_t expect = TRACE_RING_SIZE + (THREADS + 1) * REQUESTS_PER_THREAD;
+        if (!out || n != expect || strstr(out, oldest) || !strstr(out, newest) ||
+            !strstr(out, "\"uri\":\"a\\\"b\\\\c/very/long/path/th\""))
+        {
+            printf("TC-TRC.3 FAILED: requests=%zu expected=%zu\n", n, expect);
+            return 1;
+        }
+        free(out);
+        printf("TC-TRC.3 PASS: ring keeps the newest %d requests\n", TRACE_RING_SIZE);
+    }
+
+    printf("=== All trace tests PASSED ===\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../server/log_format.h"
+
+/*
+   log_decode: turn a server log written with --log-format binary back into
+   text lines ("[YYYY-MM-DD HH:MM:SS.uuuuuu] LEVEL: ..."). Bytes that are not
+   a record (stderr output, the writer's "lines dropped" notes) are passed
+   through unchanged.
+
+   Usage: log_decode [file ...]   (stdin when no file is given)
+*/
+
+static time_t cached_sec = (time_t)-1;
+static char cached_ts[32];
+
+static const char *timestamp(int64_t sec)
+{
+    if ((time_t)sec != cached_sec)
+    {
+        time_t t = (time_t)sec;
+        struct tm tmv;
+        localtime_r(&t, &tmv);
+        strftime(cached_ts, sizeof(cached_ts), "%Y-%m-%d %H:%M:%S", &tmv);
+        cached_sec = t;
+    }
+    return cached_ts;
+}
+
+// A record starts here: magic, a known type and level
+static int is_record(const unsigned char *p, size_t avail)
+{
+    if (avail < sizeof(log_bin_record_t))
+        return 0;
+    log_bin_record_t rec;
+    memcpy(&rec, p, sizeof(rec));
+    return rec.magic == LOG_BIN_MAGIC && (rec.type == LOG_BIN_TEXT || rec.type == LOG_BIN_REQUEST) &&
+           rec.level <= LOG_LEVEL_MAX;
+}
+
+static void print_record(const log_bin_record_t *rec)
+{
+    printf("[%s.%06u] %s: ", timestamp(rec->sec), (unsigned)rec->usec, log_level_name(rec->level));
+    if (rec->type == LOG_BIN_REQUEST)
+        printf("Processed MID=%u Code=%u Uri=%.*s Response=%u\n", (unsigned)rec->u.request.mid,
+               (unsigned)rec->u.request.method, (int)sizeof(rec->u.request.uri), rec->u.request.uri,
+               (unsigned)rec->u.request.response);
+    else
+        printf("%.*s\n", (int)sizeof(rec->u.text), rec->u.text);
+}
+
+// Decode one stream; returns the number of records
+static long decode(FILE *in)
+{
+    static unsigned char buf[1 << 16];
+    size_t len = 0, n;
+    long records = 0;
+    int eof = 0;
+    while (!eof || len > 0)
+    {
+        if (!eof && (n = fread(buf + len, 1, sizeof(buf) - len, in)) > 0)
+            len += n;
+        else
+            eof = 1;
+
+        size_t pos = 0;
+        while (pos < len)
+        {
+            if (is_record(buf + pos, len - pos))
+            {
+                log_bin_record_t rec;
+                memcpy(&rec, buf + pos, sizeof(rec));
+                print_record(&rec);
+                pos += sizeof(rec);
+                records++;
+                continue;
+            }
+            // Not (yet) a record: wait for more input if one could still start here
+            if (!eof && len - pos < sizeof(log_bin_record_t))
+                break;
+            // Pass the foreign byte through
+            putchar(buf[pos]);
+            pos++;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+    return records;
+}
+
+int main(int argc, char **argv)
+{
+    long records = 0;
+    if (argc < 2)
+        records = decode(stdin);
+    for (int i = 1; i < argc; i++)
+    {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f)
+        {
+            perror(argv[i]);
+            return 1;
+        }
+        records += decode(f);
+        fclose(f);
+    }
+    fprintf(stderr, "%ld records\n", records);
+    return 0;
+}